@@ -0,0 +1,494 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+// 内核微基准：按图像宽度测量各热点内核，耗时以同字节数 memcpy 归一化，
+// 与仓库中的基线 JSON 比较，超过容差即返回非零
+#include "image_compress/bmp_compressor.h"
+#include "image_compress/cpu_features.h"
+#include "image_compress/png_compressor.h"
+#include "image_compress/qoi_compressor.h"
+#include "simd/kernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace imgc;
+
+static const int kWidths[] = {64, 640, 1920, 4096};
+static const int kRows = 16; // 每次调用处理的行数
+static const int kReps = 5;  // 取最小值的重复次数
+
+struct bench_case {
+  std::string name;
+  size_t outBytes; // 归一化用 memcpy 字节数
+  std::function<void()> run;
+};
+
+static volatile uint8_t g_sink;
+
+// 自动校准迭代次数：翻倍直到单次测量不短于 minNs，返回每次调用的最小耗时
+static double timeIt(const std::function<void()> &fn, double minNs) {
+  typedef std::chrono::steady_clock clock;
+  long long iters = 1;
+  for (;;) {
+    clock::time_point t0 = clock::now();
+    for (long long i = 0; i < iters; ++i)
+      fn();
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    clock::now() - t0)
+                    .count();
+    if (ns >= minNs || iters >= (1LL << 30))
+      break;
+    iters *= 2;
+  }
+  double best = 0;
+  for (int r = 0; r < kReps; ++r) {
+    clock::time_point t0 = clock::now();
+    for (long long i = 0; i < iters; ++i)
+      fn();
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    clock::now() - t0)
+                    .count() /
+                iters;
+    if (r == 0 || ns < best)
+      best = ns;
+  }
+  return best;
+}
+
+struct bench_data {
+  int w;
+  std::vector<uint8_t> rgba, rgb, out, copy;
+  std::vector<int> xofs, x0, x1;
+  std::vector<float> wx;
+  std::vector<uint32_t> sums; // SSIM 按列统计量，四组各 w*4 项
+  ImageRGBA img;
+  explicit bench_data(int width) : w(width) {
+    size_t px = (size_t)w * kRows;
+    rgba.resize(px * 4);
+    rgb.resize(px * 3);
+    out.resize(px * 4);
+    copy.resize(px * 4);
+    sums.resize((size_t)w * 16);
+    for (size_t i = 0; i < rgba.size(); ++i)
+      rgba[i] = (uint8_t)(i * 131 + (i >> 7));
+    for (size_t i = 0; i < rgb.size(); ++i)
+      rgb[i] = (uint8_t)(i * 71 + (i >> 5));
+    // 缩放到 3/4 宽度
+    int dw = w * 3 / 4;
+    xofs.resize(dw);
+    x0.resize(dw);
+    x1.resize(dw);
+    wx.resize(dw);
+    for (int x = 0; x < dw; ++x) {
+      xofs[x] = x * w / dw;
+      float sx = (x + 0.5f) * w / dw - 0.5f;
+      x0[x] = std::max(0, (int)sx);
+      x1[x] = std::min(w - 1, x0[x] + 1);
+      wx[x] = sx - x0[x];
+    }
+    img.width = w;
+    img.height = kRows;
+    img.pixels = rgba;
+  }
+};
+
+static std::vector<bench_case> makeCases(bench_data &d) {
+  std::vector<bench_case> c;
+  size_t px = (size_t)d.w * kRows;
+  int dw = d.w * 3 / 4;
+  bench_data *p = &d;
+  c.push_back({"rgb_to_rgba", px * 4, [p, px]() {
+                 kernels().rgb_to_rgba(p->rgb.data(), p->out.data(), px);
+               }});
+  c.push_back({"bgr_to_rgba", px * 4, [p, px]() {
+                 kernels().bgr_to_rgba(p->rgb.data(), p->out.data(), px);
+               }});
+  // BMP 32 位读写的通道交换
+  c.push_back({"swap_rb32", px * 4, [p, px]() {
+                 kernels().swap_rb32(p->rgba.data(), p->out.data(), px);
+               }});
+  // JPEG 编码前的 RGBA -> RGB 暂存
+  c.push_back({"rgba_to_rgb", px * 3, [p, px]() {
+                 kernels().rgba_to_rgb(p->rgba.data(), p->out.data(), px);
+               }});
+  c.push_back({"rgba_to_bgr", px * 3, [p, px]() {
+                 kernels().rgba_to_bgr(p->rgba.data(), p->out.data(), px);
+               }});
+  c.push_back({"resize_nearest", (size_t)dw * kRows * 4, [p, dw]() {
+                 const kernel_table &k = kernels();
+                 for (int y = 0; y < kRows; ++y)
+                   k.resize_nearest_row(&p->rgba[(size_t)y * p->w * 4],
+                                        p->xofs.data(),
+                                        &p->out[(size_t)y * dw * 4], dw);
+               }});
+  c.push_back({"resize_bilinear", (size_t)dw * kRows * 4, [p, dw]() {
+                 const kernel_table &k = kernels();
+                 for (int y = 0; y + 1 < kRows; ++y)
+                   k.resize_bilinear_row(&p->rgba[(size_t)y * p->w * 4],
+                                         &p->rgba[(size_t)(y + 1) * p->w * 4],
+                                         p->x0.data(), p->x1.data(),
+                                         p->wx.data(), 0.375f,
+                                         &p->out[(size_t)y * dw * 4], dw);
+               }});
+  c.push_back({"downsample2x", px, [p]() {
+                 const kernel_table &k = kernels();
+                 int dstW = (p->w + 1) / 2;
+                 for (int y = 0; y + 1 < kRows; y += 2)
+                   k.downsample2x_row(&p->rgba[(size_t)y * p->w * 4],
+                                      &p->rgba[(size_t)(y + 1) * p->w * 4],
+                                      p->w, &p->out[(size_t)y / 2 * dstW * 4],
+                                      dstW);
+               }});
+  c.push_back({"min_alpha", px * 4, [p, px]() {
+                 g_sink = kernels().min_alpha(p->rgba.data(), px);
+               }});
+  // 旋转与翻转：w*kRows 块转置为 kRows*w，逐行逆序
+  c.push_back({"transpose32", px * 4, [p]() {
+                 kernels().transpose32(p->rgba.data(), (ptrdiff_t)p->w * 4,
+                                       p->out.data(), kRows * 4, p->w, kRows);
+               }});
+  c.push_back({"reverse32_row", px * 4, [p]() {
+                 const kernel_table &k = kernels();
+                 for (int y = 0; y < kRows; ++y)
+                   k.reverse32_row(&p->rgba[(size_t)y * p->w * 4],
+                                   &p->out[(size_t)y * p->w * 4], p->w);
+               }});
+  // 质量指标：亮度转换与 SSIM 统计量按列累加
+  c.push_back({"rgba_to_luma", px * 4, [p, px]() {
+                 kernels().rgba_to_luma(p->rgba.data(), p->out.data(), px);
+               }});
+  c.push_back({"ssim_accum_row", px * 4, [p]() {
+                 const kernel_table &k = kernels();
+                 uint32_t *acc = p->sums.data();
+                 for (int y = 0; y + 1 < kRows; ++y)
+                   k.ssim_accum_row(&p->rgba[(size_t)y * p->w * 4],
+                                    &p->rgba[(size_t)(y + 1) * p->w * 4],
+                                    p->w * 4, acc, acc + p->w * 4,
+                                    acc + p->w * 8, acc + p->w * 12);
+                 g_sink = (uint8_t)acc[0];
+               }});
+  // 编码器整行路径：PNG 行写入（含 zlib）、BMP 24 位写入与 QOI
+  c.push_back({"png_encode_rows", px * 4, [p]() {
+                 png_compressor png;
+                 compress_params cp;
+                 std::vector<uint8_t> buf;
+                 png.encodeFromRGBA(p->img, buf, cp);
+                 g_sink = buf.empty() ? 0 : buf[0];
+               }});
+  c.push_back({"bmp_encode_rows", px * 3, [p]() {
+                 bmp_compressor bmp;
+                 compress_params cp;
+                 std::vector<uint8_t> buf;
+                 bmp.encodeFromRGBA(p->img, buf, cp);
+                 g_sink = buf.empty() ? 0 : buf[0];
+               }});
+  c.push_back({"qoi_encode_rows", px * 4, [p]() {
+                 qoi_compressor qoi;
+                 compress_params cp;
+                 std::vector<uint8_t> buf;
+                 qoi.encodeFromRGBA(p->img, buf, cp);
+                 g_sink = buf.empty() ? 0 : buf[0];
+               }});
+  return c;
+}
+
+static const char *compilerId() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  return "msvc";
+#elif defined(__clang__)
+  return "clang";
+#elif defined(__GNUC__)
+  return "gcc";
+#else
+  return "other";
+#endif
+}
+
+// 基线：{ "tolerance": x, "<编译器>/<级别>": { "<内核>/<宽度>": 比值, ... } }
+typedef std::map<std::string, std::map<std::string, double>> baseline_map;
+
+// 只解析本工具写出的两层对象格式
+static bool readBaseline(const std::string &path, baseline_map &out,
+                         double &tolerance) {
+  std::ifstream ifs(path);
+  if (!ifs) {
+    std::cerr << "Open baseline failed: " << path << std::endl;
+    return false;
+  }
+  std::stringstream ss;
+  ss << ifs.rdbuf();
+  std::string s = ss.str();
+  size_t i = 0;
+  auto skipWs = [&]() {
+    while (i < s.size() && (s[i] == ' ' || s[i] == '\n' || s[i] == '\r' ||
+                            s[i] == '\t' || s[i] == ','))
+      ++i;
+  };
+  auto readStr = [&](std::string &v) {
+    skipWs();
+    if (i >= s.size() || s[i] != '"')
+      return false;
+    size_t e = s.find('"', i + 1);
+    if (e == std::string::npos)
+      return false;
+    v = s.substr(i + 1, e - i - 1);
+    i = e + 1;
+    skipWs();
+    if (i >= s.size() || s[i] != ':')
+      return false;
+    ++i;
+    skipWs();
+    return true;
+  };
+  auto readNum = [&](double &v) {
+    char *end = nullptr;
+    v = std::strtod(s.c_str() + i, &end);
+    if (end == s.c_str() + i)
+      return false;
+    i = end - s.c_str();
+    return true;
+  };
+  skipWs();
+  if (i >= s.size() || s[i++] != '{')
+    return false;
+  for (;;) {
+    skipWs();
+    if (i < s.size() && s[i] == '}')
+      return true;
+    std::string key;
+    if (!readStr(key))
+      return false;
+    if (s[i] == '{') {
+      ++i;
+      std::map<std::string, double> &sec = out[key];
+      for (;;) {
+        skipWs();
+        if (i < s.size() && s[i] == '}') {
+          ++i;
+          break;
+        }
+        std::string k;
+        double v;
+        if (!readStr(k) || !readNum(v))
+          return false;
+        sec[k] = v;
+      }
+    } else {
+      double v;
+      if (!readNum(v))
+        return false;
+      if (key == "tolerance")
+        tolerance = v;
+    }
+  }
+}
+
+static bool writeBaseline(const std::string &path, const baseline_map &m,
+                          double tolerance) {
+  std::ofstream ofs(path);
+  if (!ofs) {
+    std::cerr << "Open output failed: " << path << std::endl;
+    return false;
+  }
+  char buf[64];
+  std::snprintf(buf, sizeof(buf), "%.2f", tolerance);
+  ofs << "{\n  \"tolerance\": " << buf;
+  for (const auto &sec : m) {
+    ofs << ",\n  \"" << sec.first << "\": {";
+    bool first = true;
+    for (const auto &kv : sec.second) {
+      std::snprintf(buf, sizeof(buf), "%.4f", kv.second);
+      ofs << (first ? "\n" : ",\n") << "    \"" << kv.first << "\": " << buf;
+      first = false;
+    }
+    ofs << "\n  }";
+  }
+  ofs << "\n}\n";
+  return true;
+}
+
+// 测一个 SIMD 级别下的所有内核，结果写入 results（内核/宽度 -> 比值）
+static void runLevel(double minNs, bool quiet,
+                     std::map<std::string, double> &results,
+                     const std::string &only = std::string()) {
+  for (int w : kWidths) {
+    bench_data d(w);
+    for (const bench_case &c : makeCases(d)) {
+      std::string key = c.name + "/" + std::to_string(w);
+      if (!only.empty() && key != only)
+        continue;
+      double kns = timeIt(c.run, minNs);
+      double mns = timeIt(
+          [&]() {
+            std::memcpy(d.copy.data(), d.rgba.data(), c.outBytes);
+            g_sink = d.copy[c.outBytes / 2];
+          },
+          minNs);
+      double ratio = kns / std::max(mns, 1e-3);
+      results[key] = ratio;
+      if (!quiet)
+        std::printf("  %-24s %10.1f ns  %7.3f ns/px  x%.3f memcpy\n",
+                    key.c_str(), kns, kns / ((double)w * kRows), ratio);
+    }
+  }
+}
+
+static void usage() {
+  std::cout
+      << "usage: image_compress_bench [options]\n"
+         "  --baseline FILE        compare against baseline JSON\n"
+         "  --write-baseline FILE  record results (merged into FILE)\n"
+         "  --tolerance X          allowed slowdown, 0.5 = +50% (default: "
+         "baseline value)\n"
+         "  --level NAME           force SIMD level (scalar|sse2|...)\n"
+         "  --all-levels           run every level supported by this CPU\n"
+         "  --min-time-ms N        calibration target per measurement (default "
+         "10)\n";
+}
+
+int main(int argc, char **argv) {
+  std::string baselinePath, writePath, levelName;
+  double tolerance = -1;
+  double minMs = 10;
+  bool allLevels = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string a = argv[i];
+    auto next = [&]() -> const char * { return i + 1 < argc ? argv[++i] : ""; };
+    if (a == "--baseline")
+      baselinePath = next();
+    else if (a == "--write-baseline")
+      writePath = next();
+    else if (a == "--tolerance")
+      tolerance = std::atof(next());
+    else if (a == "--level")
+      levelName = next();
+    else if (a == "--all-levels")
+      allLevels = true;
+    else if (a == "--min-time-ms")
+      minMs = std::atof(next());
+    else {
+      usage();
+      return a == "-h" || a == "--help" ? 0 : 2;
+    }
+  }
+
+  SimdLevel hw = detectSimdLevel();
+  std::vector<SimdLevel> levels;
+  if (allLevels) {
+    for (int l = 0; l <= (int)SimdLevel::NEON; ++l)
+      if (setSimdLevel((SimdLevel)l) == (SimdLevel)l)
+        levels.push_back((SimdLevel)l);
+  } else if (!levelName.empty()) {
+    bool found = false;
+    for (int l = 0; l <= (int)SimdLevel::NEON; ++l) {
+      if (levelName == simdLevelName((SimdLevel)l)) {
+        levels.push_back(setSimdLevel((SimdLevel)l));
+        found = true;
+      }
+    }
+    if (!found) {
+      std::cerr << "Unknown SIMD level: " << levelName << std::endl;
+      return 2;
+    }
+  } else {
+    levels.push_back(activeSimdLevel());
+  }
+
+  baseline_map base;
+  double baseTol = 0.5;
+  if (!baselinePath.empty() && !readBaseline(baselinePath, base, baseTol)) {
+    std::cerr << "Invalid baseline: " << baselinePath << std::endl;
+    return 2;
+  }
+  if (tolerance < 0)
+    tolerance = baseTol;
+
+  std::cout << "cpu=" << simdLevelName(hw) << " compiler=" << compilerId()
+            << " rows=" << kRows << std::endl;
+  baseline_map measured;
+  int regressions = 0, compared = 0;
+  for (SimdLevel lv : levels) {
+    setSimdLevel(lv);
+    std::string sec = std::string(compilerId()) + "/" + simdLevelName(lv);
+    std::cout << "[" << sec << "]" << std::endl;
+    std::map<std::string, double> &res = measured[sec];
+    runLevel(minMs * 1e6, false, res);
+    if (baselinePath.empty())
+      continue;
+#ifndef NDEBUG
+    std::cout << "  unoptimized build, baseline comparison skipped"
+              << std::endl;
+    continue;
+#endif
+    auto it = base.find(sec);
+    if (it == base.end()) {
+      std::cout << "  no baseline for " << sec << ", skipped" << std::endl;
+      continue;
+    }
+    for (const auto &kv : res) {
+      auto b = it->second.find(kv.first);
+      if (b == it->second.end())
+        continue;
+      ++compared;
+      double limit = b->second * (1 + tolerance);
+      double ratio = kv.second;
+      if (ratio > limit) {
+        // 噪声机器上先复测一次，取较好的结果
+        std::map<std::string, double> again;
+        runLevel(minMs * 2e6, true, again, kv.first);
+        ratio = std::min(ratio, again[kv.first]);
+      }
+      if (ratio > limit) {
+        ++regressions;
+        std::printf("  REGRESSION %-24s x%.3f > baseline x%.3f (+%.0f%%)\n",
+                    kv.first.c_str(), ratio, b->second, tolerance * 100);
+      }
+    }
+  }
+  setSimdLevel(hw);
+
+  if (!writePath.empty()) {
+    baseline_map merged;
+    double oldTol = tolerance;
+    if (std::ifstream(writePath)) // 已有文件时合并其它编译器/级别的记录
+      readBaseline(writePath, merged, oldTol);
+    for (const auto &sec : measured)
+      merged[sec.first] = sec.second;
+    if (!writeBaseline(writePath, merged, tolerance))
+      return 2;
+  }
+  if (!baselinePath.empty())
+    std::cout << "compared=" << compared << " regressions=" << regressions
+              << " tolerance=" << tolerance << std::endl;
+  return regressions > 0 ? 1 : 0;
+}
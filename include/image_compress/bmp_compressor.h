@@ -28,12 +28,21 @@ class IMAGE_COMPRESS_API bmp_compressor : public i_image_compressor {
 public:
   bmp_compressor() = default;
   ~bmp_compressor() = default;
-  int compressMemory(const uint8_t *inputBuffer, size_t inputSize,
-                     std::vector<uint8_t> &outputBuffer,
-                     const compress_params &params) override;
+  int64_t compressMemory(const uint8_t *inputBuffer, size_t inputSize,
+                         std::vector<uint8_t> &outputBuffer,
+                         const compress_params &params) override;
   bool decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
                     ImageRGBA &outRGBA) override;
-  int encodeFromRGBA(const ImageRGBA &rgba, std::vector<uint8_t> &outputBuffer,
-                     const compress_params &params) override;
+  bool decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
+                    ImageRGBA &outRGBA, const decode_params &params) override;
+  bool readImageSize(const uint8_t *inputBuffer, size_t inputSize, int &width,
+                     int &height) override;
+  // 零拷贝解码：对未压缩的 32 位 BMP（BGRA 或 RGBA 掩码）返回指向
+  // inputBuffer 像素区的视图，其他格式返回 false
+  bool decodeView(const uint8_t *inputBuffer, size_t inputSize,
+                  ImageView &outView);
+  int64_t encodeFromRGBA(const ImageRGBA &rgba,
+                         std::vector<uint8_t> &outputBuffer,
+                         const compress_params &params) override;
 };
 } // namespace imgc
@@ -31,12 +31,172 @@ SOFTWARE.
 #endif
 
 namespace imgc {
+// 解码速度：EXACT 为 libjpeg 默认的精确解码；FAST 用于预览与感知哈希，
+// JPEG 改用快速 IDCT 并关闭色度平滑上采样与块平滑，输出与精确解码略有差异
+enum class DecodeSpeed { EXACT, FAST };
+// 输入超出资源限制时转换与压缩接口的返回值（其他失败为 -1）
+const int kErrLimitExceeded = -2;
+// 解码资源限制，0 表示不限制。各解码器读完文件头、分配像素内存之前检查，
+// 超限时解码失败；转换接口另外检查请求的输出尺寸与编码结果大小
+struct decode_limits {
+  // 图像（及请求的输出）宽高与像素数上限；默认 2^28 像素，即 RGBA 1 GiB
+  int max_width = 0;
+  int max_height = 0;
+  unsigned long long max_pixels = 1ULL << 28;
+  // 解码缓冲（裁剪后的 RGBA 区域）字节数上限
+  unsigned long long max_decoded_bytes = 0;
+  // 编码输出字节数上限
+  unsigned long long max_output_bytes = 0;
+  bool allowsImage(long long width, long long height) const {
+    if (width <= 0 || height <= 0)
+      return false;
+    if ((max_width > 0 && width > max_width) ||
+        (max_height > 0 && height > max_height))
+      return false;
+    return max_pixels == 0 ||
+           (unsigned long long)width * (unsigned long long)height <= max_pixels;
+  }
+  bool allowsDecoded(unsigned long long bytes) const {
+    return max_decoded_bytes == 0 || bytes <= max_decoded_bytes;
+  }
+  bool allowsOutput(unsigned long long bytes) const {
+    return max_output_bytes == 0 || bytes <= max_output_bytes;
+  }
+};
 struct compress_params {
   int output_width = 0;
   int output_height = 0;
   int quality = 75;
   int target_size = 0;
-  enum class Format { AUTO, JPEG, PNG, BMP } format = Format::AUTO;
+  // 输出格式：AUTO 保持输入格式；SMART 按解码后的内容在 JPEG 与 PNG 之间
+  // 选择（见 image_converter.h 的 chooseOutputFormat），只用于转换接口
+  enum class Format { AUTO, JPEG, PNG, BMP, QOI, SMART } format = Format::AUTO;
   enum class ResizeAlgo { NEAREST, BILINEAR } resize_algo = ResizeAlgo::NEAREST;
+  // BMP 像素格式：BGR24 为 24 位；BGRA32 为 32 位 BGRA；
+  // RGBA32_BITFIELDS 写 BITMAPV4 头和 RGBA 掩码，像素区与 RGBA 内存布局一致
+  enum class BmpPixelFormat {
+    BGR24,
+    BGRA32,
+    RGBA32_BITFIELDS
+  } bmp_pixel_format = BmpPixelFormat::BGR24;
+  // BMP 按自上而下顺序存储（高度写为负数）
+  bool bmp_top_down = false;
+  // 方向：EXIF Orientation 取值 1-8（1 为正向）。像素在裁剪与缩放的同一遍中
+  // 变换为正向显示，裁剪区域与输出尺寸都针对变换后的图像
+  int orientation = 1;
+  // 读取输入的 EXIF 方向并应用（取代 orientation），输出不携带 EXIF。
+  // JPEG 到 JPEG 且不裁剪缩放时在 DCT 系数域无损旋转，不解码像素，
+  // 此时保留原量化表，quality 与色度采样等选项不生效
+  bool auto_orient = false;
+  // 系数域旋转要求被移到另一侧的边长为 iMCU（8 或 16 像素）整数倍；
+  // 不满足时 true 裁掉该边不完整的 iMCU（同 jpegtran -trim），
+  // false 改为解码后旋转并重新编码
+  bool jpeg_lossless_trim = false;
+  // 在 EXIF 方向之后依次应用的旋转（顺时针）与水平、垂直翻转，与方向合并为
+  // 一次变换；auto_orient 的 JPEG 系数域路径同样适用
+  enum class Rotation { NONE, CW90, CW180, CW270 } rotation = Rotation::NONE;
+  bool flip_horizontal = false;
+  bool flip_vertical = false;
+  // 裁剪区域（方向变换后的图像坐标），宽或高为 0 表示不裁剪；超出图像的
+  // 部分被截掉，在缩放之前应用，JPEG/PNG/BMP 解码时只解出该区域
+  int crop_x = 0;
+  int crop_y = 0;
+  int crop_width = 0;
+  int crop_height = 0;
+  // 指定输出宽高且比例与（裁剪后）图像不同时：
+  // STRETCH 直接拉伸；FIT 等比缩放到输出框内，输出可能小于指定尺寸；
+  // FILL 等比铺满输出框，按 gravity 裁掉多余部分
+  enum class FitMode { STRETCH, FIT, FILL } fit_mode = FitMode::STRETCH;
+  enum class Gravity {
+    CENTER,
+    NORTH,
+    SOUTH,
+    EAST,
+    WEST,
+    NORTH_EAST,
+    NORTH_WEST,
+    SOUTH_EAST,
+    SOUTH_WEST
+  } gravity = Gravity::CENTER;
+  // JPEG 编码选项
+  // 渐进式扫描（jpeg_simple_progression）
+  bool jpeg_progressive = false;
+  // 为每幅图生成最优 Huffman 表，多一遍统计，体积通常小几个百分点
+  bool jpeg_optimize_coding = false;
+  // 色度采样：S420 为 libjpeg 默认（水平、垂直各减半）
+  enum class JpegSubsampling {
+    S444,
+    S422,
+    S420
+  } jpeg_subsampling = JpegSubsampling::S420;
+  // DCT 算法：ISLOW 精确；IFAST 更快但精度略低；FLOAT 浮点
+  enum class JpegDctMethod {
+    ISLOW,
+    IFAST,
+    FLOAT
+  } jpeg_dct_method = JpegDctMethod::ISLOW;
+  // 每隔多少 MCU 行插入重启标记，0 表示不插入
+  int jpeg_restart_rows = 0;
+  // 色度量化质量 1-100，0 表示与 quality 相同
+  int jpeg_chroma_quality = 0;
+  // 按 SSIM 目标选择 JPEG 质量：大于 0 时忽略 quality，在 1-100 内二分查找
+  // 解码结果与待编码图像的亮度 SSIM（见 image_metrics.h）不低于该值的最低
+  // 质量，每个候选在进程内编码并解码（约 7 次）；YUV 输入与分块转换不支持
+  double target_ssim = 0;
+  // 转换时的解码速度；FAST 下 JPEG 还会按输出尺寸选择 DCT 缩放比例
+  DecodeSpeed decode_speed = DecodeSpeed::EXACT;
+  // 解码资源限制，超限时返回 kErrLimitExceeded
+  decode_limits limits;
+  // 单幅图像内缩放、像素格式转换等逐像素阶段的线程数上限，
+  // 0 表示使用全部硬件线程，1 表示单线程；较小的图像总在调用线程处理
+  int threads = 0;
+};
+// JPEG 编码预设：在编码耗时与输出体积之间取舍，只设置 jpeg_* 选项，不改 quality
+enum class JpegPreset {
+  FASTEST,  // IFAST DCT，标准 Huffman 表
+  BALANCED, // 优化 Huffman 表
+  SMALLEST, // 渐进式 + 优化 Huffman 表，色度质量略降
+  QUALITY   // 4:4:4 不降采样 + 优化 Huffman 表
+};
+inline void applyJpegPreset(compress_params &params, JpegPreset preset) {
+  params.jpeg_progressive = false;
+  params.jpeg_optimize_coding = true;
+  params.jpeg_subsampling = compress_params::JpegSubsampling::S420;
+  params.jpeg_dct_method = compress_params::JpegDctMethod::ISLOW;
+  params.jpeg_chroma_quality = 0;
+  switch (preset) {
+  case JpegPreset::FASTEST:
+    params.jpeg_optimize_coding = false;
+    params.jpeg_dct_method = compress_params::JpegDctMethod::IFAST;
+    break;
+  case JpegPreset::SMALLEST:
+    params.jpeg_progressive = true;
+    params.jpeg_chroma_quality = params.quality > 10 ? params.quality - 10 : 1;
+    break;
+  case JpegPreset::QUALITY:
+    params.jpeg_subsampling = compress_params::JpegSubsampling::S444;
+    break;
+  default:
+    break;
+  }
+}
+struct decode_params {
+  // 解码结果的最小尺寸，0 表示按原尺寸解码；
+  // JPEG 会据此选择最小的 DCT 缩放比例（1/8 ~ 8/8），直接解出更小的图像
+  int min_width = 0;
+  int min_height = 0;
+  // 只解码该区域（原图坐标），宽或高为 0 表示整幅；
+  // 与 min_width/min_height 同时使用时，最小尺寸针对裁剪区域
+  int crop_x = 0;
+  int crop_y = 0;
+  int crop_width = 0;
+  int crop_height = 0;
+  DecodeSpeed speed = DecodeSpeed::EXACT;
+  // 渐进式 JPEG 最多解码的扫描数，0 表示全部；只解前几次扫描可得到
+  // 低精度的完整画面，非渐进式图像忽略此项
+  int max_progressive_scans = 0;
+  decode_limits limits;
+  // 逐像素阶段的线程数上限，含义同 compress_params::threads
+  int threads = 0;
 };
 } // namespace imgc
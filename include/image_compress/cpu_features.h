@@ -0,0 +1,39 @@
+﻿#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "compress_params.h"
+
+namespace imgc {
+// SIMD 指令集级别，x86 上依次递增；NEON 仅用于 ARM
+enum class SimdLevel { SCALAR, SSE2, SSSE3, SSE41, AVX2, AVX512BW, NEON };
+// 硬件（及操作系统）支持的最高级别，启动时检测一次
+IMAGE_COMPRESS_API SimdLevel detectSimdLevel();
+// 当前热点函数使用的级别。默认等于 detectSimdLevel()，
+// 可用环境变量 IMGC_SIMD=scalar|sse2|ssse3|sse41|avx2|avx512bw|neon 降级
+IMAGE_COMPRESS_API SimdLevel activeSimdLevel();
+// 强制使用指定级别（超过硬件支持时取硬件上限），返回实际生效的级别。
+// 用于测试，应在没有转换任务执行时调用
+IMAGE_COMPRESS_API SimdLevel setSimdLevel(SimdLevel level);
+IMAGE_COMPRESS_API const char *simdLevelName(SimdLevel level);
+} // namespace imgc
@@ -24,21 +24,65 @@ SOFTWARE.
 */
 #include "compress_params.h"
 #include "image_types.h"
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <vector>
 
 namespace imgc {
 class IMAGE_COMPRESS_API i_image_compressor {
 public:
   virtual ~i_image_compressor() = default;
-  virtual int compressMemory(const uint8_t *inputBuffer, size_t inputSize,
-                             std::vector<uint8_t> &outputBuffer,
-                             const compress_params &params) = 0;
+  virtual int64_t compressMemory(const uint8_t *inputBuffer, size_t inputSize,
+                                 std::vector<uint8_t> &outputBuffer,
+                                 const compress_params &params) = 0;
   virtual bool decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
                             ImageRGBA &outRGBA) = 0;
-  virtual int encodeFromRGBA(const ImageRGBA &rgba,
-                             std::vector<uint8_t> &outputBuffer,
-                             const compress_params &params) = 0;
+  // 带解码参数的解码；默认读取尺寸检查限制后按原尺寸解码整幅，再裁剪
+  virtual bool decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
+                            ImageRGBA &outRGBA, const decode_params &params) {
+    int w, h;
+    if (!readImageSize(inputBuffer, inputSize, w, h) ||
+        !params.limits.allowsImage(w, h) ||
+        !params.limits.allowsDecoded((unsigned long long)w * h * 4))
+      return false;
+    if (!decodeToRGBA(inputBuffer, inputSize, outRGBA))
+      return false;
+    return cropRGBA(outRGBA, params);
+  }
+  // 只读取图像尺寸；默认完整解码，各格式只解析文件头
+  virtual bool readImageSize(const uint8_t *inputBuffer, size_t inputSize,
+                             int &width, int &height) {
+    ImageRGBA tmp;
+    if (!decodeToRGBA(inputBuffer, inputSize, tmp))
+      return false;
+    width = tmp.width;
+    height = tmp.height;
+    return true;
+  }
+  virtual int64_t encodeFromRGBA(const ImageRGBA &rgba,
+                                 std::vector<uint8_t> &outputBuffer,
+                                 const compress_params &params) = 0;
+protected:
+  // 按 params 的裁剪区域原地裁剪整幅解码结果，区域与图像不相交时返回 false
+  static bool cropRGBA(ImageRGBA &img, const decode_params &params) {
+    if (params.crop_width <= 0 || params.crop_height <= 0)
+      return true;
+    int x0 = std::min(std::max(params.crop_x, 0), img.width);
+    int y0 = std::min(std::max(params.crop_y, 0), img.height);
+    int cw = std::min(params.crop_width, img.width - x0);
+    int ch = std::min(params.crop_height, img.height - y0);
+    if (cw <= 0 || ch <= 0)
+      return false;
+    for (int y = 0; y < ch; ++y)
+      std::memmove(&img.pixels[(size_t)y * cw * 4],
+                   &img.pixels[((size_t)(y0 + y) * img.width + x0) * 4],
+                   (size_t)cw * 4);
+    img.width = cw;
+    img.height = ch;
+    img.pixels.resize((size_t)cw * ch * 4);
+    return true;
+  }
 };
 } // namespace imgc
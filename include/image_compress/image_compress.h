@@ -24,9 +24,17 @@ SOFTWARE.
 */
 #include <image_compress/image_compress_version.h>
 #include <image_compress/image_converter.h>
+#include <image_compress/image_pyramid.h>
+#include <image_compress/incremental_decoder.h>
+#include <image_compress/tiled_image.h>
+#include <image_compress/image_metrics.h>
+#include <image_compress/memory_tracker.h>
+#include <image_compress/trace.h>
+#include <image_compress/cpu_features.h>
 #include <image_compress/bmp_compressor.h>
 #include <image_compress/jpeg_compressor.h>
 #include <image_compress/png_compressor.h>
+#include <image_compress/qoi_compressor.h>
 #include <image_compress/i_image_compressor.h>
 #include <image_compress/compress_params.h>
 #include <image_compress/image_types.h>
\ No newline at end of file
@@ -29,24 +29,74 @@ SOFTWARE.
 #include <vector>
 
 namespace imgc {
-enum class ImageFormat { UNKNOWN, JPEG, PNG, BMP };
+enum class ImageFormat { UNKNOWN, JPEG, PNG, BMP, QOI };
 IMAGE_COMPRESS_API ImageFormat detectImageFormat(const uint8_t *data,
                                                  size_t size);
+// 读取 JPEG（APP1 Exif）或 PNG（eXIf 块）中的 EXIF Orientation，
+// 取值 1-8；没有该标签、格式不支持或数据无效时返回 1
+IMAGE_COMPRESS_API int readExifOrientation(const uint8_t *data, size_t size);
+// 图像内容的抽样统计，供 Format::SMART 选择输出格式
+struct image_content_stats {
+  // 抽样像素中不同的 RGB 颜色数，达到 kContentMaxColors 后不再计数
+  int colors = 0;
+  // 抽样的水平相邻像素中：完全相同的比例（大块纯色，多见于截图、图表），
+  // 亮度差超过 64 的比例（文字与线条的锐利边缘）
+  double flat_ratio = 0;
+  double edge_ratio = 0;
+  // 存在不完全不透明的像素（全图检查）
+  bool has_alpha = false;
+};
+const int kContentMaxColors = 4096;
+// 抽样约 256 行、每行至多 1024 个位置统计内容，开销与图像尺寸基本无关
+IMAGE_COMPRESS_API image_content_stats analyzeImageContent(const ImageRGBA &img);
+// 按内容统计选择格式：有透明度、颜色少或大块纯色为 PNG，颜色丰富且少有
+// 纯色区域（照片）为 JPEG；无法判断时返回 AUTO，SMART 模式下两种格式并行
+// 编码并保留较小的结果
+IMAGE_COMPRESS_API compress_params::Format
+chooseOutputFormat(const image_content_stats &stats);
+// 转换接口返回输出字节数；输入超出 params.limits 时返回 kErrLimitExceeded，
+// 其他失败返回 -1
 class IMAGE_COMPRESS_API image_converter {
 public:
   image_converter() = default;
   ~image_converter() = default;
-  int convertMemory(const uint8_t *inputBuffer, size_t inputSize,
-                    std::vector<uint8_t> &outputBuffer,
-                    const compress_params &params);
-  int convertFileToFile(const std::string &inputPath,
-                        const std::string &outputPath,
-                        const compress_params &params);
-  int convertFileToMemory(const std::string &inputPath,
-                          std::vector<uint8_t> &outputBuffer,
-                          const compress_params &params);
-  int convertMemoryToFile(const uint8_t *inputBuffer, size_t inputSize,
-                          const std::string &outputPath,
-                          const compress_params &params);
+  // params.format 为 SMART 时，实际输出的格式（JPEG 或 PNG）写入
+  // chosenFormat；其他模式写入解析后的输出格式
+  int64_t convertMemory(const uint8_t *inputBuffer, size_t inputSize,
+                        std::vector<uint8_t> &outputBuffer,
+                        const compress_params &params,
+                        compress_params::Format *chosenFormat = nullptr);
+  int64_t convertFileToFile(const std::string &inputPath,
+                            const std::string &outputPath,
+                            const compress_params &params);
+  int64_t convertFileToMemory(const std::string &inputPath,
+                              std::vector<uint8_t> &outputBuffer,
+                              const compress_params &params,
+                              compress_params::Format *chosenFormat = nullptr);
+  int64_t convertMemoryToFile(const uint8_t *inputBuffer, size_t inputSize,
+                              const std::string &outputPath,
+                              const compress_params &params);
+  // 一次解码，输出多个版本（尺寸/格式各异）：
+  // JPEG 输入按最大版本选择 DCT 缩放比例解码，较小版本由次大版本级联缩放得到，
+  // 各版本并行编码。outputBuffers 与 paramsList 一一对应，失败的版本为空。
+  // 返回成功输出的版本数，解码失败返回 -1。源图像按 paramsList[0].limits
+  // 检查，超限返回 kErrLimitExceeded；各版本的输出尺寸与大小按自身限制检查。
+  // SMART 版本按各自的缩放结果选择格式，chosenFormats 与 paramsList 一一对应
+  int convertMemoryMulti(
+      const uint8_t *inputBuffer, size_t inputSize,
+      const std::vector<compress_params> &paramsList,
+      std::vector<std::vector<uint8_t>> &outputBuffers,
+      std::vector<compress_params::Format> *chosenFormats = nullptr);
+  // 超大图像转换：解码结果存入分块图像（tiled_image），常驻内存的块不超过
+  // maxResidentBytes（0 为不限；需要几何变换时由源图与结果平分），其余块
+  // 换出到 tempDir 下的内存映射临时文件。
+  // JPEG/PNG 逐行解码与编码，方向、裁剪与缩放逐块、逐行处理，内存占用取决于
+  // 常驻块预算（至少一整行块）而非图像面积；BMP/QOI 的输入与输出仍需整幅
+  // 缓冲。不支持 target_ssim 与 SMART 格式。
+  // 源图像仍按 params.limits 检查，处理大图时需相应放宽 max_pixels
+  int64_t convertTiled(const uint8_t *inputBuffer, size_t inputSize,
+                       std::vector<uint8_t> &outputBuffer,
+                       const compress_params &params, size_t maxResidentBytes,
+                       const std::string &tempDir = std::string());
 };
 } // namespace imgc
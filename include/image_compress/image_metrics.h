@@ -0,0 +1,60 @@
+﻿#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "compress_params.h"
+#include "image_types.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace imgc {
+// 图像质量指标，在亮度平面上计算：RGBA 按 BT.601 转为亮度（忽略 alpha），
+// 短边超过 256 像素时按 round(短边/256) 倍盒式下采样（SSIM 原作者推荐的
+// 做法，近似正常观看距离，也使开销与图像尺寸基本无关）。
+// SSIM 为 8x8 窗口、步长 4 的平均值，PSNR 为同一平面上的峰值信噪比（dB）
+class IMAGE_COMPRESS_API quality_reference {
+public:
+  // 预处理参考图（紧密排列的 RGBA）；与多个候选比较时参考图只处理一次。
+  // threads 为亮度转换与统计的线程数上限，0 表示全部硬件线程
+  quality_reference(const uint8_t *rgba, int width, int height,
+                    int threads = 0);
+  explicit quality_reference(const ImageRGBA &ref, int threads = 0);
+  ~quality_reference();
+  // 与同尺寸的测试图比较，尺寸不符返回 false。图像相同时 ssim 为 1，
+  // psnr 为正无穷
+  bool compare(const uint8_t *rgba, int width, int height, double &ssim,
+               double &psnr) const;
+  bool compare(const ImageRGBA &test, double &ssim, double &psnr) const;
+
+private:
+  quality_reference(const quality_reference &) = delete;
+  quality_reference &operator=(const quality_reference &) = delete;
+  struct impl;
+  impl *impl_;
+};
+// 单次比较的便捷接口；尺寸不同或图像为空时返回 -1
+IMAGE_COMPRESS_API double computeSSIM(const ImageRGBA &a, const ImageRGBA &b,
+                                      int threads = 0);
+IMAGE_COMPRESS_API double computePSNR(const ImageRGBA &a, const ImageRGBA &b,
+                                      int threads = 0);
+} // namespace imgc
@@ -0,0 +1,49 @@
+﻿#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "compress_params.h"
+#include "image_types.h"
+#include <cstdint>
+#include <vector>
+
+namespace imgc {
+class IMAGE_COMPRESS_API image_pyramid {
+public:
+  image_pyramid() = default;
+  ~image_pyramid() = default;
+  // 逐级 2x2 盒式下采样生成金字塔，每一级由上一级生成。
+  // levels[i] 尺寸为 ceil(base / 2^(i+1))，奇数边复制边缘像素；
+  // 宽高均不大于 minSize 时停止。返回生成的级数，失败返回 -1
+  int build(const ImageRGBA &base, std::vector<ImageRGBA> &levels,
+            int minSize = 1);
+  // 生成金字塔并按 params 编码每一级（忽略 params 中的输出尺寸）。
+  // 各级按组融合生成，每组生成后立即交给共享线程池编码，同时生成下一组
+  // （线程数取 params.threads）。
+  // encoded[0] 为原图（includeBase 为 true 时），其后依次为各级。
+  // 返回编码成功的级数，任一级失败返回 -1
+  int buildEncoded(const ImageRGBA &base, const compress_params &params,
+                   std::vector<std::vector<uint8_t>> &encoded,
+                   bool includeBase = true, int minSize = 1);
+};
+} // namespace imgc
@@ -22,12 +22,71 @@ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
 OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 namespace imgc {
+enum class PixelLayout { RGBA, BGRA };
 struct ImageRGBA {
   int width = 0;
   int height = 0;
   std::vector<uint8_t> pixels; // RGBA
 };
+// 引用外部缓冲的只读像素视图（不拷贝），生命周期不超过源缓冲。
+// data 指向顶行，stride 为相邻行的字节偏移，自下而上存储时为负
+struct ImageView {
+  int width = 0;
+  int height = 0;
+  ptrdiff_t stride = 0;
+  const uint8_t *data = nullptr;
+  PixelLayout layout = PixelLayout::RGBA;
+  const uint8_t *row(int y) const { return data + y * stride; }
+};
+// YUV 4:2:0 帧格式：I420 为 Y/U/V 三个平面，NV12 为 Y 平面加交错的 UV 平面
+enum class YuvFormat { I420, NV12 };
+// 引用外部缓冲的 YUV 4:2:0 只读视图（不拷贝）。色度平面尺寸为
+// ((width+1)/2, (height+1)/2)；NV12 时 planes[1] 为 UV 交错平面，planes[2] 不使用
+struct YuvView {
+  int width = 0;
+  int height = 0;
+  YuvFormat format = YuvFormat::I420;
+  const uint8_t *planes[3] = {nullptr, nullptr, nullptr};
+  ptrdiff_t strides[3] = {0, 0, 0};
+};
+// 自有存储的 YUV 4:2:0 图像，各平面紧密排列
+struct ImageYUV {
+  int width = 0;
+  int height = 0;
+  YuvFormat format = YuvFormat::I420;
+  std::vector<uint8_t> planes[3];
+  int strides[3] = {0, 0, 0};
+  YuvView view() const {
+    YuvView v;
+    v.width = width;
+    v.height = height;
+    v.format = format;
+    for (int i = 0; i < 3; ++i) {
+      v.planes[i] = planes[i].empty() ? nullptr : planes[i].data();
+      v.strides[i] = strides[i];
+    }
+    return v;
+  }
+};
+// 解码器原生的单个分量平面。h_samp/v_samp 为该分量的采样因子，
+// 分量尺寸为图像尺寸按 采样因子/最大采样因子 缩小并向上取整；
+// stride 可能大于 width（按 DCT 块补齐）
+struct ImagePlane {
+  int width = 0;
+  int height = 0;
+  int h_samp = 1;
+  int v_samp = 1;
+  int stride = 0;
+  std::vector<uint8_t> data;
+};
+// 原生分量平面集合：灰度图 1 个平面，YCbCr 图像依次为 Y/Cb/Cr
+struct ImagePlanes {
+  int width = 0;
+  int height = 0;
+  std::vector<ImagePlane> planes;
+};
 } // namespace imgc
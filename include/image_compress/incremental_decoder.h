@@ -0,0 +1,69 @@
+﻿#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "compress_params.h"
+#include "image_types.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace imgc {
+// 推送式增量解码：数据分块到达时逐块 feed，解码与接收重叠进行。
+// JPEG 使用 libjpeg 挂起式数据源，PNG 使用 libpng 渐进读取（png_process_data）；
+// BMP/QOI 缓存输入，在 finish() 时整体解码。
+// 顺序扫描的 JPEG 与非隔行 PNG 每收到足够的数据即产出若干完整的行；
+// 渐进式 JPEG 与隔行 PNG 要等全部数据到达后才有完整的行
+class IMAGE_COMPRESS_API incremental_decoder {
+public:
+  // 行回调：第 [y0, y0 + count) 行已解码完成，可从 image() 读取。
+  // 在 feed/finish 内同步调用
+  typedef std::function<void(int y0, int count)> row_callback;
+  explicit incremental_decoder(const decode_limits &limits = decode_limits());
+  ~incremental_decoder();
+  void setRowCallback(const row_callback &cb);
+  // 追加一块输入并尽可能向前解码。数据无效、格式不支持或超出限制时返回
+  // false，此后保持失败状态
+  bool feed(const uint8_t *data, size_t size);
+  // 输入结束；图像全部解码完成时返回 true（截断的数据返回 false）
+  bool finish();
+  // 文件头已解析：尺寸已知，image() 已按整幅分配
+  bool headerReady() const;
+  int width() const;
+  int height() const;
+  // 从顶部起已解码完成的行数
+  int rowsReady() const;
+  bool done() const;
+  bool failed() const;
+  // 失败原因为超出 limits，或整幅图像缓冲被内存预算拒绝
+  // （对应 image_converter 的 kErrLimitExceeded）
+  bool limitExceeded() const;
+  const ImageRGBA &image() const;
+
+private:
+  incremental_decoder(const incremental_decoder &) = delete;
+  incremental_decoder &operator=(const incremental_decoder &) = delete;
+  struct impl;
+  impl *impl_;
+};
+} // namespace imgc
@@ -23,17 +23,47 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 #include "i_image_compressor.h"
+#include "tiled_image.h"
 namespace imgc {
 class IMAGE_COMPRESS_API jpeg_compressor : public i_image_compressor {
 public:
   jpeg_compressor() = default;
   ~jpeg_compressor() = default;
-  int compressMemory(const uint8_t *inputBuffer, size_t inputSize,
-                     std::vector<uint8_t> &outputBuffer,
-                     const compress_params &params) override;
+  int64_t compressMemory(const uint8_t *inputBuffer, size_t inputSize,
+                         std::vector<uint8_t> &outputBuffer,
+                         const compress_params &params) override;
   bool decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
                     ImageRGBA &outRGBA) override;
-  int encodeFromRGBA(const ImageRGBA &rgba, std::vector<uint8_t> &outputBuffer,
-                     const compress_params &params) override;
+  bool decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
+                    ImageRGBA &outRGBA, const decode_params &params) override;
+  bool readImageSize(const uint8_t *inputBuffer, size_t inputSize, int &width,
+                     int &height) override;
+  int64_t encodeFromRGBA(const ImageRGBA &rgba,
+                         std::vector<uint8_t> &outputBuffer,
+                         const compress_params &params) override;
+  // 直接编码 YUV 4:2:0 帧（I420 / NV12），跳过 RGB 与 YCbCr 之间的两次颜色
+  // 转换。输出固定为 4:2:0 采样，忽略 jpeg_subsampling；支持裁剪与缩放
+  // （在 YUV 平面上进行）。返回输出字节数，失败返回 -1
+  int64_t encodeFromYUV(const YuvView &yuv, std::vector<uint8_t> &outputBuffer,
+                        const compress_params &params);
+  // 解码为原生 YCbCr / 灰度分量平面（jpeg_read_raw_data），不做颜色转换
+  // 与色度上采样。CMYK 等其他颜色空间或超出 limits 时返回 false
+  bool decodeToPlanes(const uint8_t *inputBuffer, size_t inputSize,
+                      ImagePlanes &outPlanes,
+                      const decode_limits &limits = decode_limits());
+  // 解码并重排为紧密排列的 I420 / NV12，非 4:2:0 的色度按区域平均重采样，
+  // 灰度图的色度填 128
+  bool decodeToYUV(const uint8_t *inputBuffer, size_t inputSize,
+                   ImageYUV &outYUV, YuvFormat format = YuvFormat::I420,
+                   const decode_limits &limits = decode_limits());
+  // 逐行解码整幅图像写入分块图像 out（按图像尺寸重新创建），不需要整幅的
+  // 像素缓冲；超出 limits 时返回 false
+  bool decodeToTiled(const uint8_t *inputBuffer, size_t inputSize,
+                     tiled_image &out,
+                     const decode_limits &limits = decode_limits());
+  // 从分块图像逐行编码整幅图像，不做方向变换、裁剪与缩放（由
+  // image_converter::convertTiled 先行完成）。返回输出字节数，失败返回 -1
+  int64_t encodeFromTiled(tiled_image &img, std::vector<uint8_t> &outputBuffer,
+                          const compress_params &params);
 };
 } // namespace imgc
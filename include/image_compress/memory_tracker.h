@@ -0,0 +1,63 @@
+﻿#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "compress_params.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace imgc {
+// 内存计量：库内缓冲（解码/缩放/行缓冲/输出）与 libjpeg、libpng 内部分配。
+// current_bytes 为调用进行中占用的字节数，缓冲移交给调用方后不再计入
+struct memory_stats {
+  uint64_t current_bytes = 0;
+  uint64_t peak_bytes = 0;
+  uint64_t allocations = 0;
+  // 被预算回调拒绝的分配次数
+  uint64_t vetoed = 0;
+};
+// 预算回调：作用域内即将分配 bytes 字节（作用域已占用 current 字节）时
+// 调用，返回 false 拒绝该次分配，相应的编解码调用失败，image_converter 返回
+// kErrLimitExceeded。只对不小于 kMemoryBudgetMinBytes 的分配询问。
+// 库派发到共享线程池的任务（并行阶段、多版本与金字塔编码）沿用发起线程的
+// 作用域，回调可能在任意工作线程上被并发调用，须自行保证线程安全
+typedef std::function<bool(size_t bytes, uint64_t current)> memory_budget_fn;
+const size_t kMemoryBudgetMinBytes = 64 * 1024;
+// 统计作用域存续期间本线程发起的库调用（含其派发到线程池的任务）分配的
+// 内存。可嵌套，内层的分配同时计入外层；作用域只能在创建它的线程上析构
+class IMAGE_COMPRESS_API memory_scope {
+public:
+  explicit memory_scope(memory_budget_fn budget = memory_budget_fn());
+  ~memory_scope();
+  memory_stats stats() const;
+
+private:
+  memory_scope(const memory_scope &) = delete;
+  memory_scope &operator=(const memory_scope &) = delete;
+  struct impl;
+  impl *impl_;
+};
+// 进程级计量：所有线程、所有作用域（及作用域之外）的库内分配
+IMAGE_COMPRESS_API memory_stats processMemoryStats();
+} // namespace imgc
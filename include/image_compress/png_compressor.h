@@ -23,17 +23,32 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 #include "i_image_compressor.h"
+#include "tiled_image.h"
 namespace imgc {
 class IMAGE_COMPRESS_API png_compressor : public i_image_compressor {
 public:
   png_compressor() = default;
   ~png_compressor() = default;
-  int compressMemory(const uint8_t *inputBuffer, size_t inputSize,
-                     std::vector<uint8_t> &outputBuffer,
-                     const compress_params &params) override;
+  int64_t compressMemory(const uint8_t *inputBuffer, size_t inputSize,
+                         std::vector<uint8_t> &outputBuffer,
+                         const compress_params &params) override;
   bool decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
                     ImageRGBA &outRGBA) override;
-  int encodeFromRGBA(const ImageRGBA &rgba, std::vector<uint8_t> &outputBuffer,
-                     const compress_params &params) override;
+  bool decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
+                    ImageRGBA &outRGBA, const decode_params &params) override;
+  bool readImageSize(const uint8_t *inputBuffer, size_t inputSize, int &width,
+                     int &height) override;
+  int64_t encodeFromRGBA(const ImageRGBA &rgba,
+                         std::vector<uint8_t> &outputBuffer,
+                         const compress_params &params) override;
+  // 逐行解码整幅图像写入分块图像 out（按图像尺寸重新创建）；隔行图像每个
+  // pass 在分块图像上就地合并，同样不需要整幅的像素缓冲
+  bool decodeToTiled(const uint8_t *inputBuffer, size_t inputSize,
+                     tiled_image &out,
+                     const decode_limits &limits = decode_limits());
+  // 从分块图像逐行编码整幅图像，不做方向变换、裁剪与缩放。返回输出字节数，
+  // 失败返回 -1
+  int64_t encodeFromTiled(tiled_image &img, std::vector<uint8_t> &outputBuffer,
+                          const compress_params &params);
 };
 } // namespace imgc
@@ -0,0 +1,71 @@
+﻿#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "compress_params.h"
+#include "image_types.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace imgc {
+// 分块存储的 RGBA 图像，用于超出内存的大图（如 100k x 100k 的扫描地图）。
+// 像素按 kTileSize 见方的块存放，块内按行连续；常驻内存的块由 LRU 管理，
+// 超出 maxResidentBytes 时最久未用的块写入内存映射的临时文件，再次访问时读回。
+// 容量至少为一整行块加一块，逐行读写时同一行的块不会被反复换出。
+// 块缓冲计入构造时所在的 memory_scope，预算拒绝时访问失败。
+// 非线程安全；块指针在访问同一图像的其他块之前有效
+class IMAGE_COMPRESS_API tiled_image {
+public:
+  enum { kTileSize = 256 };
+  // maxResidentBytes 为 0 时所有块常驻内存；tempDir 为空时使用系统临时目录
+  explicit tiled_image(size_t maxResidentBytes = 0,
+                       const std::string &tempDir = std::string());
+  ~tiled_image();
+  // 按 width*height 重新分配，像素初始为 0，原有内容与临时文件丢弃
+  bool create(int width, int height);
+  int width() const;
+  int height() const;
+  int tilesX() const;
+  int tilesY() const;
+  // 块 (tx, ty) 的像素，行距 kTileSize*4 字节；右、下边缘块超出图像的部分
+  // 不使用。writeTile 将块标记为已修改，换出时写回临时文件。
+  // 临时文件创建或映射失败、内存预算拒绝时返回 nullptr
+  const uint8_t *readTile(int tx, int ty);
+  uint8_t *writeTile(int tx, int ty);
+  // 读写第 y 行从 x 起的 count 个像素
+  bool readRow(int y, int x, int count, uint8_t *rgba);
+  bool writeRow(int y, int x, int count, const uint8_t *rgba);
+  bool fromRGBA(const ImageRGBA &img);
+  bool toRGBA(ImageRGBA &img);
+  // 当前常驻内存的块数与已写入临时文件的块数
+  size_t residentTiles() const;
+  size_t spilledTiles() const;
+
+private:
+  tiled_image(const tiled_image &) = delete;
+  tiled_image &operator=(const tiled_image &) = delete;
+  struct impl;
+  impl *impl_;
+};
+} // namespace imgc
@@ -0,0 +1,85 @@
+﻿#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "compress_params.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 流水线阶段追踪：记录各线程上文件读写、文件头解析、解码、缩放、编码的
+// 起止时间与任务编号，导出为 Chrome trace JSON（chrome://tracing、Perfetto）。
+// 仅在以 IMGC_ENABLE_TRACING 构建时记录；未开启时下列接口为空的内联函数，
+// 追踪点不产生任何代码
+namespace imgc {
+#if defined(IMGC_ENABLE_TRACING) && IMGC_ENABLE_TRACING
+// 开始记录：清空已有事件，每个线程保留最近 eventsPerThread 个事件。
+// 可在转换进行中调用，各线程在下一次记录时自行清空缓冲
+IMAGE_COMPRESS_API bool traceStart(size_t eventsPerThread = 65536);
+// 停止记录，已记录的事件保留到下一次 traceStart
+IMAGE_COMPRESS_API void traceStop();
+// 写出全部线程的事件。各线程的缓冲无锁写入，须在记录的线程空闲后调用
+IMAGE_COMPRESS_API bool traceDump(const std::string &path);
+// 当前线程的任务编号，0 为无
+IMAGE_COMPRESS_API uint64_t traceCurrentJob();
+// 作用域内本线程记录的事件标注任务编号 id；库派发到线程池的任务沿用
+// 发起线程的编号
+class IMAGE_COMPRESS_API trace_job {
+public:
+  explicit trace_job(uint64_t id);
+  ~trace_job();
+
+private:
+  trace_job(const trace_job &) = delete;
+  trace_job &operator=(const trace_job &) = delete;
+  uint64_t prev_;
+};
+// 一个阶段：构造时开始，析构时结束。name 须为静态字符串
+class IMAGE_COMPRESS_API trace_span {
+public:
+  explicit trace_span(const char *name);
+  ~trace_span();
+
+private:
+  trace_span(const trace_span &) = delete;
+  trace_span &operator=(const trace_span &) = delete;
+  const char *name_;
+  uint64_t start_;
+};
+#define IMGC_TRACE_CAT2(a, b) a##b
+#define IMGC_TRACE_CAT(a, b) IMGC_TRACE_CAT2(a, b)
+// 记录所在作用域为一个阶段
+#define IMGC_TRACE_SCOPE(name)                                                 \
+  ::imgc::trace_span IMGC_TRACE_CAT(imgcTraceSpan, __LINE__)(name)
+#else
+inline bool traceStart(size_t = 0) { return false; }
+inline void traceStop() {}
+inline bool traceDump(const std::string &) { return false; }
+inline uint64_t traceCurrentJob() { return 0; }
+class trace_job {
+public:
+  explicit trace_job(uint64_t) {}
+};
+#define IMGC_TRACE_SCOPE(name) ((void)0)
+#endif
+} // namespace imgc
@@ -22,6 +22,13 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 #include "image_compress/bmp_compressor.h"
+#include "image_compress/trace.h"
+#include "image_resize.h"
+#include "memory_account.h"
+#include "parallel_for.h"
+#include "pixel_convert.h"
+#include "size_math.h"
+#include <cstdint>
 #include <cstring>
 #include <vector>
 #include <algorithm>
@@ -68,79 +75,213 @@ static bool read_i32(const uint8_t *p, size_t size, size_t off, int32_t &v) {
   v = (int32_t)t;
   return true;
 }
-bool bmp_compressor::decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
-                                  ImageRGBA &outRGBA) {
-  if (!inputBuffer || inputSize < 54)
+// BI_RGB / BI_BITFIELDS / BI_ALPHABITFIELDS
+static const uint32_t kBiRgb = 0;
+static const uint32_t kBiBitfields = 3;
+static const uint32_t kBiAlphaBitfields = 6;
+// 32 位 BITFIELDS 掩码：内存字节序为 R,G,B,A
+static const uint32_t kMaskR = 0x000000FF;
+static const uint32_t kMaskG = 0x0000FF00;
+static const uint32_t kMaskB = 0x00FF0000;
+static const uint32_t kMaskA = 0xFF000000;
+
+struct BmpHeaderInfo {
+  uint32_t offBits;
+  int width;
+  int height;
+  bool bottomUp;
+  uint16_t bpp;
+  uint32_t compression;
+  uint32_t masks[4]; // R, G, B, A
+  size_t rowSize;
+};
+static bool parseBmpHeader(const uint8_t *p, size_t size, BmpHeaderInfo &hi) {
+  if (!p || size < 54)
     return false;
   uint16_t bfType;
-  if (!read_u16(inputBuffer, inputSize, 0, bfType))
+  if (!read_u16(p, size, 0, bfType))
     return false;
   if (bfType != 0x4D42)
     return false;
-  uint32_t bfOffBits;
-  if (!read_u32(inputBuffer, inputSize, 10, bfOffBits))
-    return false;
   uint32_t biSize;
-  if (!read_u32(inputBuffer, inputSize, 14, biSize))
-    return false;
   int32_t bw, bh;
-  if (!read_i32(inputBuffer, inputSize, 18, bw))
-    return false;
-  if (!read_i32(inputBuffer, inputSize, 22, bh))
-    return false;
   uint16_t planes;
-  if (!read_u16(inputBuffer, inputSize, 26, planes))
+  if (!read_u32(p, size, 10, hi.offBits) || !read_u32(p, size, 14, biSize) ||
+      !read_i32(p, size, 18, bw) || !read_i32(p, size, 22, bh) ||
+      !read_u16(p, size, 26, planes) || !read_u16(p, size, 28, hi.bpp) ||
+      !read_u32(p, size, 30, hi.compression))
     return false;
-  uint16_t bpp;
-  if (!read_u16(inputBuffer, inputSize, 28, bpp))
+  if (planes != 1 || bw <= 0 || bh == 0 || bh == INT32_MIN)
     return false;
-  uint32_t comp;
-  if (!read_u32(inputBuffer, inputSize, 30, comp))
+  hi.width = bw;
+  hi.height = bh >= 0 ? bh : -bh;
+  hi.bottomUp = bh >= 0;
+  if (hi.compression == kBiRgb) {
+    if (!(hi.bpp == 24 || hi.bpp == 32))
+      return false;
+    // BI_RGB 的 32 位按 BGRA 读取
+    hi.masks[0] = kMaskB;
+    hi.masks[1] = kMaskG;
+    hi.masks[2] = kMaskR;
+    hi.masks[3] = hi.bpp == 32 ? kMaskA : 0;
+  } else if (hi.compression == kBiBitfields ||
+             hi.compression == kBiAlphaBitfields) {
+    if (hi.bpp != 32)
+      return false;
+    // 掩码紧跟 40 字节信息头（V2 及以上头部中位置相同）
+    if (!read_u32(p, size, 54, hi.masks[0]) ||
+        !read_u32(p, size, 58, hi.masks[1]) ||
+        !read_u32(p, size, 62, hi.masks[2]))
+      return false;
+    hi.masks[3] = 0;
+    if ((biSize >= 56 || hi.compression == kBiAlphaBitfields) &&
+        !read_u32(p, size, 66, hi.masks[3]))
+      return false;
+  } else {
     return false;
-  if (planes != 1 || comp != 0)
+  }
+  hi.rowSize = (((size_t)hi.width * hi.bpp / 8) + 3) / 4 * 4;
+  // 像素区必须位于文件头之后且完整落在输入内（末行允许省略行尾填充）
+  size_t lastRow = (size_t)hi.width * (hi.bpp / 8);
+  if (hi.offBits < (size_t)biSize + 14 || hi.offBits > size ||
+      size - hi.offBits < lastRow ||
+      (size - hi.offBits - lastRow) / hi.rowSize < (size_t)hi.height - 1)
     return false;
-  int width = bw;
-  int height = bh >= 0 ? bh : -bh;
-  bool bottom_up = bh >= 0;
-  if (!(bpp == 24 || bpp == 32))
+  return true;
+}
+// 8 位宽的通道掩码转为字节下标，不支持的掩码返回 -1
+static int maskByte(uint32_t m) {
+  switch (m) {
+  case 0x000000FF:
+    return 0;
+  case 0x0000FF00:
+    return 1;
+  case 0x00FF0000:
+    return 2;
+  case 0xFF000000:
+    return 3;
+  default:
+    return -1;
+  }
+}
+bool bmp_compressor::decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
+                                  ImageRGBA &outRGBA) {
+  return decodeToRGBA(inputBuffer, inputSize, outRGBA, decode_params());
+}
+bool bmp_compressor::decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
+                                  ImageRGBA &outRGBA,
+                                  const decode_params &params) {
+  IMGC_TRACE_SCOPE("decode");
+  BmpHeaderInfo hi;
+  if (!parseBmpHeader(inputBuffer, inputSize, hi) ||
+      !params.limits.allowsImage(hi.width, hi.height))
+    return false;
+  // 裁剪区域，截到图像范围内；未压缩格式直接定位区域内的行和列
+  int rx = 0, ry = 0;
+  int width = hi.width;
+  int height = hi.height;
+  if (params.crop_width > 0 && params.crop_height > 0) {
+    rx = std::max(params.crop_x, 0);
+    ry = std::max(params.crop_y, 0);
+    if (rx >= hi.width || ry >= hi.height)
+      return false;
+    width = std::min(params.crop_width, hi.width - rx);
+    height = std::min(params.crop_height, hi.height - ry);
+  }
+  bool bottom_up = hi.bottomUp;
+  int ri = 0, gi = 0, bi = 0, ai = -1;
+  if (hi.bpp == 32) {
+    ri = maskByte(hi.masks[0]);
+    gi = maskByte(hi.masks[1]);
+    bi = maskByte(hi.masks[2]);
+    ai = hi.masks[3] ? maskByte(hi.masks[3]) : -1;
+    if (ri < 0 || gi < 0 || bi < 0 || (hi.masks[3] && ai < 0))
+      return false;
+  }
+  size_t bytes;
+  memory_reservation hold;
+  if (!imageBytes(width, height, 4, bytes) ||
+      !params.limits.allowsDecoded(bytes) || !hold.reserve(bytes))
     return false;
   outRGBA.width = width;
   outRGBA.height = height;
-  outRGBA.pixels.assign((size_t)width * height * 4, 255);
-  const uint8_t *pix = inputBuffer + bfOffBits;
-  if (bpp == 24) {
-    size_t rowSrc = ((width * 3 + 3) / 4) * 4;
-    for (int y = 0; y < height; ++y) {
-      int sy = bottom_up ? (height - 1 - y) : y;
-      const uint8_t *src = pix + (size_t)sy * rowSrc;
+  outRGBA.pixels.assign(bytes, 255);
+  const uint8_t *pix = inputBuffer + hi.offBits;
+  size_t rowSrc = hi.rowSize;
+  // 各行独立转换，按行带并行
+  parallelFor(height, parallelGrain((size_t)width * 4), params.threads,
+              [&](size_t b, size_t e) {
+    for (int y = (int)b; y < (int)e; ++y) {
+      int sy = bottom_up ? (hi.height - 1 - (ry + y)) : ry + y;
+      const uint8_t *src =
+          pix + (size_t)sy * rowSrc + (size_t)rx * (hi.bpp / 8);
       uint8_t *dst = &outRGBA.pixels[(size_t)y * width * 4];
-      for (int x = 0; x < width; ++x) {
-        dst[x * 4 + 2] = src[x * 3 + 0];
-        dst[x * 4 + 1] = src[x * 3 + 1];
-        dst[x * 4 + 0] = src[x * 3 + 2];
-        dst[x * 4 + 3] = 255;
+      if (hi.bpp == 24) {
+        convertPixels<layout_bgr, layout_rgba>(src, dst, width);
+      } else if (ri == 2 && gi == 1 && bi == 0 && ai == 3) {
+        convertPixels<layout_bgra, layout_rgba>(src, dst, width);
+      } else if (ri == 0 && gi == 1 && bi == 2 && ai == 3) {
+        std::memcpy(dst, src, (size_t)width * 4);
+      } else {
+        for (int x = 0; x < width; ++x) {
+          const uint8_t *s = src + x * 4;
+          dst[x * 4 + 0] = s[ri];
+          dst[x * 4 + 1] = s[gi];
+          dst[x * 4 + 2] = s[bi];
+          dst[x * 4 + 3] = ai >= 0 ? s[ai] : 255;
+        }
       }
     }
+  });
+  return true;
+}
+bool bmp_compressor::readImageSize(const uint8_t *inputBuffer,
+                                   size_t inputSize, int &width, int &height) {
+  IMGC_TRACE_SCOPE("header");
+  BmpHeaderInfo hi;
+  if (!parseBmpHeader(inputBuffer, inputSize, hi))
+    return false;
+  width = hi.width;
+  height = hi.height;
+  return true;
+}
+bool bmp_compressor::decodeView(const uint8_t *inputBuffer, size_t inputSize,
+                                ImageView &outView) {
+  IMGC_TRACE_SCOPE("decode");
+  BmpHeaderInfo hi;
+  if (!parseBmpHeader(inputBuffer, inputSize, hi) || hi.bpp != 32)
+    return false;
+  PixelLayout layout;
+  if (hi.masks[0] == kMaskR && hi.masks[1] == kMaskG && hi.masks[2] == kMaskB &&
+      hi.masks[3] == kMaskA)
+    layout = PixelLayout::RGBA;
+  else if (hi.masks[0] == kMaskB && hi.masks[1] == kMaskG &&
+           hi.masks[2] == kMaskR && hi.masks[3] == kMaskA)
+    layout = PixelLayout::BGRA;
+  else
+    return false;
+  // 视图直接引用输入缓冲，像素数据必须完整
+  size_t payload = hi.rowSize * (size_t)hi.height;
+  if (hi.offBits > inputSize || payload > inputSize - hi.offBits)
+    return false;
+  const uint8_t *pix = inputBuffer + hi.offBits;
+  outView.width = hi.width;
+  outView.height = hi.height;
+  outView.layout = layout;
+  if (hi.bottomUp) {
+    outView.data = pix + (size_t)(hi.height - 1) * hi.rowSize;
+    outView.stride = -(ptrdiff_t)hi.rowSize;
   } else {
-    size_t rowSrc = (size_t)width * 4;
-    for (int y = 0; y < height; ++y) {
-      int sy = bottom_up ? (height - 1 - y) : y;
-      const uint8_t *src = pix + (size_t)sy * rowSrc;
-      uint8_t *dst = &outRGBA.pixels[(size_t)y * width * 4];
-      for (int x = 0; x < width; ++x) {
-        dst[x * 4 + 2] = src[x * 4 + 0];
-        dst[x * 4 + 1] = src[x * 4 + 1];
-        dst[x * 4 + 0] = src[x * 4 + 2];
-        dst[x * 4 + 3] = src[x * 4 + 3];
-      }
-    }
+    outView.data = pix;
+    outView.stride = (ptrdiff_t)hi.rowSize;
   }
   return true;
 }
-int bmp_compressor::encodeFromRGBA(const ImageRGBA &rgba,
-                                   std::vector<uint8_t> &outputBuffer,
-                                   const compress_params &params) {
-  if (rgba.width <= 0 || rgba.height <= 0)
+int64_t bmp_compressor::encodeFromRGBA(const ImageRGBA &rgba,
+                                       std::vector<uint8_t> &outputBuffer,
+                                       const compress_params &params) {
+  IMGC_TRACE_SCOPE("encode");
+  if (!validRGBA(rgba))
     return -1;
 
   int w = rgba.width;
@@ -149,110 +290,98 @@ int bmp_compressor::encodeFromRGBA(const ImageRGBA &rgba,
   const uint8_t *pixelData = rgba.pixels.data();
   std::vector<uint8_t> scaledPixels; // 如果缩放，这里会存缩放结果
 
-  // 检查是否需要缩放
-  if (params.output_width > 0 && params.output_height > 0 &&
-      (params.output_width != w || params.output_height != h)) {
-    int newW = params.output_width;
-    int newH = params.output_height;
-    scaledPixels.resize((size_t)newW * newH * 4);
-
-    if (params.resize_algo == compress_params::ResizeAlgo::NEAREST) {
-      // 最近邻缩放
-      for (int y = 0; y < newH; ++y) {
-        int srcY = y * h / newH;
-        for (int x = 0; x < newW; ++x) {
-          int srcX = x * w / newW;
-          const uint8_t *srcPix = &rgba.pixels[(size_t)(srcY * w + srcX) * 4];
-          uint8_t *dstPix = &scaledPixels[(size_t)(y * newW + x) * 4];
-          dstPix[0] = srcPix[0];
-          dstPix[1] = srcPix[1];
-          dstPix[2] = srcPix[2];
-          dstPix[3] = srcPix[3];
-        }
-      }
-    } else if (params.resize_algo == compress_params::ResizeAlgo::BILINEAR) {
-      // 双线性插值缩放
-      for (int y = 0; y < newH; ++y) {
-        float srcY = (y + 0.5f) * h / newH - 0.5f;
-        int y0 = std::max(0, (int)floor(srcY));
-        int y1 = std::min(h - 1, y0 + 1);
-        float wy = srcY - y0;
-
-        for (int x = 0; x < newW; ++x) {
-          float srcX = (x + 0.5f) * w / newW - 0.5f;
-          int x0 = std::max(0, (int)floor(srcX));
-          int x1 = std::min(w - 1, x0 + 1);
-          float wx = srcX - x0;
-
-          const uint8_t *p00 = &rgba.pixels[(size_t)(y0 * w + x0) * 4];
-          const uint8_t *p01 = &rgba.pixels[(size_t)(y0 * w + x1) * 4];
-          const uint8_t *p10 = &rgba.pixels[(size_t)(y1 * w + x0) * 4];
-          const uint8_t *p11 = &rgba.pixels[(size_t)(y1 * w + x1) * 4];
-
-          uint8_t *dstPix = &scaledPixels[(size_t)(y * newW + x) * 4];
-          for (int c = 0; c < 4; ++c) {
-            float top = p00[c] * (1 - wx) + p01[c] * wx;
-            float bottom = p10[c] * (1 - wx) + p11[c] * wx;
-            dstPix[c] = (uint8_t)(top * (1 - wy) + bottom * wy + 0.5f);
-          }
-        }
-      }
-    }
-
-    w = newW;
-    h = newH;
-    pixelData = scaledPixels.data();
-  }
+  // 裁剪与缩放
+  memory_reservation hold;
+  pixelData = applyGeometry(params, pixelData, w, h, scaledPixels, &hold);
+  if (!pixelData)
+    return -1;
 
   // --------------------
   // 写 BMP 数据
   // --------------------
-  size_t rowSize = ((w * 3 + 3) / 4) * 4; // 每行字节数对齐到4字节
-  size_t pixelSize = rowSize * h;
-  size_t fileSize = 14 + 40 + pixelSize;
-  outputBuffer.resize(fileSize, 0);
+  bool bitfields =
+      params.bmp_pixel_format == compress_params::BmpPixelFormat::RGBA32_BITFIELDS;
+  uint16_t bpp =
+      params.bmp_pixel_format == compress_params::BmpPixelFormat::BGR24 ? 24 : 32;
+  uint32_t biSize = bitfields ? 108 : 40; // BITMAPV4HEADER 可携带 alpha 掩码
+  size_t rowSize = (((size_t)w * bpp / 8) + 3) / 4 * 4; // 每行字节数对齐到4字节
+  size_t pixelSize;
+  // 文件头以 32 位记录文件与像素区大小，超出 4GB 的 BMP 无法表示
+  if (!checkedMul(rowSize, (size_t)h, pixelSize) ||
+      (uint64_t)pixelSize + 14 + biSize > 0xFFFFFFFFull)
+    return -1;
+  size_t fileSize = 14 + biSize + pixelSize;
+  if (!hold.reserve(fileSize))
+    return -1;
+  outputBuffer.assign(14 + biSize, 0);
+  outputBuffer.resize(fileSize); // 像素区随后被完整覆盖
 
   uint8_t *out = outputBuffer.data();
   out[0] = 'B';
   out[1] = 'M';
   uint32_t bfSize = (uint32_t)fileSize;
   std::memcpy(out + 2, &bfSize, 4);
-  uint32_t bfOff = 14 + 40;
+  uint32_t bfOff = 14 + biSize;
   std::memcpy(out + 10, &bfOff, 4);
-  uint32_t biSize = 40;
   std::memcpy(out + 14, &biSize, 4);
   std::memcpy(out + 18, &w, 4);
-  int32_t bh = h;
+  int32_t bh = params.bmp_top_down ? -h : h;
   std::memcpy(out + 22, &bh, 4);
   uint16_t planes = 1;
   std::memcpy(out + 26, &planes, 2);
-  uint16_t bpp = 24;
   std::memcpy(out + 28, &bpp, 2);
-  uint32_t comp = 0;
+  uint32_t comp = bitfields ? kBiBitfields : kBiRgb;
   std::memcpy(out + 30, &comp, 4);
-  std::memcpy(out + 34, &pixelSize, 4);
+  uint32_t biSizeImage = (uint32_t)pixelSize;
+  std::memcpy(out + 34, &biSizeImage, 4);
+  if (bitfields) {
+    uint32_t masks[4] = {kMaskR, kMaskG, kMaskB, kMaskA};
+    std::memcpy(out + 54, masks, 16);
+    uint32_t csType = 0x73524742; // LCS_sRGB
+    std::memcpy(out + 70, &csType, 4);
+  }
 
   uint8_t *pix = out + bfOff;
-  for (int y = 0; y < h; ++y) {
-    uint8_t *row = pix + (size_t)y * rowSize;
-    const uint8_t *src = &pixelData[(size_t)(h - 1 - y) * w * 4];
-    for (int x = 0; x < w; ++x) {
-      row[x * 3 + 0] = src[x * 4 + 2]; // B
-      row[x * 3 + 1] = src[x * 4 + 1]; // G
-      row[x * 3 + 2] = src[x * 4 + 0]; // R
-    }
+  if (bitfields && params.bmp_top_down) {
+    // 内存布局与 RGBA 完全一致，整块拷贝
+    std::memcpy(pix, pixelData, pixelSize);
+  } else {
+    parallelFor(h, parallelGrain((size_t)w * 4), params.threads,
+                [&](size_t b, size_t e) {
+      for (int y = (int)b; y < (int)e; ++y) {
+        uint8_t *row = pix + (size_t)y * rowSize;
+        int sy = params.bmp_top_down ? y : h - 1 - y;
+        const uint8_t *src = &pixelData[(size_t)sy * w * 4];
+        if (bitfields) {
+          std::memcpy(row, src, (size_t)w * 4);
+        } else if (bpp == 32) {
+          convertPixels<layout_rgba, layout_bgra>(src, row, w);
+        } else {
+          convertPixels<layout_rgba, layout_bgr>(src, row, w);
+          // 行尾填充字节清零
+          std::memset(row + (size_t)w * 3, 0, rowSize - (size_t)w * 3);
+        }
+      }
+    });
   }
 
-  return (int)outputBuffer.size();
+  return (int64_t)outputBuffer.size();
 }
 
 
-int bmp_compressor::compressMemory(const uint8_t *inputBuffer, size_t inputSize,
-                                   std::vector<uint8_t> &outputBuffer,
-                                   const compress_params &params) {
+int64_t bmp_compressor::compressMemory(const uint8_t *inputBuffer,
+                                       size_t inputSize,
+                                       std::vector<uint8_t> &outputBuffer,
+                                       const compress_params &params) {
   ImageRGBA rgba;
-  if (!decodeToRGBA(inputBuffer, inputSize, rgba))
-    return -1;
-  return encodeFromRGBA(rgba, outputBuffer, params);
+  compress_params encodeParams;
+  int r = decodeForParams(*this, inputBuffer, inputSize, params, rgba,
+                          encodeParams);
+  if (r < 0)
+    return r;
+  // 解码结果在编码期间一直占用
+  memory_reservation hold;
+  hold.add(rgba.pixels.capacity());
+  return encodeFromRGBA(rgba, outputBuffer, encodeParams);
 }
 } // namespace imgc
@@ -0,0 +1,58 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "compressor_factory.h"
+#include "image_compress/bmp_compressor.h"
+#include "image_compress/jpeg_compressor.h"
+#include "image_compress/png_compressor.h"
+#include "image_compress/qoi_compressor.h"
+namespace imgc {
+std::unique_ptr<i_image_compressor> makeEncoder(compress_params::Format f) {
+  switch (f) {
+  case compress_params::Format::JPEG:
+    return std::make_unique<jpeg_compressor>();
+  case compress_params::Format::PNG:
+    return std::make_unique<png_compressor>();
+  case compress_params::Format::BMP:
+    return std::make_unique<bmp_compressor>();
+  case compress_params::Format::QOI:
+    return std::make_unique<qoi_compressor>();
+  default:
+    return nullptr;
+  }
+}
+std::unique_ptr<i_image_compressor> makeDecoder(ImageFormat f) {
+  switch (f) {
+  case ImageFormat::JPEG:
+    return std::make_unique<jpeg_compressor>();
+  case ImageFormat::PNG:
+    return std::make_unique<png_compressor>();
+  case ImageFormat::BMP:
+    return std::make_unique<bmp_compressor>();
+  case ImageFormat::QOI:
+    return std::make_unique<qoi_compressor>();
+  default:
+    return nullptr;
+  }
+}
+} // namespace imgc
@@ -22,13 +22,21 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 #include "image_compress/image_converter.h"
-#include "image_compress/bmp_compressor.h"
+#include "compressor_factory.h"
+#include "image_resize.h"
+#include "memory_account.h"
+#include "parallel_for.h"
+#include "simd/kernels.h"
+#include "size_math.h"
 #include "image_compress/jpeg_compressor.h"
 #include "image_compress/png_compressor.h"
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <memory>
+#include <unordered_set>
 namespace imgc {
 ImageFormat detectImageFormat(const uint8_t *data, size_t size) {
   if (!data || size < 3)
@@ -41,68 +49,256 @@ ImageFormat detectImageFormat(const uint8_t *data, size_t size) {
     return ImageFormat::PNG;
   if (size >= 2 && data[0] == 'B' && data[1] == 'M')
     return ImageFormat::BMP;
+  if (size >= 4 && data[0] == 'q' && data[1] == 'o' && data[2] == 'i' &&
+      data[3] == 'f')
+    return ImageFormat::QOI;
   return ImageFormat::UNKNOWN;
 }
-static std::unique_ptr<i_image_compressor> makeComp(compress_params::Format f) {
-  switch (f) {
-  case compress_params::Format::JPEG:
-    return std::make_unique<jpeg_compressor>();
-  case compress_params::Format::PNG:
-    return std::make_unique<png_compressor>();
-  case compress_params::Format::BMP:
-    return std::make_unique<bmp_compressor>();
-  default:
-    return nullptr;
+// 在 TIFF 结构（EXIF 载荷）的 IFD0 中查找 Orientation（0x0112）
+static int tiffOrientation(const uint8_t *t, size_t n) {
+  if (n < 8)
+    return 1;
+  bool le = t[0] == 'I' && t[1] == 'I';
+  if (!le && !(t[0] == 'M' && t[1] == 'M'))
+    return 1;
+  auto u16 = [&](size_t o) -> uint32_t {
+    return le ? (uint32_t)(t[o] | t[o + 1] << 8)
+              : (uint32_t)(t[o] << 8 | t[o + 1]);
+  };
+  auto u32 = [&](size_t o) -> uint32_t {
+    return le ? (u16(o) | u16(o + 2) << 16) : (u16(o) << 16 | u16(o + 2));
+  };
+  if (u16(2) != 42)
+    return 1;
+  size_t ifd = u32(4);
+  if (ifd > n - 2)
+    return 1;
+  size_t count = u16(ifd);
+  for (size_t i = 0; i < count; ++i) {
+    size_t e = ifd + 2 + i * 12;
+    if (e + 12 > n)
+      break;
+    if (u16(e) != 0x0112)
+      continue;
+    // 类型须为 SHORT，值内联在条目中
+    uint32_t v = u16(e + 2) == 3 ? u16(e + 8) : 0;
+    return (v >= 1 && v <= 8) ? (int)v : 1;
   }
+  return 1;
 }
-int image_converter::convertMemory(const uint8_t *inputBuffer, size_t inputSize,
-                                   std::vector<uint8_t> &outputBuffer,
-                                   const compress_params &params) {
+int readExifOrientation(const uint8_t *data, size_t size) {
+  ImageFormat fmt = detectImageFormat(data, size);
+  if (fmt == ImageFormat::JPEG) {
+    // 逐个跳过标记段，直到 SOS
+    size_t pos = 2;
+    while (pos + 4 <= size) {
+      if (data[pos] != 0xFF)
+        return 1;
+      uint8_t m = data[pos + 1];
+      if (m == 0xFF) {
+        ++pos;
+        continue;
+      }
+      if (m == 0xDA || m == 0xD9)
+        return 1;
+      size_t len = (size_t)data[pos + 2] << 8 | data[pos + 3];
+      if (len < 2 || len > size - pos - 2)
+        return 1;
+      const uint8_t *seg = data + pos + 4;
+      if (m == 0xE1 && len >= 8 && std::memcmp(seg, "Exif\0\0", 6) == 0)
+        return tiffOrientation(seg + 6, len - 8);
+      pos += 2 + len;
+    }
+  } else if (fmt == ImageFormat::PNG) {
+    // eXIf 块必须位于 IDAT 之前
+    size_t pos = 8;
+    while (pos + 8 <= size) {
+      size_t len = (size_t)data[pos] << 24 | (size_t)data[pos + 1] << 16 |
+                   (size_t)data[pos + 2] << 8 | data[pos + 3];
+      const uint8_t *type = data + pos + 4;
+      if (len > size - pos - 8)
+        return 1;
+      if (std::memcmp(type, "eXIf", 4) == 0)
+        return tiffOrientation(data + pos + 8, len);
+      if (std::memcmp(type, "IDAT", 4) == 0)
+        return 1;
+      pos += 12 + len;
+    }
+  }
+  return 1;
+}
+image_content_stats analyzeImageContent(const ImageRGBA &img) {
+  image_content_stats st;
+  int w = img.width, h = img.height;
+  if (!validRGBA(img))
+    return st;
+  st.has_alpha = kernels().min_alpha(img.pixels.data(), (size_t)w * h) < 255;
+  int stepY = std::max(1, h / 256), stepX = std::max(1, w / 1024);
+  std::unordered_set<uint32_t> colors;
+  size_t pairs = 0, flat = 0, edges = 0;
+  for (int y = 0; y < h; y += stepY) {
+    const uint8_t *row = &img.pixels[(size_t)y * w * 4];
+    for (int x = 0; x < w; x += stepX) {
+      const uint8_t *p = row + (size_t)x * 4;
+      if ((int)colors.size() < kContentMaxColors)
+        colors.insert((uint32_t)p[0] | (uint32_t)p[1] << 8 |
+                      (uint32_t)p[2] << 16);
+      if (x + 1 >= w)
+        continue;
+      // 与右侧紧邻的像素比较，不受抽样步长影响
+      const uint8_t *q = p + 4;
+      ++pairs;
+      if (p[0] == q[0] && p[1] == q[1] && p[2] == q[2]) {
+        ++flat;
+        continue;
+      }
+      int d = (77 * (p[0] - q[0]) + 150 * (p[1] - q[1]) + 29 * (p[2] - q[2])) /
+              256;
+      if (d > 64 || d < -64)
+        ++edges;
+    }
+  }
+  st.colors = (int)colors.size();
+  if (pairs > 0) {
+    st.flat_ratio = (double)flat / pairs;
+    st.edge_ratio = (double)edges / pairs;
+  }
+  return st;
+}
+compress_params::Format chooseOutputFormat(const image_content_stats &s) {
+  // JPEG 不能保存透明度；调色板量级的颜色数与大块纯色用 PNG 无损且更小
+  if (s.has_alpha || s.colors <= 256 || s.flat_ratio >= 0.6 ||
+      (s.flat_ratio >= 0.3 && s.edge_ratio >= 0.02))
+    return compress_params::Format::PNG;
+  // 颜色丰富、相邻像素几乎总有差异：照片类内容
+  if (s.colors >= kContentMaxColors && s.flat_ratio < 0.15)
+    return compress_params::Format::JPEG;
+  return compress_params::Format::AUTO;
+}
+static compress_params::Format resolveFormat(ImageFormat inFmt,
+                                             compress_params::Format f) {
+  if (f != compress_params::Format::AUTO)
+    return f;
+  if (inFmt == ImageFormat::JPEG)
+    return compress_params::Format::JPEG;
+  if (inFmt == ImageFormat::PNG)
+    return compress_params::Format::PNG;
+  if (inFmt == ImageFormat::BMP)
+    return compress_params::Format::BMP;
+  if (inFmt == ImageFormat::QOI)
+    return compress_params::Format::QOI;
+  return compress_params::Format::AUTO;
+}
+// 编码结果超出 max_output_bytes 时丢弃输出并返回 kErrLimitExceeded
+static int64_t checkOutputLimit(const compress_params &params,
+                                std::vector<uint8_t> &outputBuffer,
+                                int64_t size) {
+  if (size > 0 && !params.limits.allowsOutput((unsigned long long)size)) {
+    outputBuffer.clear();
+    return kErrLimitExceeded;
+  }
+  return size;
+}
+// SMART 模式编码：按内容选择 JPEG 或 PNG，无法判断时两种格式并行编码，
+// 保留较小的结果。chosen 为实际输出的格式
+static int64_t encodeSmart(const ImageRGBA &img, std::vector<uint8_t> &out,
+                           const compress_params &params,
+                           compress_params::Format &chosen) {
+  compress_params::Format f = chooseOutputFormat(analyzeImageContent(img));
+  if (f != compress_params::Format::AUTO) {
+    chosen = f;
+    return makeEncoder(f)->encodeFromRGBA(img, out, params);
+  }
+  const compress_params::Format fmts[2] = {compress_params::Format::JPEG,
+                                           compress_params::Format::PNG};
+  std::vector<uint8_t> bufs[2];
+  int64_t sizes[2] = {-1, -1};
+  parallelFor(2, 1, params.threads, [&](size_t b, size_t e) {
+    for (size_t i = b; i < e; ++i)
+      sizes[i] = makeEncoder(fmts[i])->encodeFromRGBA(img, bufs[i], params);
+  });
+  int pick = sizes[0] > 0 && (sizes[1] <= 0 || sizes[0] <= sizes[1]) ? 0 : 1;
+  chosen = fmts[pick];
+  out.swap(bufs[pick]);
+  return sizes[pick];
+}
+static int64_t convertBuffer(const uint8_t *inputBuffer, size_t inputSize,
+                             std::vector<uint8_t> &outputBuffer,
+                             const compress_params &params,
+                             compress_params::Format *chosenFormat) {
   if (!inputBuffer || inputSize == 0)
     return -1;
   ImageFormat inFmt = detectImageFormat(inputBuffer, inputSize);
-  compress_params::Format outFmt = params.format;
-  if (outFmt == compress_params::Format::AUTO) {
-    if (inFmt == ImageFormat::JPEG)
-      outFmt = compress_params::Format::JPEG;
-    else if (inFmt == ImageFormat::PNG)
-      outFmt = compress_params::Format::PNG;
-    else if (inFmt == ImageFormat::BMP)
-      outFmt = compress_params::Format::BMP;
-    else
+  if (params.format == compress_params::Format::SMART) {
+    auto dec = makeDecoder(inFmt);
+    if (!dec)
       return -1;
+    ImageRGBA rgba;
+    compress_params encodeParams;
+    int r = decodeForParams(*dec, inputBuffer, inputSize, params, rgba,
+                            encodeParams);
+    if (r < 0)
+      return r;
+    memory_reservation hold;
+    hold.add(rgba.pixels.capacity());
+    compress_params::Format f;
+    int64_t size = encodeSmart(rgba, outputBuffer, encodeParams, f);
+    if (chosenFormat)
+      *chosenFormat = f;
+    return checkOutputLimit(params, outputBuffer, size);
   }
+  compress_params::Format outFmt = resolveFormat(inFmt, params.format);
+  if (outFmt == compress_params::Format::AUTO)
+    return -1;
+  if (chosenFormat)
+    *chosenFormat = outFmt;
   bool needConvert =
       (inFmt == ImageFormat::JPEG && outFmt != compress_params::Format::JPEG) ||
       (inFmt == ImageFormat::PNG && outFmt != compress_params::Format::PNG) ||
-      (inFmt == ImageFormat::BMP && outFmt != compress_params::Format::BMP);
+      (inFmt == ImageFormat::BMP && outFmt != compress_params::Format::BMP) ||
+      (inFmt == ImageFormat::QOI && outFmt != compress_params::Format::QOI);
   if (needConvert) {
-    std::unique_ptr<i_image_compressor> inComp;
-    if (inFmt == ImageFormat::JPEG)
-      inComp = std::make_unique<jpeg_compressor>();
-    else if (inFmt == ImageFormat::PNG)
-      inComp = std::make_unique<png_compressor>();
-    else if (inFmt == ImageFormat::BMP)
-      inComp = std::make_unique<bmp_compressor>();
-    else
+    auto inComp = makeDecoder(inFmt);
+    if (!inComp)
       return -1;
+    // 只解码参与输出的区域
     ImageRGBA rgba;
-    if (!inComp->decodeToRGBA(inputBuffer, inputSize, rgba))
-      return -1;
-    auto outComp = makeComp(outFmt);
+    compress_params encodeParams;
+    int r = decodeForParams(*inComp, inputBuffer, inputSize, params, rgba,
+                            encodeParams);
+    if (r < 0)
+      return r;
+    memory_reservation hold;
+    hold.add(rgba.pixels.capacity());
+    auto outComp = makeEncoder(outFmt);
     if (!outComp)
       return -1;
-    return outComp->encodeFromRGBA(rgba, outputBuffer, params);
+    return checkOutputLimit(
+        params, outputBuffer,
+        outComp->encodeFromRGBA(rgba, outputBuffer, encodeParams));
   } else {
-    auto comp = makeComp(outFmt);
+    auto comp = makeEncoder(outFmt);
     if (!comp)
       return -1;
-    return comp->compressMemory(inputBuffer, inputSize, outputBuffer, params);
+    return checkOutputLimit(
+        params, outputBuffer,
+        comp->compressMemory(inputBuffer, inputSize, outputBuffer, params));
   }
 }
-int image_converter::convertFileToFile(const std::string &inputPath,
-                                       const std::string &outputPath,
-                                       const compress_params &params) {
+int64_t image_converter::convertMemory(const uint8_t *inputBuffer,
+                                       size_t inputSize,
+                                       std::vector<uint8_t> &outputBuffer,
+                                       const compress_params &params,
+                                       compress_params::Format *chosenFormat) {
+  // 失败期间发生过预算拒绝时归为超限
+  uint64_t vetoes = memoryVetoCount();
+  int64_t r =
+      convertBuffer(inputBuffer, inputSize, outputBuffer, params, chosenFormat);
+  return r == -1 && memoryVetoCount() != vetoes ? kErrLimitExceeded : r;
+}
+int64_t image_converter::convertFileToFile(const std::string &inputPath,
+                                           const std::string &outputPath,
+                                           const compress_params &params) {
   std::ifstream ifs(inputPath, std::ios::binary);
   if (!ifs) {
     std::cerr << "Open input failed: " << inputPath << std::endl;
@@ -112,7 +308,7 @@ int image_converter::convertFileToFile(const std::string &inputPath,
                           std::istreambuf_iterator<char>());
   ifs.close();
   std::vector<uint8_t> out;
-  int s = convertMemory(in.data(), in.size(), out, params);
+  int64_t s = convertMemory(in.data(), in.size(), out, params);
   if (s < 0)
     return s;
   std::ofstream ofs(outputPath, std::ios::binary);
@@ -124,9 +320,9 @@ int image_converter::convertFileToFile(const std::string &inputPath,
   ofs.close();
   return s;
 }
-int image_converter::convertFileToMemory(const std::string &inputPath,
-                                         std::vector<uint8_t> &outputBuffer,
-                                         const compress_params &params) {
+int64_t image_converter::convertFileToMemory(
+    const std::string &inputPath, std::vector<uint8_t> &outputBuffer,
+    const compress_params &params, compress_params::Format *chosenFormat) {
   std::ifstream ifs(inputPath, std::ios::binary);
   if (!ifs) {
     std::cerr << "Open input failed: " << inputPath << std::endl;
@@ -135,14 +331,15 @@ int image_converter::convertFileToMemory(const std::string &inputPath,
   std::vector<uint8_t> in((std::istreambuf_iterator<char>(ifs)),
                           std::istreambuf_iterator<char>());
   ifs.close();
-  return convertMemory(in.data(), in.size(), outputBuffer, params);
+  return convertMemory(in.data(), in.size(), outputBuffer, params,
+                       chosenFormat);
 }
-int image_converter::convertMemoryToFile(const uint8_t *inputBuffer,
-                                         size_t inputSize,
-                                         const std::string &outputPath,
-                                         const compress_params &params) {
+int64_t image_converter::convertMemoryToFile(const uint8_t *inputBuffer,
+                                             size_t inputSize,
+                                             const std::string &outputPath,
+                                             const compress_params &params) {
   std::vector<uint8_t> out;
-  int s = convertMemory(inputBuffer, inputSize, out, params);
+  int64_t s = convertMemory(inputBuffer, inputSize, out, params);
   if (s < 0)
     return s;
   std::ofstream ofs(outputPath, std::ios::binary);
@@ -154,4 +351,264 @@ int image_converter::convertMemoryToFile(const uint8_t *inputBuffer,
   ofs.close();
   return s;
 }
+int image_converter::convertMemoryMulti(
+    const uint8_t *inputBuffer, size_t inputSize,
+    const std::vector<compress_params> &paramsList,
+    std::vector<std::vector<uint8_t>> &outputBuffers,
+    std::vector<compress_params::Format> *chosenFormats) {
+  outputBuffers.assign(paramsList.size(), std::vector<uint8_t>());
+  ImageFormat inFmt = detectImageFormat(inputBuffer, inputSize);
+  std::vector<compress_params::Format> chosen(paramsList.size());
+  for (size_t i = 0; i < paramsList.size(); ++i)
+    chosen[i] = resolveFormat(inFmt, paramsList[i].format);
+  if (chosenFormats)
+    *chosenFormats = chosen;
+  if (!inputBuffer || inputSize == 0 || paramsList.empty())
+    return -1;
+  auto dec = makeDecoder(inFmt);
+  if (!dec)
+    return -1;
+
+  // 解码尺寸下限取所有版本中的最大值；任一版本保持原尺寸、裁剪或
+  // 按比例适配时不缩放解码（裁剪坐标基于原图）
+  // 需要方向变换的版本同样视为裁剪/适配版本，从整幅解码结果生成
+  decode_params dp;
+  bool fullSize = false;
+  std::vector<bool> geometry(paramsList.size());
+  std::vector<compress_params> eff(paramsList);
+  int exifOrientation = 0;
+  for (size_t i = 0; i < paramsList.size(); ++i) {
+    compress_params &p = eff[i];
+    if (p.auto_orient) {
+      if (exifOrientation == 0)
+        exifOrientation = readExifOrientation(inputBuffer, inputSize);
+      p.orientation = exifOrientation;
+    }
+    p.orientation = geometryOrientation(p);
+    p.rotation = compress_params::Rotation::NONE;
+    p.flip_horizontal = p.flip_vertical = false;
+    orient_ops op = orientOps(p.orientation);
+    geometry[i] = (p.crop_width > 0 && p.crop_height > 0) ||
+                  p.fit_mode != compress_params::FitMode::STRETCH ||
+                  op.transpose || op.flipX || op.flipY;
+    if (geometry[i]) {
+      fullSize = true;
+    } else if (p.output_width > 0 && p.output_height > 0) {
+      dp.min_width = std::max(dp.min_width, p.output_width);
+      dp.min_height = std::max(dp.min_height, p.output_height);
+    } else {
+      fullSize = true;
+    }
+  }
+  if (fullSize)
+    dp = decode_params();
+  // 共用一次解码，按第一个版本的限制检查源图像
+  dp.limits = paramsList[0].limits;
+  dp.threads = paramsList[0].threads;
+  int srcW, srcH;
+  if (!dec->readImageSize(inputBuffer, inputSize, srcW, srcH))
+    return -1;
+  if (!dp.limits.allowsImage(srcW, srcH) ||
+      !dp.limits.allowsDecoded((unsigned long long)srcW * srcH * 4))
+    return kErrLimitExceeded;
+
+  // images[0] 为解码结果，其余为各版本的缩放结果；预留容量保证引用不失效
+  std::vector<ImageRGBA> images;
+  images.reserve(paramsList.size() + 1);
+  images.emplace_back();
+  if (!dec->decodeToRGBA(inputBuffer, inputSize, images[0], dp))
+    return -1;
+
+  // 按面积从大到小处理，每个版本从已生成的最小且足够大的图像缩放
+  std::vector<size_t> order(paramsList.size());
+  std::vector<int> tw(paramsList.size()), th(paramsList.size());
+  for (size_t i = 0; i < paramsList.size(); ++i) {
+    order[i] = i;
+    if (geometry[i]) {
+      crop_rect r;
+      if (!resolveGeometry(eff[i], images[0].width, images[0].height, r,
+                           tw[i], th[i]) ||
+          !paramsList[i].limits.allowsImage(tw[i], th[i]))
+        tw[i] = th[i] = 0;
+      continue;
+    }
+    bool resize = paramsList[i].output_width > 0 &&
+                  paramsList[i].output_height > 0;
+    tw[i] = resize ? paramsList[i].output_width : images[0].width;
+    th[i] = resize ? paramsList[i].output_height : images[0].height;
+    if (!paramsList[i].limits.allowsImage(tw[i], th[i]))
+      tw[i] = th[i] = 0;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return (long long)tw[a] * th[a] > (long long)tw[b] * th[b];
+  });
+
+  std::vector<int64_t> results(paramsList.size(), -1);
+  // 裁剪/适配版本的像素缓冲经内存预算，持续到各版本编码完成
+  memory_reservation hold;
+  std::vector<const ImageRGBA *> sources(paramsList.size(), nullptr);
+  std::vector<bool> cascade(1, true); // images[j] 是否为整幅画面，可作级联源
+  for (size_t k = 0; k < order.size(); ++k) {
+    size_t i = order[k];
+    if (tw[i] <= 0)
+      continue;
+    const ImageRGBA *src = &images[0];
+    if (geometry[i]) {
+      // 裁剪/适配版本直接从解码结果生成，不参与级联；无需处理时直接使用
+      // 解码结果。失败（含预算拒绝）时该版本为空
+      int w = images[0].width, h = images[0].height;
+      std::vector<uint8_t> scratch;
+      const uint8_t *px = applyGeometry(eff[i], images[0].pixels.data(), w,
+                                        h, scratch, &hold);
+      if (!px)
+        continue;
+      if (px != images[0].pixels.data()) {
+        images.emplace_back();
+        cascade.push_back(false);
+        images.back().width = w;
+        images.back().height = h;
+        images.back().pixels.swap(scratch);
+        src = &images.back();
+      }
+    }
+    for (size_t j = 1; !geometry[i] && j < images.size(); ++j) {
+      const ImageRGBA &c = images[j];
+      if (cascade[j] && c.width >= tw[i] && c.height >= th[i] &&
+          (long long)c.width * c.height < (long long)src->width * src->height)
+        src = &c;
+    }
+    const ImageRGBA *img = src;
+    if (src->width != tw[i] || src->height != th[i]) {
+      images.emplace_back();
+      cascade.push_back(true);
+      resizeImage(*src, images.back(), tw[i], th[i],
+                  paramsList[i].resize_algo, paramsList[i].threads);
+      img = &images.back();
+    }
+    sources[i] = img;
+  }
+  // 各版本的编码互不依赖，交给共享线程池；线程数取各版本中最严格的限制
+  int threads = 0;
+  for (size_t i = 0; i < paramsList.size(); ++i)
+    if (paramsList[i].threads > 0 &&
+        (threads == 0 || paramsList[i].threads < threads))
+      threads = paramsList[i].threads;
+  parallelFor(paramsList.size(), 1, threads, [&](size_t b, size_t e) {
+    for (size_t i = b; i < e; ++i) {
+      const ImageRGBA *img = sources[i];
+      if (!img)
+        continue;
+      compress_params p = paramsList[i];
+      p.output_width = img->width;
+      p.output_height = img->height;
+      p.crop_width = p.crop_height = 0;
+      p.fit_mode = compress_params::FitMode::STRETCH;
+      p.orientation = 1;
+      p.auto_orient = false;
+      p.rotation = compress_params::Rotation::NONE;
+      p.flip_horizontal = p.flip_vertical = false;
+      if (chosen[i] == compress_params::Format::SMART) {
+        results[i] = checkOutputLimit(
+            p, outputBuffers[i],
+            encodeSmart(*img, outputBuffers[i], p, chosen[i]));
+        continue;
+      }
+      auto enc = makeEncoder(chosen[i]);
+      if (enc)
+        results[i] =
+            checkOutputLimit(p, outputBuffers[i],
+                             enc->encodeFromRGBA(*img, outputBuffers[i], p));
+    }
+  });
+  if (chosenFormats)
+    *chosenFormats = chosen;
+
+  int ok = 0;
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (results[i] > 0)
+      ++ok;
+    else
+      outputBuffers[i].clear();
+  }
+  return ok;
+}
+int64_t image_converter::convertTiled(const uint8_t *inputBuffer,
+                                      size_t inputSize,
+                                      std::vector<uint8_t> &outputBuffer,
+                                      const compress_params &params,
+                                      size_t maxResidentBytes,
+                                      const std::string &tempDir) {
+  if (!inputBuffer || inputSize == 0)
+    return -1;
+  ImageFormat inFmt = detectImageFormat(inputBuffer, inputSize);
+  compress_params::Format outFmt = resolveFormat(inFmt, params.format);
+  auto dec = makeDecoder(inFmt);
+  if (!dec || outFmt == compress_params::Format::AUTO ||
+      outFmt == compress_params::Format::SMART)
+    return -1;
+  int srcW, srcH;
+  if (!dec->readImageSize(inputBuffer, inputSize, srcW, srcH))
+    return -1;
+  if (!params.limits.allowsImage(srcW, srcH))
+    return kErrLimitExceeded;
+  compress_params g = params;
+  if (params.auto_orient)
+    g.orientation = readExifOrientation(inputBuffer, inputSize);
+  crop_rect region;
+  int outW, outH;
+  if (!resolveGeometry(g, srcW, srcH, region, outW, outH))
+    return -1;
+  // 需要方向、裁剪或缩放时源图与结果同时常驻，两者平分常驻块预算
+  orient_ops op = orientOps(geometryOrientation(g));
+  bool transform = op.transpose || op.flipX || op.flipY ||
+                   region.width != srcW || region.height != srcH ||
+                   outW != srcW || outH != srcH;
+  size_t tileBudget = maxResidentBytes;
+  if (transform && maxResidentBytes > 0)
+    tileBudget = std::max<size_t>(maxResidentBytes / 2, 1);
+  // 解码：JPEG/PNG 逐行写入分块图像，BMP/QOI 整幅解码后再分块
+  tiled_image src(tileBudget, tempDir), scratch(tileBudget, tempDir);
+  bool ok;
+  if (inFmt == ImageFormat::JPEG) {
+    ok = jpeg_compressor().decodeToTiled(inputBuffer, inputSize, src,
+                                         params.limits);
+  } else if (inFmt == ImageFormat::PNG) {
+    ok = png_compressor().decodeToTiled(inputBuffer, inputSize, src,
+                                        params.limits);
+  } else {
+    ImageRGBA rgba;
+    decode_params dp;
+    dp.limits = params.limits;
+    ok = dec->decodeToRGBA(inputBuffer, inputSize, rgba, dp) &&
+         src.fromRGBA(rgba);
+  }
+  if (!ok)
+    return -1;
+  // 方向、裁剪与缩放在分块图像上完成
+  tiled_image *img = applyGeometryTiled(g, src, scratch);
+  if (!img)
+    return -1;
+  int64_t size;
+  if (outFmt == compress_params::Format::JPEG) {
+    size = jpeg_compressor().encodeFromTiled(*img, outputBuffer, params);
+  } else if (outFmt == compress_params::Format::PNG) {
+    size = png_compressor().encodeFromTiled(*img, outputBuffer, params);
+  } else {
+    // BMP/QOI 编码器需要整幅图像，几何变换已完成，编码时不再处理
+    ImageRGBA rgba;
+    if (!params.limits.allowsImage(img->width(), img->height()) ||
+        !img->toRGBA(rgba))
+      return -1;
+    compress_params plain = params;
+    plain.output_width = plain.output_height = 0;
+    plain.crop_width = plain.crop_height = 0;
+    plain.orientation = 1;
+    plain.auto_orient = false;
+    plain.rotation = compress_params::Rotation::NONE;
+    plain.flip_horizontal = plain.flip_vertical = false;
+    auto enc = makeEncoder(outFmt);
+    size = enc ? enc->encodeFromRGBA(rgba, outputBuffer, plain) : -1;
+  }
+  return checkOutputLimit(params, outputBuffer, size);
+}
 } // namespace imgc
@@ -0,0 +1,205 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "image_compress/image_metrics.h"
+#include "parallel_for.h"
+#include "simd/kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+namespace imgc {
+static const double kC1 = (0.01 * 255) * (0.01 * 255);
+static const double kC2 = (0.03 * 255) * (0.03 * 255);
+// 下采样倍数：短边约缩到 256 像素
+static int metricScale(int w, int h) {
+  return std::max(1, (int)(std::min(w, h) / 256.0 + 0.5));
+}
+// RGBA 转亮度并按 f*f 盒式下采样，尾部不足 f 的行列丢弃
+static void lumaPlane(const uint8_t *rgba, int w, int h, int f, int threads,
+                      std::vector<uint8_t> &out) {
+  const kernel_table &k = kernels();
+  int lw = w / f, lh = h / f;
+  out.resize((size_t)lw * lh);
+  parallelFor(lh, parallelGrain((size_t)w * 4 * f), threads,
+              [&](size_t b, size_t e) {
+                std::vector<uint8_t> row(w);
+                std::vector<uint32_t> col(w);
+                uint32_t area = (uint32_t)(f * f);
+                for (size_t y = b; y < e; ++y) {
+                  uint8_t *d = &out[y * lw];
+                  const uint8_t *s = rgba + y * f * (size_t)w * 4;
+                  if (f == 1) {
+                    k.rgba_to_luma(s, d, lw);
+                    continue;
+                  }
+                  std::fill(col.begin(), col.end(), 0);
+                  for (int r = 0; r < f; ++r) {
+                    k.rgba_to_luma(s + (size_t)r * w * 4, row.data(), w);
+                    for (int x = 0; x < w; ++x)
+                      col[x] += row[x];
+                  }
+                  for (int x = 0; x < lw; ++x) {
+                    uint32_t sum = 0;
+                    for (int i = 0; i < f; ++i)
+                      sum += col[x * f + i];
+                    d[x] = (uint8_t)((sum + area / 2) / area);
+                  }
+                }
+              });
+}
+// 4x4 块内的统计量：和、平方和（两图合计）、乘积和
+struct block_stats {
+  uint32_t sa, sb, sq, sab;
+};
+static double ssimWindow(double sa, double sb, double sq, double sab,
+                         double n) {
+  double ma = sa / n, mb = sb / n;
+  double var = sq / n - ma * ma - mb * mb;
+  double cov = sab / n - ma * mb;
+  return (2 * ma * mb + kC1) * (2 * cov + kC2) /
+         ((ma * ma + mb * mb + kC1) * (var + kC2));
+}
+// 先按 4 行一带统计每个 4x4 块，8x8 窗口为相邻 2x2 个块之和
+static void planeMetrics(const uint8_t *a, const uint8_t *b, int w, int h,
+                         int threads, double &ssim, double &psnr) {
+  const kernel_table &k = kernels();
+  int bw = (w + 3) / 4, bh = (h + 3) / 4;
+  std::vector<block_stats> blocks((size_t)bw * bh);
+  parallelFor(bh, parallelGrain((size_t)w * 8), threads,
+              [&](size_t b0, size_t b1) {
+                std::vector<uint32_t> acc((size_t)w * 4);
+                uint32_t *sa = acc.data(), *sb = sa + w, *sq = sb + w,
+                         *sab = sq + w;
+                for (size_t by = b0; by < b1; ++by) {
+                  std::fill(acc.begin(), acc.end(), 0);
+                  int y1 = std::min(h, (int)by * 4 + 4);
+                  for (int y = (int)by * 4; y < y1; ++y)
+                    k.ssim_accum_row(a + (size_t)y * w, b + (size_t)y * w, w,
+                                     sa, sb, sq, sab);
+                  for (int bx = 0; bx < bw; ++bx) {
+                    block_stats s = {0, 0, 0, 0};
+                    for (int x = bx * 4; x < std::min(w, bx * 4 + 4); ++x) {
+                      s.sa += sa[x];
+                      s.sb += sb[x];
+                      s.sq += sq[x];
+                      s.sab += sab[x];
+                    }
+                    blocks[by * bw + bx] = s;
+                  }
+                }
+              });
+  double ta = 0, tb = 0, tq = 0, tab = 0;
+  for (const block_stats &s : blocks) {
+    ta += s.sa;
+    tb += s.sb;
+    tq += s.sq;
+    tab += s.sab;
+  }
+  double n = (double)w * h;
+  // sum((a-b)^2) = sum(a^2 + b^2) - 2*sum(ab)
+  double mse = (tq - 2 * tab) / n;
+  psnr = mse <= 0 ? std::numeric_limits<double>::infinity()
+                  : 10 * std::log10(255.0 * 255.0 / mse);
+  if (w < 8 || h < 8) {
+    // 不足一个窗口：整幅作为一个窗口
+    ssim = ssimWindow(ta, tb, tq, tab, n);
+    return;
+  }
+  int nx = (w - 8) / 4 + 1, ny = (h - 8) / 4 + 1;
+  std::vector<double> rows(ny);
+  parallelFor(ny, parallelGrain((size_t)nx * 64), threads,
+              [&](size_t y0, size_t y1) {
+                for (size_t y = y0; y < y1; ++y) {
+                  const block_stats *r0 = &blocks[y * bw];
+                  const block_stats *r1 = r0 + bw;
+                  double sum = 0;
+                  for (int x = 0; x < nx; ++x) {
+                    const block_stats *p[4] = {r0 + x, r0 + x + 1, r1 + x,
+                                               r1 + x + 1};
+                    uint32_t sa = 0, sb = 0, sq = 0, sab = 0;
+                    for (int i = 0; i < 4; ++i) {
+                      sa += p[i]->sa;
+                      sb += p[i]->sb;
+                      sq += p[i]->sq;
+                      sab += p[i]->sab;
+                    }
+                    sum += ssimWindow(sa, sb, sq, sab, 64);
+                  }
+                  rows[y] = sum;
+                }
+              });
+  double total = 0;
+  for (double r : rows)
+    total += r;
+  ssim = total / ((double)nx * ny);
+}
+struct quality_reference::impl {
+  int width, height, scale, threads;
+  std::vector<uint8_t> luma;
+};
+quality_reference::quality_reference(const uint8_t *rgba, int width,
+                                     int height, int threads)
+    : impl_(new impl()) {
+  impl_->width = rgba && width > 0 && height > 0 ? width : 0;
+  impl_->height = impl_->width ? height : 0;
+  impl_->threads = threads;
+  impl_->scale = 1;
+  if (impl_->width) {
+    impl_->scale = metricScale(width, height);
+    lumaPlane(rgba, width, height, impl_->scale, threads, impl_->luma);
+  }
+}
+quality_reference::quality_reference(const ImageRGBA &ref, int threads)
+    : quality_reference(ref.pixels.size() >=
+                                (size_t)ref.width * ref.height * 4
+                            ? ref.pixels.data()
+                            : nullptr,
+                        ref.width, ref.height, threads) {}
+quality_reference::~quality_reference() { delete impl_; }
+bool quality_reference::compare(const uint8_t *rgba, int width, int height,
+                                double &ssim, double &psnr) const {
+  const impl &m = *impl_;
+  if (!rgba || m.width == 0 || width != m.width || height != m.height)
+    return false;
+  std::vector<uint8_t> luma;
+  lumaPlane(rgba, width, height, m.scale, m.threads, luma);
+  planeMetrics(m.luma.data(), luma.data(), width / m.scale, height / m.scale,
+               m.threads, ssim, psnr);
+  return true;
+}
+bool quality_reference::compare(const ImageRGBA &test, double &ssim,
+                                double &psnr) const {
+  if (test.pixels.size() < (size_t)test.width * test.height * 4)
+    return false;
+  return compare(test.pixels.data(), test.width, test.height, ssim, psnr);
+}
+double computeSSIM(const ImageRGBA &a, const ImageRGBA &b, int threads) {
+  double ssim, psnr;
+  return quality_reference(a, threads).compare(b, ssim, psnr) ? ssim : -1;
+}
+double computePSNR(const ImageRGBA &a, const ImageRGBA &b, int threads) {
+  double ssim, psnr;
+  return quality_reference(a, threads).compare(b, ssim, psnr) ? psnr : -1;
+}
+} // namespace imgc
@@ -0,0 +1,158 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "image_compress/image_pyramid.h"
+#include "compressor_factory.h"
+#include "parallel_for.h"
+#include "simd/kernels.h"
+#include "size_math.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+namespace imgc {
+// 每个行带读取的源数据量，约为 L2 缓存的一半
+static const size_t kBandBytes = 256 * 1024;
+// buildEncoded 每次融合生成的级数：一组生成完即可开始编码，同时生成下一组
+static const int kFusedLevels = 3;
+
+// 两行源像素 2x2 平均为一行目标像素；奇数高度的最后一行两行相同
+static void downsampleRow(downsample2x_row_fn fn, const ImageRGBA &src,
+                          ImageRGBA &dst, int y) {
+  size_t srcRow = (size_t)src.width * 4;
+  int sy0 = y * 2;
+  int sy1 = std::min(src.height - 1, sy0 + 1);
+  fn(&src.pixels[sy0 * srcRow], &src.pixels[sy1 * srcRow], src.width,
+     &dst.pixels[(size_t)y * dst.width * 4], dst.width);
+}
+
+// 由 src 连续生成 count 级：levels[0] 为 src 的一半，其后每级为上一级的一半。
+// src 按行带缩小，每个行带产生的新行仍在缓存中时立即继续缩小到后续各级，
+// 避免每一级都从内存重新读一遍上一级
+static void downsampleLevels(const ImageRGBA &src, ImageRGBA *levels,
+                             int count) {
+  const ImageRGBA *prev = &src;
+  for (int j = 0; j < count; ++j) {
+    levels[j].width = (prev->width + 1) / 2;
+    levels[j].height = (prev->height + 1) / 2;
+    levels[j].pixels.resize((size_t)levels[j].width * levels[j].height * 4);
+    prev = &levels[j];
+  }
+  downsample2x_row_fn fn = kernels().downsample2x_row;
+  std::vector<int> done(count, 0); // 各级已生成的行数
+  int band = (int)std::max<size_t>(
+      1, kBandBytes / ((size_t)src.width * 4 * 2));
+  while (done[0] < levels[0].height) {
+    int end = std::min(levels[0].height, done[0] + band);
+    while (done[0] < end)
+      downsampleRow(fn, src, levels[0], done[0]++);
+    // 下一级第 y 行需要本级第 2y、2y+1 行（末行取本级最后一行）
+    for (int j = 1; j < count; ++j) {
+      const ImageRGBA &s = levels[j - 1];
+      while (done[j] < levels[j].height &&
+             std::min(done[j] * 2 + 1, s.height - 1) < done[j - 1])
+        downsampleRow(fn, s, levels[j], done[j]++);
+    }
+  }
+}
+
+static int levelCount(int w, int h, int minSize) {
+  int n = 0;
+  while (w > minSize || h > minSize) {
+    w = (w + 1) / 2;
+    h = (h + 1) / 2;
+    ++n;
+  }
+  return n;
+}
+
+int image_pyramid::build(const ImageRGBA &base, std::vector<ImageRGBA> &levels,
+                         int minSize) {
+  levels.clear();
+  if (!validRGBA(base))
+    return -1;
+  if (minSize < 1)
+    minSize = 1;
+  int n = levelCount(base.width, base.height, minSize);
+  levels.resize(n);
+  if (n > 0)
+    downsampleLevels(base, levels.data(), n);
+  return n;
+}
+
+int image_pyramid::buildEncoded(const ImageRGBA &base,
+                                const compress_params &params,
+                                std::vector<std::vector<uint8_t>> &encoded,
+                                bool includeBase, int minSize) {
+  encoded.clear();
+  if (!validRGBA(base))
+    return -1;
+  if (!makeEncoder(params.format))
+    return -1;
+  if (minSize < 1)
+    minSize = 1;
+  int n = levelCount(base.width, base.height, minSize);
+  int offset = includeBase ? 1 : 0;
+  encoded.resize(n + offset);
+  std::vector<int64_t> results(n + offset, -1);
+  // 0 号任务按组生成各级，每组完成后通知对应的编码任务；其余任务各编码
+  // 一级，所需的级生成后立即开始，与后续各级的生成重叠。0 号任务位于调用
+  // 线程分段的头部，总会最先在某个线程上执行且自身从不等待，因此不会死锁
+  std::vector<ImageRGBA> levels(n);
+  std::mutex m;
+  std::condition_variable cv;
+  int ready = 0;
+  size_t count = (size_t)(n + offset + 1);
+  parallelFor(count, 1, params.threads, [&](size_t b, size_t e) {
+    for (size_t task = b; task < e; ++task) {
+      if (task == 0) {
+        const ImageRGBA *prev = &base;
+        for (int i = 0; i < n; i += kFusedLevels) {
+          int k = std::min(kFusedLevels, n - i);
+          downsampleLevels(*prev, &levels[i], k);
+          prev = &levels[i + k - 1];
+          std::lock_guard<std::mutex> lk(m);
+          ready = i + k;
+          cv.notify_all();
+        }
+        continue;
+      }
+      int slot = (int)task - 1;
+      int level = slot - offset;
+      if (level >= 0) {
+        std::unique_lock<std::mutex> lk(m);
+        cv.wait(lk, [&]() { return ready > level; });
+      }
+      const ImageRGBA &img = level < 0 ? base : levels[level];
+      compress_params p = params;
+      p.output_width = 0;
+      p.output_height = 0;
+      results[slot] =
+          makeEncoder(p.format)->encodeFromRGBA(img, encoded[slot], p);
+    }
+  });
+  for (int64_t r : results)
+    if (r <= 0)
+      return -1;
+  return n + offset;
+}
+} // namespace imgc
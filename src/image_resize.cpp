@@ -0,0 +1,680 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "image_resize.h"
+#include "image_compress/image_converter.h"
+#include "image_compress/trace.h"
+#include "parallel_for.h"
+#include "simd/kernels.h"
+#include "size_math.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+namespace imgc {
+void resizeRGBA(const uint8_t *src, int w, int h, uint8_t *dst, int newW,
+                int newH, compress_params::ResizeAlgo algo, size_t srcStride,
+                int threads) {
+  const kernel_table &k = kernels();
+  if (srcStride == 0)
+    srcStride = (size_t)w * 4;
+  // 输出行互不依赖，按行带并行
+  size_t grain = parallelGrain((size_t)newW * 4);
+  if (algo == compress_params::ResizeAlgo::NEAREST) {
+    // 最近邻：横向源坐标每行相同，预先计算
+    std::vector<int> xofs(newW);
+    for (int x = 0; x < newW; ++x)
+      xofs[x] = (int)((long long)x * w / newW);
+    parallelFor(newH, grain, threads, [&](size_t y0, size_t y1) {
+      for (int y = (int)y0; y < (int)y1; ++y) {
+        int srcY = (int)((long long)y * h / newH);
+        k.resize_nearest_row(&src[(size_t)srcY * srcStride], xofs.data(),
+                             &dst[(size_t)y * newW * 4], newW);
+      }
+    });
+  } else if (algo == compress_params::ResizeAlgo::BILINEAR) {
+    // 双线性：预先计算横向坐标与权重
+    std::vector<int> xs0(newW), xs1(newW);
+    std::vector<float> wxs(newW);
+    for (int x = 0; x < newW; ++x) {
+      float srcX = (x + 0.5f) * w / newW - 0.5f;
+      xs0[x] = std::max(0, (int)std::floor(srcX));
+      xs1[x] = std::min(w - 1, xs0[x] + 1);
+      wxs[x] = srcX - xs0[x];
+    }
+    parallelFor(newH, grain, threads, [&](size_t b, size_t e) {
+      for (int y = (int)b; y < (int)e; ++y) {
+        float srcY = (y + 0.5f) * h / newH - 0.5f;
+        int y0 = std::max(0, (int)std::floor(srcY));
+        int y1 = std::min(h - 1, y0 + 1);
+        float wy = srcY - y0;
+        k.resize_bilinear_row(&src[(size_t)y0 * srcStride],
+                              &src[(size_t)y1 * srcStride], xs0.data(),
+                              xs1.data(), wxs.data(), wy,
+                              &dst[(size_t)y * newW * 4], newW);
+      }
+    });
+  }
+}
+orient_ops orientOps(int orientation) {
+  // 1 正向；2 水平翻转；3 旋转 180；4 垂直翻转；5 转置；
+  // 6 顺时针 90（转置后水平翻转）；7 反转置；8 逆时针 90（转置后垂直翻转）
+  static const orient_ops table[9] = {
+      {false, false, false}, {false, false, false}, {false, true, false},
+      {false, true, true},   {false, false, true},  {true, false, false},
+      {true, true, false},   {true, true, true},    {true, false, true}};
+  return (orientation >= 1 && orientation <= 8) ? table[orientation]
+                                                : table[1];
+}
+// 方向 op 下输出坐标 (x, y) 对应的源坐标，源尺寸 w*h
+static void orientSource(const orient_ops &op, int w, int h, int x, int y,
+                         int &sx, int &sy) {
+  int tx = op.flipX ? (op.transpose ? h : w) - 1 - x : x;
+  int ty = op.flipY ? (op.transpose ? w : h) - 1 - y : y;
+  sx = op.transpose ? ty : tx;
+  sy = op.transpose ? tx : ty;
+}
+int composeOrientation(int first, int second) {
+  // 在非方形的 2x3 图像上比较三个角点的映射，找出等价的单一方向
+  const int w = 2, h = 3;
+  orient_ops a = orientOps(first), b = orientOps(second);
+  int mw = a.transpose ? h : w, mh = a.transpose ? w : h;
+  int ow = b.transpose ? mh : mw, oh = b.transpose ? mw : mh;
+  const int pts[3][2] = {{0, 0}, {ow - 1, 0}, {0, oh - 1}};
+  for (int c = 1; c <= 8; ++c) {
+    orient_ops op = orientOps(c);
+    if ((op.transpose ? h : w) != ow)
+      continue;
+    bool same = true;
+    for (int i = 0; same && i < 3; ++i) {
+      int mx, my, sx, sy, cx, cy;
+      orientSource(b, mw, mh, pts[i][0], pts[i][1], mx, my);
+      orientSource(a, w, h, mx, my, sx, sy);
+      orientSource(op, w, h, pts[i][0], pts[i][1], cx, cy);
+      same = sx == cx && sy == cy;
+    }
+    if (same)
+      return c;
+  }
+  return 1;
+}
+int geometryOrientation(const compress_params &params) {
+  static const int rotations[4] = {1, 6, 3, 8};
+  int o = composeOrientation(params.orientation,
+                             rotations[(int)params.rotation & 3]);
+  if (params.flip_horizontal)
+    o = composeOrientation(o, 2);
+  if (params.flip_vertical)
+    o = composeOrientation(o, 4);
+  return o;
+}
+static crop_rect regionToSource(const crop_rect &r, const orient_ops &op,
+                                int srcW, int srcH) {
+  // 先撤销翻转（在转置后的坐标系中），再撤销转置
+  int tw = op.transpose ? srcH : srcW, th = op.transpose ? srcW : srcH;
+  crop_rect t = r;
+  if (op.flipX)
+    t.x = tw - r.x - r.width;
+  if (op.flipY)
+    t.y = th - r.y - r.height;
+  if (op.transpose) {
+    std::swap(t.x, t.y);
+    std::swap(t.width, t.height);
+  }
+  return t;
+}
+crop_rect orientRegionToSource(const crop_rect &r, int orientation, int srcW,
+                               int srcH) {
+  return regionToSource(r, orientOps(orientation), srcW, srcH);
+}
+// 不缩放的 RGBA 方向变换。转置时按 kOrientTile 见方的块处理，源与目标的
+// 工作集都留在缓存内，块内由 SIMD 微块转置完成；翻转用负行间距实现
+static const int kOrientTile = 64;
+static void orientCopyRGBA(const uint8_t *src, int w, int h, ptrdiff_t stride,
+                           const orient_ops &op, const crop_rect &r,
+                           uint8_t *dst, int threads, ptrdiff_t outStride = 0) {
+  const kernel_table &k = kernels();
+  crop_rect sr = regionToSource(r, op, w, h);
+  const uint8_t *base = src + (ptrdiff_t)sr.y * stride + (ptrdiff_t)sr.x * 4;
+  if (outStride == 0)
+    outStride = (ptrdiff_t)r.width * 4;
+  if (!op.transpose) {
+    parallelFor(r.height, parallelGrain((size_t)outStride), threads,
+                [&](size_t b, size_t e) {
+                  for (int y = (int)b; y < (int)e; ++y) {
+                    const uint8_t *s =
+                        base + (ptrdiff_t)(op.flipY ? sr.height - 1 - y : y) *
+                                   stride;
+                    uint8_t *d = dst + y * outStride;
+                    if (op.flipX)
+                      k.reverse32_row(s, d, r.width);
+                    else
+                      std::memcpy(d, s, (size_t)outStride);
+                  }
+                });
+    return;
+  }
+  // 输出第 X 列取源行 fx(X)，第 Y 行取源列 fy(Y)
+  const uint8_t *s0 = op.flipX ? base + (ptrdiff_t)(sr.height - 1) * stride
+                               : base;
+  ptrdiff_t ss = op.flipX ? -stride : stride;
+  uint8_t *d0 = op.flipY ? dst + (ptrdiff_t)(r.height - 1) * outStride : dst;
+  ptrdiff_t ds = op.flipY ? -outStride : outStride;
+  size_t tiles = (size_t)(sr.width + kOrientTile - 1) / kOrientTile;
+  size_t grain = parallelGrain((size_t)kOrientTile * outStride);
+  parallelFor(tiles, grain, threads, [&](size_t b, size_t e) {
+    for (int i = (int)b * kOrientTile; i < (int)e * kOrientTile && i < sr.width;
+         i += kOrientTile) {
+      int tw = std::min(kOrientTile, sr.width - i);
+      for (int j = 0; j < sr.height; j += kOrientTile)
+        k.transpose32(s0 + j * ss + i * 4, ss, d0 + i * ds + j * 4, ds, tw,
+                      std::min(kOrientTile, sr.height - j));
+    }
+  });
+}
+// 方向变换后坐标系中一个轴的采样表：输出坐标 -> 源图像上的两个相邻样本
+// 下标与权重。最近邻只用 i0；坐标对齐与钳制同 resizeRGBA
+struct axis_map {
+  std::vector<int> i0, i1;
+  std::vector<float> wt;
+};
+static void buildAxis(int start, int len, int outLen, int axisLen, bool flip,
+                      bool bilinear, axis_map &m) {
+  m.i0.resize(outLen);
+  m.i1.resize(outLen);
+  m.wt.assign(outLen, 0.0f);
+  for (int o = 0; o < outLen; ++o) {
+    int a0, a1;
+    if (bilinear) {
+      float s = (o + 0.5f) * len / outLen - 0.5f;
+      a0 = std::max(0, (int)std::floor(s));
+      a1 = std::min(len - 1, a0 + 1);
+      m.wt[o] = s - a0;
+    } else {
+      a0 = a1 = (int)((long long)o * len / outLen);
+    }
+    a0 += start;
+    a1 += start;
+    // 翻转只改变下标，权重仍对应 i0/i1
+    m.i0[o] = flip ? axisLen - 1 - a0 : a0;
+    m.i1[o] = flip ? axisLen - 1 - a1 : a1;
+  }
+}
+// 源图像 w*h 经方向变换后，取区域 r 缩放到 newW*newH（bpp 字节每像素，
+// 相邻像素间隔 step 字节）。不转置时每个输出行对应一个源行；转置时对应
+// 一个源列，按输出块逐像素取样
+template <int BPP>
+static void orientResize(const uint8_t *src, int w, int h, ptrdiff_t srcStride,
+                         int step, const orient_ops &op, const crop_rect &r,
+                         uint8_t *dst, int newW, int newH,
+                         compress_params::ResizeAlgo algo, int threads) {
+  bool bilinear = algo == compress_params::ResizeAlgo::BILINEAR;
+  int tw = op.transpose ? h : w, th = op.transpose ? w : h;
+  axis_map mx, my;
+  buildAxis(r.x, r.width, newW, tw, op.flipX, bilinear, mx);
+  buildAxis(r.y, r.height, newH, th, op.flipY, bilinear, my);
+  if (!op.transpose) {
+    const kernel_table &k = kernels();
+    parallelFor(newH, parallelGrain((size_t)newW * BPP), threads,
+                [&](size_t b, size_t e) {
+      for (int y = (int)b; y < (int)e; ++y) {
+        uint8_t *d = dst + (size_t)y * newW * BPP;
+        const uint8_t *r0 = src + (ptrdiff_t)my.i0[y] * srcStride;
+        const uint8_t *r1 = src + (ptrdiff_t)my.i1[y] * srcStride;
+        if (BPP == 4) {
+          // RGBA 不转置：行内取样与普通缩放相同，复用行内核
+          if (!bilinear)
+            k.resize_nearest_row(r0, mx.i0.data(), d, newW);
+          else
+            k.resize_bilinear_row(r0, r1, mx.i0.data(), mx.i1.data(),
+                                  mx.wt.data(), my.wt[y], d, newW);
+          continue;
+        }
+        if (!bilinear) {
+          for (int x = 0; x < newW; ++x)
+            std::memcpy(d + x * BPP, r0 + mx.i0[x] * step, BPP);
+          continue;
+        }
+        float wy = my.wt[y];
+        for (int x = 0; x < newW; ++x) {
+          const uint8_t *p0 = r0 + mx.i0[x] * step, *p1 = r0 + mx.i1[x] * step;
+          const uint8_t *q0 = r1 + mx.i0[x] * step, *q1 = r1 + mx.i1[x] * step;
+          float wx = mx.wt[x];
+          for (int c = 0; c < BPP; ++c) {
+            float top = p0[c] + (p1[c] - p0[c]) * wx;
+            float bot = q0[c] + (q1[c] - q0[c]) * wx;
+            d[x * BPP + c] = (uint8_t)(top + (bot - top) * wy + 0.5f);
+          }
+        }
+      }
+    });
+    return;
+  }
+  // 转置：输出行对应源列 my，输出列对应源行 mx。按输出块遍历，
+  // 每块只触及源图像中相应的一小块区域，避免整列跨行访问
+  size_t bands = (size_t)(newH + kOrientTile - 1) / kOrientTile;
+  parallelFor(bands, parallelGrain((size_t)kOrientTile * newW * BPP), threads,
+              [&](size_t b, size_t e) {
+    int yEnd = std::min(newH, (int)e * kOrientTile);
+    for (int y0 = (int)b * kOrientTile; y0 < yEnd; y0 += kOrientTile) {
+      int y1 = std::min(yEnd, y0 + kOrientTile);
+      for (int x0 = 0; x0 < newW; x0 += kOrientTile) {
+        int x1 = std::min(newW, x0 + kOrientTile);
+        for (int y = y0; y < y1; ++y) {
+          uint8_t *d = dst + (size_t)y * newW * BPP;
+          const uint8_t *c0 = src + my.i0[y] * step;
+          const uint8_t *c1 = src + my.i1[y] * step;
+          if (!bilinear) {
+            for (int x = x0; x < x1; ++x)
+              std::memcpy(d + x * BPP, c0 + (ptrdiff_t)mx.i0[x] * srcStride,
+                          BPP);
+            continue;
+          }
+          float wy = my.wt[y];
+          for (int x = x0; x < x1; ++x) {
+            ptrdiff_t o0 = (ptrdiff_t)mx.i0[x] * srcStride;
+            ptrdiff_t o1 = (ptrdiff_t)mx.i1[x] * srcStride;
+            float wx = mx.wt[x];
+            for (int c = 0; c < BPP; ++c) {
+              float top = c0[o0 + c] + (c0[o1 + c] - c0[o0 + c]) * wx;
+              float bot = c1[o0 + c] + (c1[o1 + c] - c1[o0 + c]) * wx;
+              d[x * BPP + c] = (uint8_t)(top + (bot - top) * wy + 0.5f);
+            }
+          }
+        }
+      }
+    }
+  });
+}
+void resizePlane(const uint8_t *src, int w, int h, ptrdiff_t srcStride,
+                 int step, uint8_t *dst, int newW, int newH,
+                 compress_params::ResizeAlgo algo, int threads,
+                 int orientation) {
+  crop_rect r;
+  orient_ops op = orientOps(orientation);
+  r.width = op.transpose ? h : w;
+  r.height = op.transpose ? w : h;
+  orientResize<1>(src, w, h, srcStride, step, op, r, dst, newW, newH, algo,
+                  threads);
+}
+// gravity 在单个方向上的位置：0 起始，1 居中，2 末端
+static int gravityX(compress_params::Gravity g) {
+  typedef compress_params::Gravity G;
+  if (g == G::WEST || g == G::NORTH_WEST || g == G::SOUTH_WEST)
+    return 0;
+  if (g == G::EAST || g == G::NORTH_EAST || g == G::SOUTH_EAST)
+    return 2;
+  return 1;
+}
+static int gravityY(compress_params::Gravity g) {
+  typedef compress_params::Gravity G;
+  if (g == G::NORTH || g == G::NORTH_WEST || g == G::NORTH_EAST)
+    return 0;
+  if (g == G::SOUTH || g == G::SOUTH_WEST || g == G::SOUTH_EAST)
+    return 2;
+  return 1;
+}
+static int alignOffset(int total, int part, int pos) {
+  return pos == 0 ? 0 : (pos == 2 ? total - part : (total - part) / 2);
+}
+bool resolveGeometry(const compress_params &params, int srcW, int srcH,
+                     crop_rect &region, int &outW, int &outH) {
+  if (orientOps(geometryOrientation(params)).transpose)
+    std::swap(srcW, srcH);
+  region.x = 0;
+  region.y = 0;
+  region.width = srcW;
+  region.height = srcH;
+  if (params.crop_width > 0 && params.crop_height > 0) {
+    long long x0 = std::max(params.crop_x, 0);
+    long long y0 = std::max(params.crop_y, 0);
+    long long x1 = std::min((long long)params.crop_x + params.crop_width,
+                            (long long)srcW);
+    long long y1 = std::min((long long)params.crop_y + params.crop_height,
+                            (long long)srcH);
+    if (x1 <= x0 || y1 <= y0)
+      return false;
+    region.x = (int)x0;
+    region.y = (int)y0;
+    region.width = (int)(x1 - x0);
+    region.height = (int)(y1 - y0);
+  }
+  outW = region.width;
+  outH = region.height;
+  if (params.output_width <= 0 || params.output_height <= 0)
+    return true;
+  long long ow = params.output_width, oh = params.output_height;
+  long long rw = region.width, rh = region.height;
+  bool wider = rw * oh > ow * rh; // 区域比输出框更宽
+  switch (params.fit_mode) {
+  case compress_params::FitMode::FIT:
+    if (wider) {
+      outW = (int)ow;
+      outH = (int)std::max(1LL, (rh * ow + rw / 2) / rw);
+    } else {
+      outH = (int)oh;
+      outW = (int)std::max(1LL, (rw * oh + rh / 2) / rh);
+    }
+    return true;
+  case compress_params::FitMode::FILL:
+    if (wider) {
+      int cw = (int)std::max(1LL, (rh * ow + oh / 2) / oh);
+      region.x += alignOffset(region.width, cw, gravityX(params.gravity));
+      region.width = cw;
+    } else if (rw * oh < ow * rh) {
+      int ch = (int)std::max(1LL, (rw * oh + ow / 2) / ow);
+      region.y += alignOffset(region.height, ch, gravityY(params.gravity));
+      region.height = ch;
+    }
+    break;
+  default:
+    break;
+  }
+  outW = (int)ow;
+  outH = (int)oh;
+  return true;
+}
+const uint8_t *applyGeometry(const compress_params &params,
+                             const uint8_t *pixels, int &w, int &h,
+                             std::vector<uint8_t> &scratch,
+                             memory_reservation *hold) {
+  crop_rect r;
+  int outW, outH;
+  if (!resolveGeometry(params, w, h, r, outW, outH))
+    return nullptr;
+  orient_ops op = orientOps(geometryOrientation(params));
+  bool oriented = op.transpose || op.flipX || op.flipY;
+  if (!oriented && r.width == w && r.height == h && outW == w && outH == h)
+    return pixels;
+  IMGC_TRACE_SCOPE("resize");
+  size_t bytes;
+  if (!params.limits.allowsImage(outW, outH) ||
+      !imageBytes(outW, outH, 4, bytes) || (hold && !hold->reserve(bytes)))
+    return nullptr;
+  size_t stride = (size_t)w * 4;
+  scratch.resize(bytes);
+  if (oriented && outW == r.width && outH == r.height) {
+    // 纯旋转/翻转（可带裁剪）：分块转置
+    orientCopyRGBA(pixels, w, h, (ptrdiff_t)stride, op, r, scratch.data(),
+                   params.threads);
+  } else if (oriented) {
+    // 方向变换与缩放在同一遍完成
+    orientResize<4>(pixels, w, h, (ptrdiff_t)stride, 4, op, r, scratch.data(),
+                    outW, outH, params.resize_algo, params.threads);
+  } else if (outW == r.width && outH == r.height) {
+    // 只裁剪
+    const uint8_t *src = pixels + (size_t)r.y * stride + (size_t)r.x * 4;
+    for (int y = 0; y < outH; ++y)
+      std::memcpy(&scratch[(size_t)y * outW * 4], src + (size_t)y * stride,
+                  (size_t)outW * 4);
+  } else {
+    const uint8_t *src = pixels + (size_t)r.y * stride + (size_t)r.x * 4;
+    resizeRGBA(src, r.width, r.height, scratch.data(), outW, outH,
+               params.resize_algo, stride, params.threads);
+  }
+  w = outW;
+  h = outH;
+  return scratch.data();
+}
+// 分块图像的方向变换与裁剪（不缩放）：逐个输出块取出对应的源区域（至多
+// 跨 2x2 个源块），在块内完成转置与翻转
+static bool orientTiled(tiled_image &src, const orient_ops &op,
+                        const crop_rect &r, tiled_image &dst) {
+  const int T = tiled_image::kTileSize;
+  if (!dst.create(r.width, r.height))
+    return false;
+  std::vector<uint8_t> buf((size_t)T * T * 4);
+  for (int ty = 0; ty < dst.tilesY(); ++ty) {
+    for (int tx = 0; tx < dst.tilesX(); ++tx) {
+      crop_rect dr;
+      dr.x = r.x + tx * T;
+      dr.y = r.y + ty * T;
+      dr.width = std::min(T, r.width - tx * T);
+      dr.height = std::min(T, r.height - ty * T);
+      crop_rect sr = regionToSource(dr, op, src.width(), src.height());
+      for (int y = 0; y < sr.height; ++y)
+        if (!src.readRow(sr.y + y, sr.x, sr.width,
+                         &buf[(size_t)y * sr.width * 4]))
+          return false;
+      uint8_t *t = dst.writeTile(tx, ty);
+      if (!t)
+        return false;
+      crop_rect local;
+      local.width = dr.width;
+      local.height = dr.height;
+      orientCopyRGBA(buf.data(), sr.width, sr.height, (ptrdiff_t)sr.width * 4,
+                     op, local, t, 1, (ptrdiff_t)T * 4);
+    }
+  }
+  return true;
+}
+// 分块图像的裁剪与缩放：按输出行流式处理，每个输出行读入一到两行源区域，
+// 采样坐标与 resizeRGBA 相同
+static bool resizeTiled(tiled_image &src, const crop_rect &r, tiled_image &dst,
+                        int outW, int outH, compress_params::ResizeAlgo algo) {
+  const kernel_table &k = kernels();
+  if (!dst.create(outW, outH))
+    return false;
+  std::vector<uint8_t> out((size_t)outW * 4);
+  if (outW == r.width && outH == r.height) {
+    for (int y = 0; y < outH; ++y)
+      if (!src.readRow(r.y + y, r.x, r.width, out.data()) ||
+          !dst.writeRow(y, 0, outW, out.data()))
+        return false;
+    return true;
+  }
+  // 最近两次读入的源行，双线性的相邻输出行多数共用源行
+  std::vector<uint8_t> cache[2];
+  cache[0].resize((size_t)r.width * 4);
+  cache[1].resize((size_t)r.width * 4);
+  int held[2] = {-1, -1};
+  int next = 0;
+  auto row = [&](int sy, int keep) -> const uint8_t * {
+    for (int i = 0; i < 2; ++i)
+      if (held[i] == sy)
+        return cache[i].data();
+    int i = held[next] == keep ? 1 - next : next;
+    next = 1 - i;
+    held[i] = -1;
+    if (!src.readRow(r.y + sy, r.x, r.width, cache[i].data()))
+      return nullptr;
+    held[i] = sy;
+    return cache[i].data();
+  };
+  int w = r.width, h = r.height;
+  if (algo == compress_params::ResizeAlgo::NEAREST) {
+    std::vector<int> xofs(outW);
+    for (int x = 0; x < outW; ++x)
+      xofs[x] = (int)((long long)x * w / outW);
+    for (int y = 0; y < outH; ++y) {
+      const uint8_t *s = row((int)((long long)y * h / outH), -1);
+      if (!s)
+        return false;
+      k.resize_nearest_row(s, xofs.data(), out.data(), outW);
+      if (!dst.writeRow(y, 0, outW, out.data()))
+        return false;
+    }
+    return true;
+  }
+  std::vector<int> xs0(outW), xs1(outW);
+  std::vector<float> wxs(outW);
+  for (int x = 0; x < outW; ++x) {
+    float srcX = (x + 0.5f) * w / outW - 0.5f;
+    xs0[x] = std::max(0, (int)std::floor(srcX));
+    xs1[x] = std::min(w - 1, xs0[x] + 1);
+    wxs[x] = srcX - xs0[x];
+  }
+  for (int y = 0; y < outH; ++y) {
+    float srcY = (y + 0.5f) * h / outH - 0.5f;
+    int y0 = std::max(0, (int)std::floor(srcY));
+    int y1 = std::min(h - 1, y0 + 1);
+    const uint8_t *r0 = row(y0, -1);
+    const uint8_t *r1 = r0 ? row(y1, y0) : nullptr;
+    if (!r1)
+      return false;
+    k.resize_bilinear_row(r0, r1, xs0.data(), xs1.data(), wxs.data(),
+                          srcY - y0, out.data(), outW);
+    if (!dst.writeRow(y, 0, outW, out.data()))
+      return false;
+  }
+  return true;
+}
+tiled_image *applyGeometryTiled(const compress_params &params,
+                                tiled_image &src, tiled_image &scratch) {
+  crop_rect r;
+  int outW, outH;
+  if (!resolveGeometry(params, src.width(), src.height(), r, outW, outH))
+    return nullptr;
+  orient_ops op = orientOps(geometryOrientation(params));
+  bool oriented = op.transpose || op.flipX || op.flipY;
+  bool resized = outW != r.width || outH != r.height;
+  if (!oriented && !resized && r.width == src.width() &&
+      r.height == src.height())
+    return &src;
+  IMGC_TRACE_SCOPE("resize");
+  if (!params.limits.allowsImage(outW, outH))
+    return nullptr;
+  if (!oriented)
+    return resizeTiled(src, r, scratch, outW, outH, params.resize_algo)
+               ? &scratch
+               : nullptr;
+  if (!orientTiled(src, op, r, scratch))
+    return nullptr;
+  if (!resized)
+    return &scratch;
+  // 方向变换后的区域已是整幅 scratch，缩放结果写回 src
+  crop_rect all;
+  all.width = r.width;
+  all.height = r.height;
+  return resizeTiled(scratch, all, src, outW, outH, params.resize_algo)
+             ? &src
+             : nullptr;
+}
+bool applyGeometryYUV(const compress_params &params, const YuvView &in,
+                      ImageYUV &out) {
+  IMGC_TRACE_SCOPE("resize");
+  crop_rect r;
+  int outW, outH;
+  if (!resolveGeometry(params, in.width, in.height, r, outW, outH) ||
+      !params.limits.allowsImage(outW, outH))
+    return false;
+  orient_ops op = orientOps(geometryOrientation(params));
+  // 色度区域：覆盖亮度区域的所有色度样本（方向变换后的色度坐标系）
+  crop_rect cr;
+  cr.x = r.x / 2;
+  cr.y = r.y / 2;
+  cr.width = (r.x + r.width + 1) / 2 - cr.x;
+  cr.height = (r.y + r.height + 1) / 2 - cr.y;
+  int ow = (outW + 1) / 2, oh = (outH + 1) / 2;
+  out.width = outW;
+  out.height = outH;
+  out.format = YuvFormat::I420;
+  out.strides[0] = outW;
+  out.strides[1] = out.strides[2] = ow;
+  out.planes[0].resize((size_t)outW * outH);
+  out.planes[1].resize((size_t)ow * oh);
+  out.planes[2].resize((size_t)ow * oh);
+  bool nv12 = in.format == YuvFormat::NV12;
+  int step = nv12 ? 2 : 1;
+  const uint8_t *src[3] = {in.planes[0], in.planes[1],
+                           nv12 ? in.planes[1] + 1 : in.planes[2]};
+  ptrdiff_t strides[3] = {in.strides[0], in.strides[1],
+                          nv12 ? in.strides[1] : in.strides[2]};
+  int pw[3] = {in.width, (in.width + 1) / 2, (in.width + 1) / 2};
+  int ph[3] = {in.height, (in.height + 1) / 2, (in.height + 1) / 2};
+  for (int i = 0; i < 3; ++i) {
+    const crop_rect &pr = i == 0 ? r : cr;
+    int dw = i == 0 ? outW : ow, dh = i == 0 ? outH : oh;
+    // 尺寸不变时退化为逐样本拷贝（最近邻恒等映射）
+    compress_params::ResizeAlgo algo =
+        (dw == pr.width && dh == pr.height) ? compress_params::ResizeAlgo::NEAREST
+                                            : params.resize_algo;
+    orientResize<1>(src[i], pw[i], ph[i], strides[i], i == 0 ? 1 : step, op,
+                    pr, out.planes[i].data(), dw, dh, algo, params.threads);
+  }
+  return true;
+}
+int decodeForParams(i_image_compressor &decoder, const uint8_t *inputBuffer,
+                    size_t inputSize, const compress_params &params,
+                    ImageRGBA &out, compress_params &encodeParams) {
+  encodeParams = params;
+  if (params.auto_orient)
+    encodeParams.orientation = readExifOrientation(inputBuffer, inputSize);
+  // 旋转与翻转并入方向，由编码器在缩放的同一遍完成
+  encodeParams.orientation = geometryOrientation(encodeParams);
+  encodeParams.rotation = compress_params::Rotation::NONE;
+  encodeParams.flip_horizontal = encodeParams.flip_vertical = false;
+  // 先读文件头：源尺寸、解码区域与输出尺寸都在限制内才分配内存
+  int srcW, srcH;
+  if (!decoder.readImageSize(inputBuffer, inputSize, srcW, srcH))
+    return -1;
+  if (!params.limits.allowsImage(srcW, srcH))
+    return kErrLimitExceeded;
+  crop_rect r;
+  int outW, outH;
+  if (!resolveGeometry(encodeParams, srcW, srcH, r, outW, outH))
+    return -1;
+  // 区域在方向变换后的坐标系中，解码前换回源图像坐标
+  r = orientRegionToSource(r, encodeParams.orientation, srcW, srcH);
+  if (!params.limits.allowsImage(outW, outH) ||
+      !params.limits.allowsDecoded((unsigned long long)r.width * r.height * 4))
+    return kErrLimitExceeded;
+  decode_params dp;
+  dp.limits = params.limits;
+  dp.threads = params.threads;
+  if (r.width != srcW || r.height != srcH) {
+    dp.crop_x = r.x;
+    dp.crop_y = r.y;
+    dp.crop_width = r.width;
+    dp.crop_height = r.height;
+  }
+  if (params.decode_speed == DecodeSpeed::FAST) {
+    // 快速模式下缩小输出时允许解码器直接解出较小的图像
+    dp.speed = DecodeSpeed::FAST;
+    bool t = orientOps(encodeParams.orientation).transpose;
+    int minW = t ? outH : outW, minH = t ? outW : outH;
+    if (minW < r.width && minH < r.height) {
+      dp.min_width = minW;
+      dp.min_height = minH;
+    }
+  }
+  if (!decoder.decodeToRGBA(inputBuffer, inputSize, out, dp))
+    return -1;
+  // 解码结果即输出区域，编码时只需方向变换与缩放
+  encodeParams.crop_x = encodeParams.crop_y = 0;
+  encodeParams.crop_width = encodeParams.crop_height = 0;
+  encodeParams.fit_mode = compress_params::FitMode::STRETCH;
+  encodeParams.output_width = outW;
+  encodeParams.output_height = outH;
+  encodeParams.auto_orient = false;
+  return 0;
+}
+void resizeImage(const ImageRGBA &src, ImageRGBA &dst, int newW, int newH,
+                 compress_params::ResizeAlgo algo, int threads) {
+  IMGC_TRACE_SCOPE("resize");
+  dst.width = newW;
+  dst.height = newH;
+  dst.pixels.resize((size_t)newW * newH * 4);
+  resizeRGBA(src.pixels.data(), src.width, src.height, dst.pixels.data(), newW,
+             newH, algo, 0, threads);
+}
+} // namespace imgc
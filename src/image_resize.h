@@ -0,0 +1,98 @@
+﻿#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "image_compress/compress_params.h"
+#include "image_compress/i_image_compressor.h"
+#include "image_compress/image_types.h"
+#include "image_compress/tiled_image.h"
+#include "memory_account.h"
+#include <cstdint>
+#include <vector>
+namespace imgc {
+// 源图像上的矩形区域
+struct crop_rect {
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+};
+// EXIF 方向分解为：先转置，再在转置后的坐标系中水平、垂直翻转
+struct orient_ops {
+  bool transpose;
+  bool flipX;
+  bool flipY;
+};
+orient_ops orientOps(int orientation);
+// 先按 first、再按 second 变换，等价的单一 EXIF 方向
+int composeOrientation(int first, int second);
+// params 的方向与旋转、翻转合并后的 EXIF 方向
+int geometryOrientation(const compress_params &params);
+// 方向变换后坐标系中的区域映射回 srcW*srcH 源图像中的区域
+crop_rect orientRegionToSource(const crop_rect &r, int orientation, int srcW,
+                               int srcH);
+// 按 params 的方向、裁剪、适配模式与输出尺寸，计算参与输出的区域（方向
+// 变换后的坐标系）和最终输出尺寸，srcW/srcH 为变换前的源尺寸；
+// 裁剪区域与图像不相交时返回 false
+bool resolveGeometry(const compress_params &params, int srcW, int srcH,
+                     crop_rect &region, int &outW, int &outH);
+// 对 RGBA 像素应用方向、裁剪与缩放（同一遍完成），w/h 更新为输出尺寸。无需处理时返回 pixels，
+// 否则结果写入 scratch 并返回其数据；区域无效或输出尺寸超出 params.limits
+// 时返回 nullptr。hold 非空时 scratch 的分配先经内存预算并计入 hold，
+// 预算拒绝同样返回 nullptr
+const uint8_t *applyGeometry(const compress_params &params,
+                             const uint8_t *pixels, int &w, int &h,
+                             std::vector<uint8_t> &scratch,
+                             memory_reservation *hold = nullptr);
+// 按 params 解码：先读取尺寸并检查 params.limits（源图像、解码区域与输出
+// 尺寸），只解出参与输出的区域，encodeParams 为对解码结果继续编码时应使用
+// 的参数（已去掉裁剪，只剩缩放）。成功返回 0，超出限制返回
+// kErrLimitExceeded，其他失败返回 -1
+int decodeForParams(i_image_compressor &decoder, const uint8_t *inputBuffer,
+                     size_t inputSize, const compress_params &params,
+                     ImageRGBA &out, compress_params &encodeParams);
+// RGBA 缩放：src 为 w*h，行间距 srcStride 字节（0 表示 w*4），
+// dst 需预先分配 newW*newH*4 字节；输出按行带分给至多 threads 个线程
+void resizeRGBA(const uint8_t *src, int w, int h, uint8_t *dst, int newW,
+                int newH, compress_params::ResizeAlgo algo,
+                size_t srcStride = 0, int threads = 0);
+// 单通道平面缩放：src 为 w*h，行间距 srcStride 字节，相邻样本间隔 step
+// 字节（NV12 的 UV 平面为 2）；dst 紧密排列，需预先分配 newW*newH 字节。
+// orientation 不为 1 时 newW*newH 针对方向变换后的平面
+void resizePlane(const uint8_t *src, int w, int h, ptrdiff_t srcStride,
+                 int step, uint8_t *dst, int newW, int newH,
+                 compress_params::ResizeAlgo algo, int threads = 0,
+                 int orientation = 1);
+// 对分块图像应用方向、裁剪与缩放。无需处理时返回 &src，否则返回存放结果的
+// scratch 或 src（方向变换与缩放都需要时，缩放结果写回 src，原内容被覆盖）；
+// 区域无效、输出尺寸超出限制或临时文件失败时返回 nullptr
+tiled_image *applyGeometryTiled(const compress_params &params,
+                                tiled_image &src, tiled_image &scratch);
+// 对 YUV 4:2:0 视图应用方向、裁剪与缩放，结果为紧密排列的 I420 并写入 out；
+// 色度区域按亮度区域折半取整。区域无效或输出尺寸超出限制时返回 false
+bool applyGeometryYUV(const compress_params &params, const YuvView &in,
+                      ImageYUV &out);
+// 缩放整幅 ImageRGBA 到 newW*newH
+void resizeImage(const ImageRGBA &src, ImageRGBA &dst, int newW, int newH,
+                 compress_params::ResizeAlgo algo, int threads = 0);
+} // namespace imgc
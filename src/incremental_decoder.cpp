@@ -0,0 +1,362 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "image_compress/incremental_decoder.h"
+#include "compressor_factory.h"
+#include "memory_account.h"
+#include "pixel_convert.h"
+#include "size_math.h"
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <jpeglib.h>
+#include <memory>
+#include <png.h>
+#include <vector>
+namespace imgc {
+// 出错时跳回调用点，而不是像 jpeg_std_error 那样退出进程：增量输入来自网络
+struct jpeg_push_error {
+  jpeg_error_mgr pub;
+  jmp_buf jump;
+};
+static void jpegPushErrorExit(j_common_ptr c) {
+  longjmp(((jpeg_push_error *)c->err)->jump, 1);
+}
+// 挂起式数据源：缓冲区读空时返回 FALSE，libjpeg 回退到最近的安全点，
+// 等下次 feed 补充数据后从该点继续
+struct jpeg_push_source {
+  jpeg_source_mgr pub;
+  size_t skip = 0; // 跨越 feed 边界、尚未跳过的字节数
+};
+static void jpegPushInit(j_decompress_ptr) {}
+static boolean jpegPushFill(j_decompress_ptr) { return FALSE; }
+static void jpegPushSkip(j_decompress_ptr c, long n) {
+  jpeg_push_source *s = (jpeg_push_source *)c->src;
+  if (n <= 0)
+    return;
+  if ((size_t)n > s->pub.bytes_in_buffer) {
+    s->skip += (size_t)n - s->pub.bytes_in_buffer;
+    s->pub.next_input_byte += s->pub.bytes_in_buffer;
+    s->pub.bytes_in_buffer = 0;
+  } else {
+    s->pub.next_input_byte += n;
+    s->pub.bytes_in_buffer -= (size_t)n;
+  }
+}
+static void jpegPushTerm(j_decompress_ptr) {}
+
+struct incremental_decoder::impl {
+  enum class Stage { DETECT, JPEG, PNG, BUFFERED, DONE, FAILED };
+  decode_limits limits;
+  row_callback onRows;
+  Stage stage = Stage::DETECT;
+  ImageFormat format = ImageFormat::UNKNOWN;
+  std::vector<uint8_t> pending; // 尚未交给解码器（或 libjpeg 尚未消费）的输入
+  ImageRGBA img;
+  // img 的缓冲经内存预算，计入解析出文件头的调用所在的作用域，
+  // 随解码器销毁释放
+  std::unique_ptr<memory_reservation> hold;
+  bool header = false;
+  bool limitHit = false;
+  int rows = 0;
+  // JPEG
+  jpeg_decompress_struct cinfo;
+  jpeg_push_error jerr;
+  jpeg_push_source src;
+  bool jpegActive = false;
+  int jpegStep = 0; // 0 读文件头，1 开始解压，2 读行，3 等待 EOI
+  std::vector<uint8_t> row;
+  // PNG
+  png_structp png = nullptr;
+  png_infop info = nullptr;
+  bool interlaced = false;
+
+  ~impl() {
+    if (jpegActive)
+      jpeg_destroy_decompress(&cinfo);
+    if (png)
+      png_destroy_read_struct(&png, info ? &info : nullptr, nullptr);
+  }
+  bool fail(bool limit) {
+    stage = Stage::FAILED;
+    limitHit = limitHit || limit;
+    return false;
+  }
+  // 缓冲字节数超出 size_t 或预算拒绝时返回 false，预算拒绝视为超出限制
+  bool allocate(int w, int h) {
+    size_t bytes;
+    if (!imageBytes(w, h, 4, bytes))
+      return false;
+    hold.reset(new memory_reservation);
+    if (!hold->reserve(bytes)) {
+      limitHit = true;
+      return false;
+    }
+    img.width = w;
+    img.height = h;
+    img.pixels.assign(bytes, 0);
+    header = true;
+    return true;
+  }
+  void report(int before) {
+    if (rows > before && onRows)
+      onRows(before, rows - before);
+  }
+  bool begin(ImageFormat f);
+  bool push(const uint8_t *data, size_t size);
+  bool runJpeg();
+  bool pushPng(const uint8_t *data, size_t size);
+  static void pngInfo(png_structp p, png_infop info);
+  static void pngRow(png_structp p, png_bytep newRow, png_uint_32 y, int pass);
+  static void pngEnd(png_structp p, png_infop);
+};
+
+void incremental_decoder::impl::pngInfo(png_structp p, png_infop info) {
+  impl *d = (impl *)png_get_progressive_ptr(p);
+  png_uint_32 w = png_get_image_width(p, info);
+  png_uint_32 h = png_get_image_height(p, info);
+  if (!d->limits.allowsImage(w, h) ||
+      !d->limits.allowsDecoded((unsigned long long)w * h * 4)) {
+    d->limitHit = true;
+    png_error(p, "limit exceeded");
+  }
+  // 与 png_compressor 相同的变换：统一输出 8 位 RGBA
+  int bd = png_get_bit_depth(p, info);
+  int ct = png_get_color_type(p, info);
+  if (bd == 16)
+    png_set_strip_16(p);
+  if (ct == PNG_COLOR_TYPE_PALETTE)
+    png_set_palette_to_rgb(p);
+  if (ct == PNG_COLOR_TYPE_GRAY && bd < 8)
+    png_set_expand_gray_1_2_4_to_8(p);
+  if (png_get_valid(p, info, PNG_INFO_tRNS))
+    png_set_tRNS_to_alpha(p);
+  if (ct == PNG_COLOR_TYPE_RGB || ct == PNG_COLOR_TYPE_GRAY)
+    png_set_filler(p, 0xFF, PNG_FILLER_AFTER);
+  if (ct == PNG_COLOR_TYPE_GRAY || ct == PNG_COLOR_TYPE_GRAY_ALPHA)
+    png_set_gray_to_rgb(p);
+  d->interlaced = png_set_interlace_handling(p) > 1;
+  png_read_update_info(p, info);
+  if (!d->allocate((int)w, (int)h))
+    png_error(p, "image too large");
+}
+void incremental_decoder::impl::pngRow(png_structp p, png_bytep newRow,
+                                       png_uint_32 y, int pass) {
+  impl *d = (impl *)png_get_progressive_ptr(p);
+  if (!newRow || y >= (png_uint_32)d->img.height)
+    return;
+  png_progressive_combine_row(
+      p, &d->img.pixels[(size_t)y * d->img.width * 4], newRow);
+  // 隔行图像：偶数行在第 6 遍后完整，第 7 遍逐个补齐奇数行
+  if (!d->interlaced || pass == 6)
+    d->rows = (int)y + 1;
+}
+void incremental_decoder::impl::pngEnd(png_structp p, png_infop) {
+  impl *d = (impl *)png_get_progressive_ptr(p);
+  d->rows = d->img.height;
+  d->stage = Stage::DONE;
+}
+
+bool incremental_decoder::impl::begin(ImageFormat f) {
+  format = f;
+  if (f == ImageFormat::JPEG) {
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = jpegPushErrorExit;
+    jpeg_create_decompress(&cinfo);
+    trackJpegMemory((j_common_ptr)&cinfo);
+    jpegActive = true;
+    src.pub.init_source = jpegPushInit;
+    src.pub.fill_input_buffer = jpegPushFill;
+    src.pub.skip_input_data = jpegPushSkip;
+    src.pub.resync_to_restart = jpeg_resync_to_restart;
+    src.pub.term_source = jpegPushTerm;
+    src.pub.next_input_byte = nullptr;
+    src.pub.bytes_in_buffer = 0;
+    cinfo.src = &src.pub;
+    stage = Stage::JPEG;
+    return true;
+  }
+  if (f == ImageFormat::PNG) {
+    png = png_create_read_struct_2(PNG_LIBPNG_VER_STRING, nullptr, nullptr,
+                                   nullptr, nullptr, pngTrackedMalloc,
+                                   pngTrackedFree);
+    if (!png)
+      return fail(false);
+    info = png_create_info_struct(png);
+    if (!info)
+      return fail(false);
+    png_set_progressive_read_fn(png, this, pngInfo, pngRow, pngEnd);
+    stage = Stage::PNG;
+    return true;
+  }
+  if (f == ImageFormat::BMP || f == ImageFormat::QOI) {
+    stage = Stage::BUFFERED;
+    return true;
+  }
+  return fail(false);
+}
+bool incremental_decoder::impl::push(const uint8_t *data, size_t size) {
+  if (stage == Stage::PNG)
+    return pushPng(data, size);
+  if (stage == Stage::BUFFERED) {
+    pending.insert(pending.end(), data, data + size);
+    return true;
+  }
+  if (stage != Stage::JPEG)
+    return stage != Stage::FAILED;
+  // 丢弃 libjpeg 已消费的前缀，未消费部分（含挂起时回退的字节）保留
+  size_t used = src.pub.next_input_byte
+                    ? (size_t)(src.pub.next_input_byte - pending.data())
+                    : 0;
+  pending.erase(pending.begin(), pending.begin() + used);
+  size_t k = std::min(src.skip, size);
+  src.skip -= k;
+  pending.insert(pending.end(), data + k, data + size);
+  src.pub.next_input_byte = pending.data();
+  src.pub.bytes_in_buffer = pending.size();
+  return runJpeg();
+}
+bool incremental_decoder::impl::runJpeg() {
+  if (setjmp(jerr.jump))
+    return fail(false);
+  if (jpegStep == 0) {
+    if (jpeg_read_header(&cinfo, TRUE) == JPEG_SUSPENDED)
+      return true;
+    if (!limits.allowsImage(cinfo.image_width, cinfo.image_height) ||
+        !limits.allowsDecoded((unsigned long long)cinfo.image_width *
+                              cinfo.image_height * 4))
+      return fail(true);
+    cinfo.out_color_space = JCS_RGB;
+    if (!allocate((int)cinfo.image_width, (int)cinfo.image_height))
+      return fail(false);
+    jpegStep = 1;
+  }
+  if (jpegStep == 1) {
+    // 渐进式图像在此吸收全部扫描，数据不足时挂起
+    if (!jpeg_start_decompress(&cinfo))
+      return true;
+    row.resize((size_t)cinfo.output_width * cinfo.output_components);
+    jpegStep = 2;
+  }
+  if (jpegStep == 2) {
+    while (cinfo.output_scanline < cinfo.output_height) {
+      JSAMPROW rp = row.data();
+      if (jpeg_read_scanlines(&cinfo, &rp, 1) != 1)
+        return true;
+      convertPixels<layout_rgb, layout_rgba>(
+          row.data(), &img.pixels[(size_t)rows * img.width * 4], img.width);
+      ++rows;
+    }
+    jpegStep = 3;
+  }
+  if (jpeg_finish_decompress(&cinfo))
+    stage = Stage::DONE;
+  return true;
+}
+bool incremental_decoder::impl::pushPng(const uint8_t *data, size_t size) {
+  if (setjmp(png_jmpbuf(png)))
+    return fail(limitHit);
+  png_process_data(png, info, const_cast<png_bytep>(data), size);
+  return true;
+}
+
+incremental_decoder::incremental_decoder(const decode_limits &limits)
+    : impl_(new impl) {
+  impl_->limits = limits;
+}
+incremental_decoder::~incremental_decoder() { delete impl_; }
+void incremental_decoder::setRowCallback(const row_callback &cb) {
+  impl_->onRows = cb;
+}
+bool incremental_decoder::feed(const uint8_t *data, size_t size) {
+  impl &d = *impl_;
+  if (d.stage == impl::Stage::FAILED)
+    return false;
+  if (d.stage == impl::Stage::DONE || !data || size == 0)
+    return true;
+  int before = d.rows;
+  bool ok;
+  if (d.stage == impl::Stage::DETECT) {
+    // 凑够最长的文件签名（PNG 8 字节）再识别格式
+    d.pending.insert(d.pending.end(), data, data + size);
+    if (d.pending.size() < 8)
+      return true;
+    std::vector<uint8_t> head;
+    head.swap(d.pending);
+    ok = d.begin(detectImageFormat(head.data(), head.size())) &&
+         d.push(head.data(), head.size());
+  } else {
+    ok = d.push(data, size);
+  }
+  d.report(before);
+  return ok;
+}
+bool incremental_decoder::finish() {
+  impl &d = *impl_;
+  if (d.stage == impl::Stage::DETECT) {
+    std::vector<uint8_t> head;
+    head.swap(d.pending);
+    if (!d.begin(detectImageFormat(head.data(), head.size())) ||
+        !d.push(head.data(), head.size()))
+      return false;
+  }
+  if (d.stage == impl::Stage::BUFFERED) {
+    auto dec = makeDecoder(d.format);
+    decode_params dp;
+    dp.limits = d.limits;
+    int w, h;
+    if (!dec || !dec->readImageSize(d.pending.data(), d.pending.size(), w, h))
+      return d.fail(false);
+    if (!d.limits.allowsImage(w, h))
+      return d.fail(true);
+    if (!dec->decodeToRGBA(d.pending.data(), d.pending.size(), d.img, dp))
+      return d.fail(false);
+    d.header = true;
+    d.rows = d.img.height;
+    d.pending.clear();
+    d.stage = impl::Stage::DONE;
+    d.report(0);
+    return true;
+  }
+  if (d.stage == impl::Stage::DONE)
+    return true;
+  // 所有行都已解出时容忍缺失的 EOI / IEND
+  if (d.stage != impl::Stage::FAILED && d.header && d.rows == d.img.height) {
+    d.stage = impl::Stage::DONE;
+    return true;
+  }
+  return d.fail(false);
+}
+bool incremental_decoder::headerReady() const { return impl_->header; }
+int incremental_decoder::width() const { return impl_->img.width; }
+int incremental_decoder::height() const { return impl_->img.height; }
+int incremental_decoder::rowsReady() const { return impl_->rows; }
+bool incremental_decoder::done() const {
+  return impl_->stage == impl::Stage::DONE;
+}
+bool incremental_decoder::failed() const {
+  return impl_->stage == impl::Stage::FAILED;
+}
+bool incremental_decoder::limitExceeded() const { return impl_->limitHit; }
+const ImageRGBA &incremental_decoder::image() const { return impl_->img; }
+} // namespace imgc
@@ -22,6 +22,14 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 #include "image_compress/jpeg_compressor.h"
+#include "image_compress/image_converter.h"
+#include "image_compress/image_metrics.h"
+#include "image_compress/trace.h"
+#include "image_resize.h"
+#include "memory_account.h"
+#include "pixel_convert.h"
+#include "size_math.h"
+#include <csetjmp>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -29,48 +37,502 @@ SOFTWARE.
 #include <vector>
 #include <algorithm>
 namespace imgc {
+// ITU-T T.81 附录 K 标准色度量化表（自然顺序），libjpeg 未导出
+static const unsigned int kStdChromaQuant[DCTSIZE2] = {
+    17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99};
+// 出错（含内存预算拒绝分配）时跳回调用点，而不是像 jpeg_std_error 那样
+// 退出进程
+struct jpeg_jump_error {
+  jpeg_error_mgr pub;
+  jmp_buf jump;
+};
+static void jpegJumpErrorExit(j_common_ptr c) {
+  longjmp(((jpeg_jump_error *)c->err)->jump, 1);
+}
+static jpeg_error_mgr *jumpErrors(jpeg_jump_error &e) {
+  jpeg_std_error(&e.pub);
+  e.pub.error_exit = jpegJumpErrorExit;
+  return &e.pub;
+}
+// 质量、色度量化、DCT 算法、熵编码与渐进等与输入格式无关的编码选项，
+// 须在 jpeg_set_defaults 之后调用
+static void applyEncodeOptions(jpeg_compress_struct &ccomp,
+                               const compress_params &params) {
+  int q = std::min(std::max(params.quality, 1), 100);
+  jpeg_set_quality(&ccomp, q, TRUE);
+  // 色度单独量化：按 libjpeg 的质量换算缩放标准色度表
+  if (params.jpeg_chroma_quality > 0) {
+    int cq = std::min(params.jpeg_chroma_quality, 100);
+    jpeg_add_quant_table(&ccomp, 1, kStdChromaQuant, jpeg_quality_scaling(cq),
+                         TRUE);
+  }
+  switch (params.jpeg_dct_method) {
+  case compress_params::JpegDctMethod::IFAST:
+    ccomp.dct_method = JDCT_IFAST;
+    break;
+  case compress_params::JpegDctMethod::FLOAT:
+    ccomp.dct_method = JDCT_FLOAT;
+    break;
+  default:
+    ccomp.dct_method = JDCT_ISLOW;
+    break;
+  }
+  ccomp.optimize_coding = params.jpeg_optimize_coding ? TRUE : FALSE;
+  if (params.jpeg_restart_rows > 0)
+    ccomp.restart_in_rows = params.jpeg_restart_rows;
+  if (params.jpeg_progressive)
+    jpeg_simple_progression(&ccomp);
+}
+// 色度采样（亮度分量的采样因子，色度分量保持 1x1）
+static void applySubsampling(jpeg_compress_struct &ccomp,
+                             const compress_params &params) {
+  switch (params.jpeg_subsampling) {
+  case compress_params::JpegSubsampling::S444:
+    ccomp.comp_info[0].h_samp_factor = 1;
+    ccomp.comp_info[0].v_samp_factor = 1;
+    break;
+  case compress_params::JpegSubsampling::S422:
+    ccomp.comp_info[0].h_samp_factor = 2;
+    ccomp.comp_info[0].v_samp_factor = 1;
+    break;
+  default:
+    ccomp.comp_info[0].h_samp_factor = 2;
+    ccomp.comp_info[0].v_samp_factor = 2;
+    break;
+  }
+}
 bool jpeg_compressor::decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
                                    ImageRGBA &outRGBA) {
+  return decodeToRGBA(inputBuffer, inputSize, outRGBA, decode_params());
+}
+bool jpeg_compressor::decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
+                                   ImageRGBA &outRGBA,
+                                   const decode_params &params) {
+  IMGC_TRACE_SCOPE("decode");
   if (!inputBuffer || inputSize < 3)
     return false;
   jpeg_decompress_struct cinfo;
-  jpeg_error_mgr jerr;
-  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_jump_error jerr;
+  cinfo.err = jumpErrors(jerr);
   jpeg_create_decompress(&cinfo);
+  // 跳回时仍需析构的对象在 setjmp 之前定义
+  memory_reservation hold;
+  std::vector<uint8_t> row;
+  if (setjmp(jerr.jump)) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+  trackJpegMemory((j_common_ptr)&cinfo);
   jpeg_mem_src(&cinfo, const_cast<unsigned char *>(inputBuffer), inputSize);
   if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
     jpeg_destroy_decompress(&cinfo);
     return false;
   }
   cinfo.out_color_space = JCS_RGB;
+  // 裁剪区域（原图坐标），截到图像范围内
+  unsigned int imgW = cinfo.image_width, imgH = cinfo.image_height;
+  unsigned int rx = 0, ry = 0, rw = imgW, rh = imgH;
+  if (params.crop_width > 0 && params.crop_height > 0) {
+    rx = (unsigned int)std::max(params.crop_x, 0);
+    ry = (unsigned int)std::max(params.crop_y, 0);
+    if (rx >= imgW || ry >= imgH) {
+      jpeg_destroy_decompress(&cinfo);
+      return false;
+    }
+    rw = std::min((unsigned int)params.crop_width, imgW - rx);
+    rh = std::min((unsigned int)params.crop_height, imgH - ry);
+  }
+  // 资源限制：在 jpeg_start_decompress 分配行缓冲与系数缓冲之前检查
+  if (!params.limits.allowsImage(imgW, imgH) ||
+      !params.limits.allowsDecoded((unsigned long long)rw * rh * 4)) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+  // DCT 域缩放：取满足最小尺寸要求的最小比例 n/8
+  if (params.min_width > 0 && params.min_height > 0) {
+    for (unsigned int n = 1; n <= 8; ++n) {
+      if ((rw * n + 7) / 8 >= (unsigned int)params.min_width &&
+          (rh * n + 7) / 8 >= (unsigned int)params.min_height) {
+        cinfo.scale_num = n;
+        cinfo.scale_denom = 8;
+        break;
+      }
+    }
+  }
+  // 快速模式：整数快速 IDCT，关闭色度平滑上采样与渐进式块平滑
+  if (params.speed == DecodeSpeed::FAST) {
+    cinfo.dct_method = JDCT_IFAST;
+    cinfo.do_fancy_upsampling = FALSE;
+    cinfo.do_block_smoothing = FALSE;
+  }
+  // 渐进式图像只取前若干次扫描：缓冲图像模式下读到目标扫描即输出
+  bool buffered =
+      params.max_progressive_scans > 0 && jpeg_has_multiple_scans(&cinfo);
+  cinfo.buffered_image = buffered ? TRUE : FALSE;
   jpeg_start_decompress(&cinfo);
-  int width = (int)cinfo.output_width, height = (int)cinfo.output_height;
+  if (buffered) {
+    for (;;) {
+      int r = jpeg_consume_input(&cinfo);
+      if (r == JPEG_REACHED_EOI || r == JPEG_SUSPENDED ||
+          (r == JPEG_SCAN_COMPLETED &&
+           cinfo.input_scan_number >= params.max_progressive_scans))
+        break;
+    }
+    jpeg_start_output(&cinfo, cinfo.input_scan_number);
+  }
+  // 裁剪区域换算到缩放后的输出坐标
+  unsigned long long ow = cinfo.output_width, oh = cinfo.output_height;
+  JDIMENSION x0 = (JDIMENSION)(rx * ow / imgW);
+  JDIMENSION x1 = (JDIMENSION)(((rx + rw) * ow + imgW - 1) / imgW);
+  JDIMENSION y0 = (JDIMENSION)(ry * oh / imgH);
+  JDIMENSION y1 = (JDIMENSION)(((ry + rh) * oh + imgH - 1) / imgH);
+  int width = (int)(x1 - x0), height = (int)(y1 - y0);
   int channels = (int)cinfo.output_components;
+  // skipCols 为解码行中裁剪区域的起始列
+  JDIMENSION skipCols = x0;
+#if defined(LIBJPEG_TURBO_VERSION_NUMBER) && LIBJPEG_TURBO_VERSION_NUMBER >= 1005000
+  // libjpeg-turbo：只解码覆盖裁剪区域的 iMCU 列，跳过区域上方的行
+  // 区域向外多留一个 iMCU：色度平滑上采样在解码边界按图像边缘处理，
+  // 留出余量后区域内像素与整幅解码一致
+#if JPEG_LIB_VERSION >= 70
+  JDIMENSION mx = cinfo.max_h_samp_factor * cinfo.min_DCT_h_scaled_size;
+  JDIMENSION my = cinfo.max_v_samp_factor * cinfo.min_DCT_v_scaled_size;
+#else
+  JDIMENSION mx = cinfo.max_h_samp_factor * cinfo.min_DCT_scaled_size;
+  JDIMENSION my = cinfo.max_v_samp_factor * cinfo.min_DCT_scaled_size;
+#endif
+  if (!buffered && (x0 > 0 || x1 < cinfo.output_width)) {
+    JDIMENSION xoff = x0 > mx ? x0 - mx : 0;
+    JDIMENSION cw = std::min(x1 + mx, (JDIMENSION)cinfo.output_width) - xoff;
+    jpeg_crop_scanline(&cinfo, &xoff, &cw);
+    skipCols = x0 - xoff;
+  }
+  if (!buffered && y0 > my)
+    jpeg_skip_scanlines(&cinfo, y0 - my);
+#endif
+  size_t bytes;
+  if (!imageBytes(width, height, 4, bytes) || !hold.reserve(bytes)) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
   outRGBA.width = width;
   outRGBA.height = height;
-  outRGBA.pixels.assign((size_t)width * height * 4, 255);
-  std::vector<uint8_t> row((size_t)width * channels);
-  while (cinfo.output_scanline < cinfo.output_height) {
+  outRGBA.pixels.assign(bytes, 255);
+  row.resize((size_t)cinfo.output_width * channels);
+  hold.add(row.size());
+  while (cinfo.output_scanline < y1) {
     JSAMPROW rowptr = row.data();
     jpeg_read_scanlines(&cinfo, &rowptr, 1);
-    size_t y = cinfo.output_scanline - 1;
-    uint8_t *dst = &outRGBA.pixels[y * (size_t)width * 4];
-    for (int x = 0; x < width; ++x) {
-      dst[x * 4 + 0] = row[x * channels + 0];
-      dst[x * 4 + 1] = row[x * channels + 1];
-      dst[x * 4 + 2] = row[x * channels + 2];
-      dst[x * 4 + 3] = 255;
+    JDIMENSION y = cinfo.output_scanline - 1;
+    if (y < y0)
+      continue;
+    uint8_t *dst = &outRGBA.pixels[(size_t)(y - y0) * width * 4];
+    convertPixels<layout_rgb, layout_rgba>(&row[(size_t)skipCols * channels],
+                                           dst, width);
+  }
+  // 区域下方的行与剩余扫描不再解码
+  if (buffered || cinfo.output_scanline < cinfo.output_height)
+    jpeg_abort_decompress(&cinfo);
+  else
+    jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  return true;
+}
+bool jpeg_compressor::decodeToPlanes(const uint8_t *inputBuffer,
+                                     size_t inputSize, ImagePlanes &outPlanes,
+                                     const decode_limits &limits) {
+  IMGC_TRACE_SCOPE("decode");
+  if (!inputBuffer || inputSize < 3)
+    return false;
+  jpeg_decompress_struct cinfo;
+  jpeg_jump_error jerr;
+  cinfo.err = jumpErrors(jerr);
+  jpeg_create_decompress(&cinfo);
+  memory_reservation hold;
+  std::vector<std::vector<JSAMPROW> > rows;
+  std::vector<JSAMPARRAY> arrays;
+  if (setjmp(jerr.jump)) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+  trackJpegMemory((j_common_ptr)&cinfo);
+  jpeg_mem_src(&cinfo, const_cast<unsigned char *>(inputBuffer), inputSize);
+  if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK ||
+      (cinfo.jpeg_color_space != JCS_YCbCr &&
+       cinfo.jpeg_color_space != JCS_GRAYSCALE) ||
+      !limits.allowsImage(cinfo.image_width, cinfo.image_height) ||
+      !limits.allowsDecoded((unsigned long long)cinfo.image_width *
+                            cinfo.image_height * cinfo.num_components)) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+  // raw 输出：IDCT 后直接交出各分量的降采样数据
+  cinfo.out_color_space = cinfo.jpeg_color_space;
+  cinfo.raw_data_out = TRUE;
+  cinfo.do_fancy_upsampling = FALSE;
+  jpeg_start_decompress(&cinfo);
+
+  int nc = cinfo.num_components;
+  outPlanes.width = (int)cinfo.output_width;
+  outPlanes.height = (int)cinfo.output_height;
+  outPlanes.planes.assign(nc, ImagePlane());
+  // 每个 iMCU 行各分量输出 v_samp*DCTSIZE 行，行宽按 MCU 补齐；
+  // 行指针直接指向平面存储，结束后截去补齐的行
+  rows.resize(nc);
+  arrays.resize(nc);
+  for (int ci = 0; ci < nc; ++ci) {
+    jpeg_component_info &comp = cinfo.comp_info[ci];
+    ImagePlane &pl = outPlanes.planes[ci];
+    int hs = comp.h_samp_factor, vs = comp.v_samp_factor;
+    pl.width = (int)comp.downsampled_width;
+    pl.height = (int)comp.downsampled_height;
+    pl.h_samp = hs;
+    pl.v_samp = vs;
+    pl.stride = (int)((comp.width_in_blocks + hs - 1) / hs * hs) * DCTSIZE;
+    size_t bytes = (size_t)pl.stride * cinfo.total_iMCU_rows * vs * DCTSIZE;
+    if (!hold.reserve(bytes)) {
+      jpeg_destroy_decompress(&cinfo);
+      return false;
     }
+    pl.data.resize(bytes);
+    rows[ci].resize((size_t)vs * DCTSIZE);
+    arrays[ci] = rows[ci].data();
   }
-  jpeg_finish_decompress(&cinfo);
+  JDIMENSION lines = (JDIMENSION)(cinfo.max_v_samp_factor * DCTSIZE);
+  for (JDIMENSION imcu = 0; cinfo.output_scanline < cinfo.output_height;
+       ++imcu) {
+    for (int ci = 0; ci < nc; ++ci) {
+      ImagePlane &pl = outPlanes.planes[ci];
+      size_t first = (size_t)imcu * rows[ci].size();
+      for (size_t r = 0; r < rows[ci].size(); ++r)
+        rows[ci][r] = &pl.data[(first + r) * pl.stride];
+    }
+    if (jpeg_read_raw_data(&cinfo, arrays.data(), lines) == 0)
+      break;
+  }
+  bool ok = cinfo.output_scanline >= cinfo.output_height;
+  if (ok)
+    jpeg_finish_decompress(&cinfo);
+  else
+    jpeg_abort_decompress(&cinfo);
   jpeg_destroy_decompress(&cinfo);
+  for (int ci = 0; ci < nc; ++ci) {
+    ImagePlane &pl = outPlanes.planes[ci];
+    pl.data.resize((size_t)pl.stride * pl.height);
+  }
+  return ok;
+}
+// 将任意采样的色度平面重采样到 4:2:0 网格（cw*ch）：每个目标样本取其
+// 覆盖的 2x2 亮度区域所对应源样本的平均。dst 相邻样本间隔 step 字节
+static void chromaTo420(const ImagePlane &src, int hmax, int vmax,
+                        uint8_t *dst, int dstStride, int step, int cw,
+                        int ch) {
+  std::vector<int> xs0(cw), xs1(cw);
+  for (int x = 0; x < cw; ++x) {
+    xs0[x] = std::min(2 * x * src.h_samp / hmax, src.width - 1);
+    xs1[x] = std::min(std::max(xs0[x] + 1,
+                               ((2 * x + 2) * src.h_samp + hmax - 1) / hmax),
+                      src.width);
+  }
+  for (int y = 0; y < ch; ++y) {
+    int y0 = std::min(2 * y * src.v_samp / vmax, src.height - 1);
+    int y1 = std::min(std::max(y0 + 1,
+                               ((2 * y + 2) * src.v_samp + vmax - 1) / vmax),
+                      src.height);
+    uint8_t *d = dst + (size_t)y * dstStride;
+    for (int x = 0; x < cw; ++x) {
+      int sum = 0;
+      for (int sy = y0; sy < y1; ++sy) {
+        const uint8_t *s = &src.data[(size_t)sy * src.stride];
+        for (int sx = xs0[x]; sx < xs1[x]; ++sx)
+          sum += s[sx];
+      }
+      int n = (y1 - y0) * (xs1[x] - xs0[x]);
+      d[x * step] = (uint8_t)((sum + n / 2) / n);
+    }
+  }
+}
+bool jpeg_compressor::decodeToYUV(const uint8_t *inputBuffer, size_t inputSize,
+                                  ImageYUV &outYUV, YuvFormat format,
+                                  const decode_limits &limits) {
+  ImagePlanes pl;
+  if (!decodeToPlanes(inputBuffer, inputSize, pl, limits))
+    return false;
+  int w = pl.width, h = pl.height;
+  int cw = (w + 1) / 2, ch = (h + 1) / 2;
+  bool nv12 = format == YuvFormat::NV12;
+  outYUV.width = w;
+  outYUV.height = h;
+  outYUV.format = format;
+  outYUV.strides[0] = w;
+  outYUV.strides[1] = nv12 ? cw * 2 : cw;
+  outYUV.strides[2] = nv12 ? 0 : cw;
+  // 亮度：行宽已紧密时直接接管存储
+  ImagePlane &y = pl.planes[0];
+  if (y.stride == w) {
+    outYUV.planes[0].swap(y.data);
+  } else {
+    outYUV.planes[0].resize((size_t)w * h);
+    for (int r = 0; r < h; ++r)
+      std::memcpy(&outYUV.planes[0][(size_t)r * w],
+                  &y.data[(size_t)r * y.stride], w);
+  }
+  outYUV.planes[1].resize((size_t)outYUV.strides[1] * ch);
+  outYUV.planes[2].resize(nv12 ? 0 : (size_t)cw * ch);
+  if (pl.planes.size() < 3) {
+    std::memset(outYUV.planes[1].data(), 128, outYUV.planes[1].size());
+    std::memset(outYUV.planes[2].data(), 128, outYUV.planes[2].size());
+    return true;
+  }
+  int hmax = 1, vmax = 1;
+  for (size_t i = 0; i < pl.planes.size(); ++i) {
+    hmax = std::max(hmax, pl.planes[i].h_samp);
+    vmax = std::max(vmax, pl.planes[i].v_samp);
+  }
+  for (int ci = 1; ci < 3; ++ci) {
+    const ImagePlane &c = pl.planes[ci];
+    uint8_t *dst = nv12 ? &outYUV.planes[1][ci - 1] : outYUV.planes[ci].data();
+    int step = nv12 ? 2 : 1;
+    if (c.width == cw && c.height == ch && 2 * c.h_samp == hmax &&
+        2 * c.v_samp == vmax) {
+      // 已是 4:2:0：逐行拷贝（NV12 时交错写入）
+      for (int r = 0; r < ch; ++r) {
+        const uint8_t *s = &c.data[(size_t)r * c.stride];
+        uint8_t *d = dst + (size_t)r * outYUV.strides[nv12 ? 1 : ci];
+        if (step == 1) {
+          std::memcpy(d, s, cw);
+        } else {
+          for (int x = 0; x < cw; ++x)
+            d[x * 2] = s[x];
+        }
+      }
+    } else {
+      chromaTo420(c, hmax, vmax, dst, outYUV.strides[nv12 ? 1 : ci], step, cw,
+                  ch);
+    }
+  }
   return true;
 }
-int jpeg_compressor::encodeFromRGBA(const ImageRGBA &rgba,
-                                    std::vector<uint8_t> &outputBuffer,
-                                    const compress_params &params) {
-  if (rgba.width <= 0 || rgba.height <= 0 ||
-      rgba.pixels.size() < (size_t)rgba.width * rgba.height * 4)
+bool jpeg_compressor::readImageSize(const uint8_t *inputBuffer,
+                                    size_t inputSize, int &width, int &height) {
+  IMGC_TRACE_SCOPE("header");
+  if (!inputBuffer || inputSize < 3)
+    return false;
+  jpeg_decompress_struct cinfo;
+  jpeg_jump_error jerr;
+  cinfo.err = jumpErrors(jerr);
+  jpeg_create_decompress(&cinfo);
+  if (setjmp(jerr.jump)) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+  trackJpegMemory((j_common_ptr)&cinfo);
+  jpeg_mem_src(&cinfo, const_cast<unsigned char *>(inputBuffer), inputSize);
+  bool ok = jpeg_read_header(&cinfo, TRUE) == JPEG_HEADER_OK;
+  if (ok) {
+    width = (int)cinfo.image_width;
+    height = (int)cinfo.image_height;
+  }
+  jpeg_destroy_decompress(&cinfo);
+  return ok;
+}
+// --------------------
+// JPEG 写入：紧密排列的 RGBA 像素，按 params 的质量与编码选项
+// --------------------
+static int64_t writeJpeg(const uint8_t *pixelData, int w, int h,
+                         std::vector<uint8_t> &outputBuffer,
+                         const compress_params &params) {
+  jpeg_compress_struct ccomp;
+  jpeg_jump_error jerr2;
+  ccomp.err = jumpErrors(jerr2);
+  jpeg_create_compress(&ccomp);
+
+  unsigned char *outbuf = nullptr;
+  unsigned long outsize = 0;
+  memory_reservation hold;
+  std::vector<uint8_t> row;
+  if (setjmp(jerr2.jump)) {
+    jpeg_destroy_compress(&ccomp);
+    free(outbuf);
+    return -1;
+  }
+  trackJpegMemory((j_common_ptr)&ccomp);
+  jpeg_mem_dest(&ccomp, &outbuf, &outsize);
+
+  ccomp.image_width = w;
+  ccomp.image_height = h;
+  ccomp.input_components = 3;
+  ccomp.in_color_space = JCS_RGB;
+
+  jpeg_set_defaults(&ccomp);
+
+  applyEncodeOptions(ccomp, params);
+  applySubsampling(ccomp, params);
+
+  jpeg_start_compress(&ccomp, TRUE);
+
+  row.resize((size_t)w * 3);
+  hold.add(row.size());
+  while (ccomp.next_scanline < ccomp.image_height) {
+    const uint8_t *src = &pixelData[(size_t)ccomp.next_scanline * w * 4];
+    convertPixels<layout_rgba, layout_rgb>(src, row.data(), w);
+    JSAMPROW rowptr = row.data();
+    jpeg_write_scanlines(&ccomp, &rowptr, 1);
+  }
+
+  jpeg_finish_compress(&ccomp);
+  // libjpeg 的输出缓冲与拷贝出的 outputBuffer 同时存在
+  hold.add((size_t)outsize * 2);
+  outputBuffer.assign(outbuf, outbuf + outsize);
+  free(outbuf);
+  jpeg_destroy_compress(&ccomp);
+
+  return (int64_t)outputBuffer.size();
+}
+// 按 SSIM 目标二分查找最低质量：SSIM 随质量单调上升，候选逐个编码、解码后
+// 与待编码像素比较；参考图的亮度平面只计算一次。100 仍不达标时输出 100
+static int64_t encodeTargetSsim(const uint8_t *pixelData, int w, int h,
+                                std::vector<uint8_t> &outputBuffer,
+                                const compress_params &params) {
+  quality_reference ref(pixelData, w, h, params.threads);
+  compress_params p = params;
+  decode_params dp;
+  dp.limits = params.limits;
+  std::vector<uint8_t> candidate, best;
+  int lo = 1, hi = 100;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    p.quality = mid;
+    ImageRGBA decoded;
+    double ssim, psnr;
+    if (writeJpeg(pixelData, w, h, candidate, p) < 0 ||
+        !jpeg_compressor().decodeToRGBA(candidate.data(), candidate.size(),
+                                        decoded, dp) ||
+        !ref.compare(decoded, ssim, psnr))
+      return -1;
+    if (ssim >= params.target_ssim) {
+      hi = mid;
+      best.swap(candidate);
+    } else {
+      lo = mid + 1;
+    }
+  }
+  // best 总是最近一次达标的 hi；从未达标时 hi 为 100 且尚未编码
+  if (best.empty()) {
+    p.quality = hi;
+    return writeJpeg(pixelData, w, h, outputBuffer, p);
+  }
+  outputBuffer.swap(best);
+  return (int64_t)outputBuffer.size();
+}
+int64_t jpeg_compressor::encodeFromRGBA(const ImageRGBA &rgba,
+                                        std::vector<uint8_t> &outputBuffer,
+                                        const compress_params &params) {
+  IMGC_TRACE_SCOPE("encode");
+  if (!validRGBA(rgba))
     return -1;
 
   int w = rgba.width;
@@ -79,116 +541,473 @@ int jpeg_compressor::encodeFromRGBA(const ImageRGBA &rgba,
   std::vector<uint8_t> scaledPixels;
 
   // --------------------
-  // 缩放处理
+  // 裁剪与缩放
   // --------------------
-  if (params.output_width > 0 && params.output_height > 0 &&
-      (params.output_width != w || params.output_height != h)) {
-    int newW = params.output_width;
-    int newH = params.output_height;
-    scaledPixels.resize((size_t)newW * newH * 4);
-
-    if (params.resize_algo == compress_params::ResizeAlgo::NEAREST) {
-      // 最近邻
-      for (int y = 0; y < newH; ++y) {
-        int srcY = y * h / newH;
-        for (int x = 0; x < newW; ++x) {
-          int srcX = x * w / newW;
-          const uint8_t *srcPix = &rgba.pixels[(size_t)(srcY * w + srcX) * 4];
-          uint8_t *dstPix = &scaledPixels[(size_t)(y * newW + x) * 4];
-          dstPix[0] = srcPix[0];
-          dstPix[1] = srcPix[1];
-          dstPix[2] = srcPix[2];
-          dstPix[3] = srcPix[3];
-        }
-      }
-    } else if (params.resize_algo == compress_params::ResizeAlgo::BILINEAR) {
-      // 双线性
-      for (int y = 0; y < newH; ++y) {
-        float srcY = (y + 0.5f) * h / newH - 0.5f;
-        int y0 = std::max(0, (int)floor(srcY));
-        int y1 = std::min(h - 1, y0 + 1);
-        float wy = srcY - y0;
-        for (int x = 0; x < newW; ++x) {
-          float srcX = (x + 0.5f) * w / newW - 0.5f;
-          int x0 = std::max(0, (int)floor(srcX));
-          int x1 = std::min(w - 1, x0 + 1);
-          float wx = srcX - x0;
-
-          const uint8_t *p00 = &rgba.pixels[(size_t)(y0 * w + x0) * 4];
-          const uint8_t *p01 = &rgba.pixels[(size_t)(y0 * w + x1) * 4];
-          const uint8_t *p10 = &rgba.pixels[(size_t)(y1 * w + x0) * 4];
-          const uint8_t *p11 = &rgba.pixels[(size_t)(y1 * w + x1) * 4];
-
-          uint8_t *dstPix = &scaledPixels[(size_t)(y * newW + x) * 4];
-          for (int c = 0; c < 4; ++c) {
-            float top = p00[c] * (1 - wx) + p01[c] * wx;
-            float bottom = p10[c] * (1 - wx) + p11[c] * wx;
-            dstPix[c] = (uint8_t)(top * (1 - wy) + bottom * wy + 0.5f);
-          }
-        }
-      }
-    }
+  memory_reservation hold;
+  pixelData = applyGeometry(params, pixelData, w, h, scaledPixels, &hold);
+  if (!pixelData)
+    return -1;
+  if (params.target_ssim > 0)
+    return encodeTargetSsim(pixelData, w, h, outputBuffer, params);
+  return writeJpeg(pixelData, w, h, outputBuffer, params);
+}
 
-    w = newW;
-    h = newH;
-    pixelData = scaledPixels.data();
+bool jpeg_compressor::decodeToTiled(const uint8_t *inputBuffer,
+                                    size_t inputSize, tiled_image &out,
+                                    const decode_limits &limits) {
+  IMGC_TRACE_SCOPE("decode");
+  if (!inputBuffer || inputSize < 3)
+    return false;
+  jpeg_decompress_struct cinfo;
+  jpeg_jump_error jerr;
+  cinfo.err = jumpErrors(jerr);
+  jpeg_create_decompress(&cinfo);
+  memory_reservation hold;
+  std::vector<uint8_t> row, rgba;
+  if (setjmp(jerr.jump)) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
   }
+  trackJpegMemory((j_common_ptr)&cinfo);
+  jpeg_mem_src(&cinfo, const_cast<unsigned char *>(inputBuffer), inputSize);
+  if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK ||
+      !limits.allowsImage(cinfo.image_width, cinfo.image_height) ||
+      !out.create((int)cinfo.image_width, (int)cinfo.image_height)) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+  cinfo.out_color_space = JCS_RGB;
+  jpeg_start_decompress(&cinfo);
+  // 逐行解码写入分块图像，内存中只有 libjpeg 的行缓冲与常驻块
+  int w = (int)cinfo.output_width;
+  row.resize((size_t)w * 3);
+  rgba.resize((size_t)w * 4);
+  hold.add(row.size() + rgba.size());
+  bool ok = true;
+  while (ok && cinfo.output_scanline < cinfo.output_height) {
+    JSAMPROW rowptr = row.data();
+    jpeg_read_scanlines(&cinfo, &rowptr, 1);
+    convertPixels<layout_rgb, layout_rgba>(row.data(), rgba.data(), w);
+    ok = out.writeRow((int)cinfo.output_scanline - 1, 0, w, rgba.data());
+  }
+  if (ok)
+    jpeg_finish_decompress(&cinfo);
+  else
+    jpeg_abort_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  return ok;
+}
+int64_t jpeg_compressor::encodeFromTiled(tiled_image &img,
+                                         std::vector<uint8_t> &outputBuffer,
+                                         const compress_params &params) {
+  IMGC_TRACE_SCOPE("encode");
+  int w = img.width(), h = img.height();
+  if (w <= 0 || h <= 0)
+    return -1;
+  jpeg_compress_struct ccomp;
+  jpeg_jump_error jerr;
+  ccomp.err = jumpErrors(jerr);
+  jpeg_create_compress(&ccomp);
+  unsigned char *outbuf = nullptr;
+  unsigned long outsize = 0;
+  memory_reservation hold;
+  std::vector<uint8_t> rgba, row;
+  if (setjmp(jerr.jump)) {
+    jpeg_destroy_compress(&ccomp);
+    free(outbuf);
+    return -1;
+  }
+  trackJpegMemory((j_common_ptr)&ccomp);
+  jpeg_mem_dest(&ccomp, &outbuf, &outsize);
+  ccomp.image_width = w;
+  ccomp.image_height = h;
+  ccomp.input_components = 3;
+  ccomp.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&ccomp);
+  applyEncodeOptions(ccomp, params);
+  applySubsampling(ccomp, params);
+  jpeg_start_compress(&ccomp, TRUE);
+  rgba.resize((size_t)w * 4);
+  row.resize((size_t)w * 3);
+  hold.add(rgba.size() + row.size());
+  bool ok = true;
+  while (ok && ccomp.next_scanline < ccomp.image_height) {
+    ok = img.readRow((int)ccomp.next_scanline, 0, w, rgba.data());
+    convertPixels<layout_rgba, layout_rgb>(rgba.data(), row.data(), w);
+    JSAMPROW rowptr = row.data();
+    jpeg_write_scanlines(&ccomp, &rowptr, 1);
+  }
+  if (ok) {
+    jpeg_finish_compress(&ccomp);
+    hold.add((size_t)outsize * 2);
+    outputBuffer.assign(outbuf, outbuf + outsize);
+  } else {
+    jpeg_abort_compress(&ccomp);
+  }
+  free(outbuf);
+  jpeg_destroy_compress(&ccomp);
+  return ok ? (int64_t)outputBuffer.size() : -1;
+}
+// 校验 YUV 视图：平面指针非空，行间距（绝对值）容纳一行样本
+static bool validYuvView(const YuvView &v) {
+  if (v.width <= 0 || v.height <= 0 || !v.planes[0] || !v.planes[1])
+    return false;
+  ptrdiff_t cw = (v.width + 1) / 2;
+  if (std::abs(v.strides[0]) < v.width)
+    return false;
+  if (v.format == YuvFormat::NV12)
+    return std::abs(v.strides[1]) >= cw * 2;
+  return v.planes[2] && std::abs(v.strides[1]) >= cw &&
+         std::abs(v.strides[2]) >= cw;
+}
+int64_t jpeg_compressor::encodeFromYUV(const YuvView &yuv,
+                                       std::vector<uint8_t> &outputBuffer,
+                                       const compress_params &params) {
+  IMGC_TRACE_SCOPE("encode");
+  if (!validYuvView(yuv))
+    return -1;
 
   // --------------------
-  // JPEG 写入
+  // 方向、裁剪与缩放（在 YUV 平面上进行）
+  // --------------------
+  YuvView src = yuv;
+  ImageYUV scaled;
+  crop_rect r;
+  int outW, outH;
+  if (!resolveGeometry(params, yuv.width, yuv.height, r, outW, outH))
+    return -1;
+  orient_ops op = orientOps(geometryOrientation(params));
+  if (op.transpose || op.flipX || op.flipY || r.width != yuv.width ||
+      r.height != yuv.height || outW != yuv.width || outH != yuv.height) {
+    if (!applyGeometryYUV(params, yuv, scaled))
+      return -1;
+    src = scaled.view();
+  }
+  // setjmp 之后仍要使用，声明为 volatile 保证 longjmp 后取值可靠
+  volatile int w = src.width;
+  volatile int h = src.height;
+  int cw = (w + 1) / 2;
+  int ch = (h + 1) / 2;
+  bool nv12 = src.format == YuvFormat::NV12;
+
+  // --------------------
+  // JPEG 写入：raw_data_in 直接送入 4:2:0 的 YCbCr 平面，跳过颜色转换与降采样
   // --------------------
   jpeg_compress_struct ccomp;
-  jpeg_error_mgr jerr2;
-  ccomp.err = jpeg_std_error(&jerr2);
+  jpeg_jump_error jerr2;
+  ccomp.err = jumpErrors(jerr2);
   jpeg_create_compress(&ccomp);
 
   unsigned char *outbuf = nullptr;
   unsigned long outsize = 0;
+  memory_reservation hold;
+  std::vector<uint8_t> ybuf, cbuf;
+  if (setjmp(jerr2.jump)) {
+    jpeg_destroy_compress(&ccomp);
+    free(outbuf);
+    return -1;
+  }
+  trackJpegMemory((j_common_ptr)&ccomp);
   jpeg_mem_dest(&ccomp, &outbuf, &outsize);
 
   ccomp.image_width = w;
   ccomp.image_height = h;
   ccomp.input_components = 3;
-  ccomp.in_color_space = JCS_RGB;
+  ccomp.in_color_space = JCS_YCbCr;
 
   jpeg_set_defaults(&ccomp);
-
-  int q = params.quality;
-  if (q < 1)
-    q = 1;
-  if (q > 100)
-    q = 100;
-  jpeg_set_quality(&ccomp, q, TRUE);
+  applyEncodeOptions(ccomp, params);
+  // 采样因子由输入决定，固定为 4:2:0
+  ccomp.comp_info[0].h_samp_factor = 2;
+  ccomp.comp_info[0].v_samp_factor = 2;
+  ccomp.comp_info[1].h_samp_factor = ccomp.comp_info[1].v_samp_factor = 1;
+  ccomp.comp_info[2].h_samp_factor = ccomp.comp_info[2].v_samp_factor = 1;
+  ccomp.raw_data_in = TRUE;
+#if JPEG_LIB_VERSION >= 70
+  ccomp.do_fancy_downsampling = FALSE;
+#endif
 
   jpeg_start_compress(&ccomp, TRUE);
 
-  std::vector<uint8_t> row((size_t)w * 3);
-  while (ccomp.next_scanline < ccomp.image_height) {
-    const uint8_t *src = &pixelData[(size_t)ccomp.next_scanline * w * 4];
-    for (int x = 0; x < w; ++x) {
-      row[x * 3 + 0] = src[x * 4 + 0];
-      row[x * 3 + 1] = src[x * 4 + 1];
-      row[x * 3 + 2] = src[x * 4 + 2];
+  // 每次写入一个 MCU 行：16 行亮度、8 行色度。raw 模式下 libjpeg 不做边缘
+  // 填充，宽度不是 MCU 整数倍时复制到补齐的行缓冲并重复末列，超出底部的行
+  // 重复末行；宽度对齐的平面直接引用源行
+  int padW = (w + 15) & ~15;
+  int padCW = padW / 2;
+  bool directY = padW == w;
+  bool directC = !nv12 && padCW == cw;
+  ybuf.resize(directY ? 0 : (size_t)padW * 16);
+  cbuf.resize(directC ? 0 : (size_t)padCW * 16);
+  hold.add(ybuf.size() + cbuf.size());
+  JSAMPROW yRows[16], uRows[8], vRows[8];
+  JSAMPARRAY planes[3] = {yRows, uRows, vRows};
+  for (int y0 = 0; y0 < h; y0 += 16) {
+    for (int i = 0; i < 16; ++i) {
+      const uint8_t *s =
+          src.planes[0] + (ptrdiff_t)std::min(y0 + i, h - 1) * src.strides[0];
+      if (directY) {
+        yRows[i] = const_cast<JSAMPROW>(s);
+        continue;
+      }
+      uint8_t *d = &ybuf[(size_t)i * padW];
+      std::memcpy(d, s, w);
+      std::memset(d + w, s[w - 1], padW - w);
+      yRows[i] = d;
     }
-    JSAMPROW rowptr = row.data();
-    jpeg_write_scanlines(&ccomp, &rowptr, 1);
+    for (int i = 0; i < 8; ++i) {
+      ptrdiff_t sy = std::min(y0 / 2 + i, ch - 1);
+      const uint8_t *su = src.planes[1] + sy * src.strides[1];
+      if (directC) {
+        uRows[i] = const_cast<JSAMPROW>(su);
+        vRows[i] = const_cast<JSAMPROW>(src.planes[2] + sy * src.strides[2]);
+        continue;
+      }
+      uint8_t *du = &cbuf[(size_t)i * padCW];
+      uint8_t *dv = &cbuf[(size_t)(8 + i) * padCW];
+      if (nv12) {
+        for (int x = 0; x < cw; ++x) {
+          du[x] = su[x * 2];
+          dv[x] = su[x * 2 + 1];
+        }
+      } else {
+        std::memcpy(du, su, cw);
+        std::memcpy(dv, src.planes[2] + sy * src.strides[2], cw);
+      }
+      std::memset(du + cw, du[cw - 1], padCW - cw);
+      std::memset(dv + cw, dv[cw - 1], padCW - cw);
+      uRows[i] = du;
+      vRows[i] = dv;
+    }
+    jpeg_write_raw_data(&ccomp, planes, 16);
   }
 
   jpeg_finish_compress(&ccomp);
+  // libjpeg 的输出缓冲与拷贝出的 outputBuffer 同时存在
+  hold.add((size_t)outsize * 2);
   outputBuffer.assign(outbuf, outbuf + outsize);
   free(outbuf);
   jpeg_destroy_compress(&ccomp);
 
-  return (int)outputBuffer.size();
+  return (int64_t)outputBuffer.size();
 }
 
-int jpeg_compressor::compressMemory(const uint8_t *inputBuffer,
-                                    size_t inputSize,
-                                    std::vector<uint8_t> &outputBuffer,
-                                    const compress_params &params) {
-  ImageRGBA rgba;
-  if (!decodeToRGBA(inputBuffer, inputSize, rgba))
+// 在 DCT 系数域按 EXIF 方向无损变换（同 jpegtran），不解码像素：
+// 转置交换块位置与块内系数 (u,v)，量化表随之转置；翻转倒序块位置并对
+// 奇数频率系数取反。被翻转的边长须为目标 iMCU 的整数倍，否则按
+// jpeg_lossless_trim 裁掉不完整的 iMCU，或返回 0 由调用方改走像素路径
+static int64_t transformCoefficients(const uint8_t *inputBuffer,
+                                     size_t inputSize, int orientation,
+                                     std::vector<uint8_t> &outputBuffer,
+                                     const compress_params &params) {
+  // 源与目标对象共用一个错误管理器，出错时一并销毁
+  jpeg_decompress_struct src;
+  jpeg_compress_struct dst;
+  jpeg_jump_error jerr;
+  src.err = dst.err = jumpErrors(jerr);
+  jpeg_create_decompress(&src);
+  jpeg_create_compress(&dst);
+  unsigned char *outbuf = nullptr;
+  unsigned long outsize = 0;
+  memory_reservation hold;
+  std::vector<jvirt_barray_ptr> dstArrays;
+  std::vector<JDIMENSION> blocksW, blocksH;
+  if (setjmp(jerr.jump)) {
+    jpeg_destroy_compress(&dst);
+    jpeg_destroy_decompress(&src);
+    free(outbuf);
+    return -1;
+  }
+  trackJpegMemory((j_common_ptr)&src);
+  trackJpegMemory((j_common_ptr)&dst);
+  jpeg_mem_src(&src, const_cast<unsigned char *>(inputBuffer), inputSize);
+  if (jpeg_read_header(&src, TRUE) != JPEG_HEADER_OK) {
+    jpeg_destroy_compress(&dst);
+    jpeg_destroy_decompress(&src);
     return -1;
-  return encodeFromRGBA(rgba, outputBuffer, params);
+  }
+  if (!params.limits.allowsImage(src.image_width, src.image_height)) {
+    jpeg_destroy_compress(&dst);
+    jpeg_destroy_decompress(&src);
+    return kErrLimitExceeded;
+  }
+  orient_ops op = orientOps(orientation);
+  // 目标图像的 iMCU 尺寸与宽高（转置时采样因子横纵互换）
+  unsigned int mcuW = (op.transpose ? src.max_v_samp_factor
+                                    : src.max_h_samp_factor) * DCTSIZE;
+  unsigned int mcuH = (op.transpose ? src.max_h_samp_factor
+                                    : src.max_v_samp_factor) * DCTSIZE;
+  JDIMENSION dstW = op.transpose ? src.image_height : src.image_width;
+  JDIMENSION dstH = op.transpose ? src.image_width : src.image_height;
+  bool trimW = op.flipX && dstW % mcuW != 0;
+  bool trimH = op.flipY && dstH % mcuH != 0;
+  if ((trimW || trimH) &&
+      (!params.jpeg_lossless_trim || dstW < mcuW || dstH < mcuH)) {
+    jpeg_destroy_compress(&dst);
+    jpeg_destroy_decompress(&src);
+    return 0;
+  }
+  if (trimW)
+    dstW -= dstW % mcuW;
+  if (trimH)
+    dstH -= dstH % mcuH;
+
+  // 目标系数数组须在 jpeg_read_coefficients 之前向源对象申请，随源数组一起分配
+  int nc = src.num_components;
+  dstArrays.resize(nc);
+  blocksW.resize(nc);
+  blocksH.resize(nc);
+  for (int ci = 0; ci < nc; ++ci) {
+    const jpeg_component_info &c = src.comp_info[ci];
+    int hs = op.transpose ? c.v_samp_factor : c.h_samp_factor;
+    int vs = op.transpose ? c.h_samp_factor : c.v_samp_factor;
+    blocksW[ci] = (dstW * hs + mcuW - 1) / mcuW;
+    blocksH[ci] = (dstH * vs + mcuH - 1) / mcuH;
+    dstArrays[ci] = (*src.mem->request_virt_barray)(
+        (j_common_ptr)&src, JPOOL_IMAGE, TRUE,
+        (blocksW[ci] + hs - 1) / hs * hs, (blocksH[ci] + vs - 1) / vs * vs, vs);
+  }
+  jvirt_barray_ptr *srcArrays = jpeg_read_coefficients(&src);
+  for (int ci = 0; ci < nc; ++ci) {
+    for (JDIMENSION by = 0; by < blocksH[ci]; ++by) {
+      JBLOCKROW drow = (*src.mem->access_virt_barray)(
+          (j_common_ptr)&src, dstArrays[ci], by, 1, TRUE)[0];
+      // 转置后坐标系中的块行；不转置时整行来自同一源块行
+      JDIMENSION ty = op.flipY ? blocksH[ci] - 1 - by : by;
+      JBLOCKROW srow = nullptr;
+      if (!op.transpose)
+        srow = (*src.mem->access_virt_barray)((j_common_ptr)&src,
+                                              srcArrays[ci], ty, 1, FALSE)[0];
+      for (JDIMENSION bx = 0; bx < blocksW[ci]; ++bx) {
+        JDIMENSION tx = op.flipX ? blocksW[ci] - 1 - bx : bx;
+        JCOEFPTR sb;
+        if (op.transpose)
+          sb = (*src.mem->access_virt_barray)((j_common_ptr)&src, srcArrays[ci],
+                                              tx, 1, FALSE)[0][ty];
+        else
+          sb = srow[tx];
+        JCOEFPTR db = drow[bx];
+        for (int v = 0; v < DCTSIZE; ++v) {
+          for (int u = 0; u < DCTSIZE; ++u) {
+            JCOEF c = op.transpose ? sb[u * DCTSIZE + v] : sb[v * DCTSIZE + u];
+            if ((op.flipX && (u & 1)) != (op.flipY && (v & 1)))
+              c = (JCOEF)-c;
+            db[v * DCTSIZE + u] = c;
+          }
+        }
+      }
+    }
+  }
+
+  jpeg_mem_dest(&dst, &outbuf, &outsize);
+  jpeg_copy_critical_parameters(&src, &dst);
+  dst.image_width = dstW;
+  dst.image_height = dstH;
+  if (op.transpose) {
+    for (int ci = 0; ci < nc; ++ci)
+      std::swap(dst.comp_info[ci].h_samp_factor,
+                dst.comp_info[ci].v_samp_factor);
+    for (int i = 0; i < NUM_QUANT_TBLS; ++i) {
+      JQUANT_TBL *q = dst.quant_tbl_ptrs[i];
+      if (!q)
+        continue;
+      for (int v = 0; v < DCTSIZE; ++v)
+        for (int u = v + 1; u < DCTSIZE; ++u)
+          std::swap(q->quantval[v * DCTSIZE + u], q->quantval[u * DCTSIZE + v]);
+    }
+  }
+  dst.optimize_coding = params.jpeg_optimize_coding ? TRUE : FALSE;
+  if (params.jpeg_restart_rows > 0)
+    dst.restart_in_rows = params.jpeg_restart_rows;
+  if (params.jpeg_progressive)
+    jpeg_simple_progression(&dst);
+  jpeg_write_coefficients(&dst, dstArrays.data());
+  jpeg_finish_compress(&dst);
+  hold.add((size_t)outsize * 2);
+  outputBuffer.assign(outbuf, outbuf + outsize);
+  free(outbuf);
+  jpeg_destroy_compress(&dst);
+  jpeg_finish_decompress(&src);
+  jpeg_destroy_decompress(&src);
+  return (int64_t)outputBuffer.size();
+}
+// 需要缩放的 YCbCr/灰度输入：解出原生平面，在 Y 与 4:2:0 色度平面上
+// 分别完成方向变换与缩放，再以 raw 数据编码，省去 YCbCr 与 RGB 之间的两次
+// 颜色转换和四通道重采样。不适用（含未通过限制检查，由像素路径报告）或
+// 输入不是 YCbCr 时返回 0，由调用方改走像素路径
+static int64_t resizePlanes(jpeg_compressor &codec, const uint8_t *inputBuffer,
+                            size_t inputSize,
+                            std::vector<uint8_t> &outputBuffer,
+                            const compress_params &params) {
+  // 显式裁剪时像素路径只解码区域；SSIM 目标与非 4:2:0 输出需经 RGBA 编码；
+  // 快速模式由像素路径在 DCT 域缩小解码
+  if ((params.crop_width > 0 && params.crop_height > 0) ||
+      params.target_ssim > 0 ||
+      params.jpeg_subsampling != compress_params::JpegSubsampling::S420 ||
+      params.decode_speed == DecodeSpeed::FAST)
+    return 0;
+  compress_params p = params;
+  if (p.auto_orient)
+    p.orientation = readExifOrientation(inputBuffer, inputSize);
+  p.orientation = geometryOrientation(p);
+  p.rotation = compress_params::Rotation::NONE;
+  p.flip_horizontal = p.flip_vertical = false;
+  p.auto_orient = false;
+  int w, h, outW, outH;
+  crop_rect r;
+  if (!codec.readImageSize(inputBuffer, inputSize, w, h) ||
+      !params.limits.allowsImage(w, h) ||
+      !resolveGeometry(p, w, h, r, outW, outH) ||
+      (outW == r.width && outH == r.height) ||
+      !params.limits.allowsImage(outW, outH) ||
+      !params.limits.allowsDecoded((unsigned long long)w * h * 3))
+    return 0;
+  ImageYUV yuv;
+  if (!codec.decodeToYUV(inputBuffer, inputSize, yuv, YuvFormat::I420,
+                         params.limits))
+    return 0;
+  memory_reservation hold;
+  hold.add(yuv.planes[0].capacity() + yuv.planes[1].capacity() +
+           yuv.planes[2].capacity());
+  return codec.encodeFromYUV(yuv.view(), outputBuffer, p);
+}
+int64_t jpeg_compressor::compressMemory(const uint8_t *inputBuffer,
+                                        size_t inputSize,
+                                        std::vector<uint8_t> &outputBuffer,
+                                        const compress_params &params) {
+  // 只做方向变换时走系数域，保持原有压缩质量
+  if (params.auto_orient && inputBuffer && inputSize > 0 &&
+      !(params.crop_width > 0 && params.crop_height > 0)) {
+    compress_params op = params;
+    op.orientation = readExifOrientation(inputBuffer, inputSize);
+    int orientation = geometryOrientation(op);
+    int w, h;
+    if (orientation != 1 && readImageSize(inputBuffer, inputSize, w, h)) {
+      if (orientOps(orientation).transpose)
+        std::swap(w, h);
+      bool resize = params.output_width > 0 && params.output_height > 0 &&
+                    (params.output_width != w || params.output_height != h);
+      if (!resize) {
+        int64_t r = transformCoefficients(inputBuffer, inputSize,
+                                          orientation, outputBuffer, params);
+        if (r != 0)
+          return r;
+      }
+    }
+  }
+  // 缩放在 YCbCr 平面上进行，不经过 RGBA
+  int64_t planar =
+      resizePlanes(*this, inputBuffer, inputSize, outputBuffer, params);
+  if (planar != 0)
+    return planar;
+  ImageRGBA rgba;
+  compress_params encodeParams;
+  int r = decodeForParams(*this, inputBuffer, inputSize, params, rgba,
+                          encodeParams);
+  if (r < 0)
+    return r;
+  // 解码结果在编码期间一直占用
+  memory_reservation hold;
+  hold.add(rgba.pixels.capacity());
+  return encodeFromRGBA(rgba, outputBuffer, encodeParams);
 }
 } // namespace imgc
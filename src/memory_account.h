@@ -0,0 +1,77 @@
+﻿#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "image_compress/memory_tracker.h"
+#include <cstddef>
+#include <cstdint>
+struct jpeg_common_struct;
+struct png_struct_def;
+namespace imgc {
+// 库内部的内存计量接口，公开部分见 memory_tracker.h
+struct memory_scope_state;
+// 当前线程所在的作用域，没有时为 nullptr
+memory_scope_state *currentMemoryScope();
+// 在工作线程上临时安装发起任务的线程的作用域（线程池任务、编码线程）
+class memory_scope_binding {
+public:
+  explicit memory_scope_binding(memory_scope_state *s);
+  ~memory_scope_binding();
+
+private:
+  memory_scope_binding(const memory_scope_binding &) = delete;
+  memory_scope_binding &operator=(const memory_scope_binding &) = delete;
+  memory_scope_state *prev_;
+};
+// 计入作用域 s（及其外层）与进程计量。vetoable 且任一层预算回调拒绝时
+// 返回 false，不计入；s 为 nullptr 时只计入进程计量
+bool memoryCharge(memory_scope_state *s, size_t bytes, bool vetoable);
+void memoryRelease(memory_scope_state *s, size_t bytes);
+// 延迟释放的分配（libjpeg 内存池、libpng 内存块）持有所属作用域直到释放
+void memoryScopeRetain(memory_scope_state *s);
+void memoryScopeUnref(memory_scope_state *s);
+// 当前作用域累计的拒绝次数，调用前后比较即可把失败归因于预算
+uint64_t memoryVetoCount();
+// 函数内缓冲的计量：reserve 先询问预算再计入，add 直接计入已分配的缓冲；
+// 析构时全部释放。计入构造时所在线程的作用域
+class memory_reservation {
+public:
+  memory_reservation();
+  ~memory_reservation();
+  bool reserve(size_t bytes);
+  void add(size_t bytes);
+
+private:
+  memory_reservation(const memory_reservation &) = delete;
+  memory_reservation &operator=(const memory_reservation &) = delete;
+  memory_scope_state *scope_;
+  size_t bytes_ = 0;
+};
+// 接管 libjpeg 对象的内存池分配函数以计量（jpeg_create_* 之后调用）。
+// 预算拒绝时经 error_exit 报 JERR_OUT_OF_MEMORY，错误管理器须能返回调用处
+void trackJpegMemory(jpeg_common_struct *cinfo);
+// libpng 的分配函数，传给 png_create_*_struct_2；预算拒绝时返回 nullptr，
+// libpng 随即报错并 longjmp
+void *pngTrackedMalloc(png_struct_def *png, size_t size);
+void pngTrackedFree(png_struct_def *png, void *ptr);
+} // namespace imgc
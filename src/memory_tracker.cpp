@@ -0,0 +1,296 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "image_compress/memory_tracker.h"
+#include "memory_account.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <jpeglib.h>
+#include <jerror.h>
+namespace imgc {
+// 作用域状态：引用计数，由 memory_scope、外层作用域的子作用域与延迟释放的
+// 分配共同持有；计数器可被线程池线程并发更新
+struct memory_scope_state {
+  std::atomic<int> refs{1};
+  memory_scope_state *parent = nullptr;
+  memory_budget_fn budget;
+  std::atomic<uint64_t> current{0};
+  std::atomic<uint64_t> peak{0};
+  std::atomic<uint64_t> allocations{0};
+  std::atomic<uint64_t> vetoed{0};
+};
+namespace {
+// 进程计量，等同于一个没有预算的根作用域
+memory_scope_state &processState() {
+  static memory_scope_state *s = new memory_scope_state();
+  return *s;
+}
+thread_local memory_scope_state *tlsScope = nullptr;
+void raisePeak(std::atomic<uint64_t> &peak, uint64_t v) {
+  uint64_t p = peak.load(std::memory_order_relaxed);
+  while (v > p &&
+         !peak.compare_exchange_weak(p, v, std::memory_order_relaxed))
+    ;
+}
+void chargeOne(memory_scope_state &s, size_t bytes) {
+  uint64_t v = s.current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  raisePeak(s.peak, v);
+  s.allocations.fetch_add(1, std::memory_order_relaxed);
+}
+memory_stats snapshot(const memory_scope_state &s) {
+  memory_stats st;
+  st.current_bytes = s.current.load(std::memory_order_relaxed);
+  st.peak_bytes = s.peak.load(std::memory_order_relaxed);
+  st.allocations = s.allocations.load(std::memory_order_relaxed);
+  st.vetoed = s.vetoed.load(std::memory_order_relaxed);
+  return st;
+}
+} // namespace
+
+memory_scope_state *currentMemoryScope() { return tlsScope; }
+memory_scope_binding::memory_scope_binding(memory_scope_state *s)
+    : prev_(tlsScope) {
+  tlsScope = s;
+}
+memory_scope_binding::~memory_scope_binding() { tlsScope = prev_; }
+bool memoryCharge(memory_scope_state *s, size_t bytes, bool vetoable) {
+  if (vetoable && bytes >= kMemoryBudgetMinBytes) {
+    for (memory_scope_state *p = s; p; p = p->parent) {
+      if (p->budget &&
+          !p->budget(bytes, p->current.load(std::memory_order_relaxed))) {
+        // 拒绝计入当前作用域及其全部外层，便于各层把失败归因于预算
+        for (memory_scope_state *q = s; q; q = q->parent)
+          q->vetoed.fetch_add(1, std::memory_order_relaxed);
+        processState().vetoed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+    }
+  }
+  for (memory_scope_state *p = s; p; p = p->parent)
+    chargeOne(*p, bytes);
+  chargeOne(processState(), bytes);
+  return true;
+}
+void memoryRelease(memory_scope_state *s, size_t bytes) {
+  for (memory_scope_state *p = s; p; p = p->parent)
+    p->current.fetch_sub(bytes, std::memory_order_relaxed);
+  processState().current.fetch_sub(bytes, std::memory_order_relaxed);
+}
+void memoryScopeRetain(memory_scope_state *s) {
+  if (s)
+    s->refs.fetch_add(1, std::memory_order_relaxed);
+}
+void memoryScopeUnref(memory_scope_state *s) {
+  if (s && s->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    memoryScopeUnref(s->parent);
+    delete s;
+  }
+}
+uint64_t memoryVetoCount() {
+  return tlsScope ? tlsScope->vetoed.load(std::memory_order_relaxed) : 0;
+}
+
+memory_reservation::memory_reservation() : scope_(tlsScope) {
+  memoryScopeRetain(scope_);
+}
+memory_reservation::~memory_reservation() {
+  if (bytes_)
+    memoryRelease(scope_, bytes_);
+  memoryScopeUnref(scope_);
+}
+bool memory_reservation::reserve(size_t bytes) {
+  if (!memoryCharge(scope_, bytes, true))
+    return false;
+  bytes_ += bytes;
+  return true;
+}
+void memory_reservation::add(size_t bytes) {
+  memoryCharge(scope_, bytes, false);
+  bytes_ += bytes;
+}
+
+struct memory_scope::impl {
+  memory_scope_state *state;
+  memory_scope_state *prev;
+};
+memory_scope::memory_scope(memory_budget_fn budget) : impl_(new impl) {
+  impl_->state = new memory_scope_state();
+  impl_->state->budget = budget;
+  impl_->state->parent = tlsScope;
+  memoryScopeRetain(tlsScope);
+  impl_->prev = tlsScope;
+  tlsScope = impl_->state;
+}
+memory_scope::~memory_scope() {
+  tlsScope = impl_->prev;
+  memoryScopeUnref(impl_->state);
+  delete impl_;
+}
+memory_stats memory_scope::stats() const { return snapshot(*impl_->state); }
+memory_stats processMemoryStats() { return snapshot(processState()); }
+
+// --------------------
+// libjpeg：替换内存管理器的方法表。libjpeg 的内部模块经方法表申请内存，
+// 各池的字节数在释放池或销毁对象时归还；虚拟数组在申请时按完整大小计入
+// （未设置 max_memory_to_use 时全部驻留内存）
+// --------------------
+namespace {
+struct jpeg_mem_hooks {
+  memory_scope_state *scope;
+  size_t pool[JPOOL_NUMPOOLS];
+  void *(*allocSmall)(j_common_ptr, int, size_t);
+  void *(*allocLarge)(j_common_ptr, int, size_t);
+  JSAMPARRAY (*allocSarray)(j_common_ptr, int, JDIMENSION, JDIMENSION);
+  JBLOCKARRAY (*allocBarray)(j_common_ptr, int, JDIMENSION, JDIMENSION);
+  jvirt_sarray_ptr (*requestSarray)(j_common_ptr, int, boolean, JDIMENSION,
+                                    JDIMENSION, JDIMENSION);
+  jvirt_barray_ptr (*requestBarray)(j_common_ptr, int, boolean, JDIMENSION,
+                                    JDIMENSION, JDIMENSION);
+  void (*freePool)(j_common_ptr, int);
+  void (*selfDestruct)(j_common_ptr);
+};
+jpeg_mem_hooks &hooksOf(j_common_ptr c) {
+  return *(jpeg_mem_hooks *)c->client_data;
+}
+void chargeJpeg(j_common_ptr c, int poolId, size_t bytes) {
+  jpeg_mem_hooks &h = hooksOf(c);
+  if (!memoryCharge(h.scope, bytes, true))
+    ERREXIT1(c, JERR_OUT_OF_MEMORY, poolId);
+  if (poolId >= 0 && poolId < JPOOL_NUMPOOLS)
+    h.pool[poolId] += bytes;
+}
+void *jpegAllocSmall(j_common_ptr c, int poolId, size_t size) {
+  chargeJpeg(c, poolId, size);
+  return hooksOf(c).allocSmall(c, poolId, size);
+}
+void *jpegAllocLarge(j_common_ptr c, int poolId, size_t size) {
+  chargeJpeg(c, poolId, size);
+  return hooksOf(c).allocLarge(c, poolId, size);
+}
+JSAMPARRAY jpegAllocSarray(j_common_ptr c, int poolId, JDIMENSION width,
+                           JDIMENSION rows) {
+  chargeJpeg(c, poolId, (size_t)rows * (width * sizeof(JSAMPLE) +
+                                        sizeof(JSAMPROW)));
+  return hooksOf(c).allocSarray(c, poolId, width, rows);
+}
+JBLOCKARRAY jpegAllocBarray(j_common_ptr c, int poolId, JDIMENSION width,
+                            JDIMENSION rows) {
+  chargeJpeg(c, poolId, (size_t)rows * (width * sizeof(JBLOCK) +
+                                        sizeof(JBLOCKROW)));
+  return hooksOf(c).allocBarray(c, poolId, width, rows);
+}
+jvirt_sarray_ptr jpegRequestSarray(j_common_ptr c, int poolId, boolean zero,
+                                   JDIMENSION width, JDIMENSION rows,
+                                   JDIMENSION access) {
+  chargeJpeg(c, poolId, (size_t)rows * (width * sizeof(JSAMPLE) +
+                                        sizeof(JSAMPROW)));
+  return hooksOf(c).requestSarray(c, poolId, zero, width, rows, access);
+}
+jvirt_barray_ptr jpegRequestBarray(j_common_ptr c, int poolId, boolean zero,
+                                   JDIMENSION width, JDIMENSION rows,
+                                   JDIMENSION access) {
+  chargeJpeg(c, poolId, (size_t)rows * (width * sizeof(JBLOCK) +
+                                        sizeof(JBLOCKROW)));
+  return hooksOf(c).requestBarray(c, poolId, zero, width, rows, access);
+}
+void jpegFreePool(j_common_ptr c, int poolId) {
+  jpeg_mem_hooks &h = hooksOf(c);
+  h.freePool(c, poolId);
+  if (poolId >= 0 && poolId < JPOOL_NUMPOOLS) {
+    memoryRelease(h.scope, h.pool[poolId]);
+    h.pool[poolId] = 0;
+  }
+}
+void jpegSelfDestruct(j_common_ptr c) {
+  // hooks 位于永久池中，销毁前取出
+  jpeg_mem_hooks &h = hooksOf(c);
+  memory_scope_state *scope = h.scope;
+  size_t bytes = 0;
+  for (int i = 0; i < JPOOL_NUMPOOLS; ++i)
+    bytes += h.pool[i];
+  void (*selfDestruct)(j_common_ptr) = h.selfDestruct;
+  c->client_data = nullptr;
+  selfDestruct(c);
+  memoryRelease(scope, bytes);
+  memoryScopeUnref(scope);
+}
+// libpng 内存块前的头部：块大小与所属作用域，按 16 字节对齐
+struct png_block_header {
+  size_t size;
+  memory_scope_state *scope;
+};
+const size_t kPngHeaderBytes = (sizeof(png_block_header) + 15) & ~size_t(15);
+} // namespace
+
+void trackJpegMemory(jpeg_common_struct *cinfo) {
+  jpeg_memory_mgr *m = cinfo->mem;
+  jpeg_mem_hooks *h = (jpeg_mem_hooks *)m->alloc_small(
+      cinfo, JPOOL_PERMANENT, sizeof(jpeg_mem_hooks));
+  h->scope = tlsScope;
+  memoryScopeRetain(h->scope);
+  for (int i = 0; i < JPOOL_NUMPOOLS; ++i)
+    h->pool[i] = 0;
+  h->allocSmall = m->alloc_small;
+  h->allocLarge = m->alloc_large;
+  h->allocSarray = m->alloc_sarray;
+  h->allocBarray = m->alloc_barray;
+  h->requestSarray = m->request_virt_sarray;
+  h->requestBarray = m->request_virt_barray;
+  h->freePool = m->free_pool;
+  h->selfDestruct = m->self_destruct;
+  cinfo->client_data = h;
+  m->alloc_small = jpegAllocSmall;
+  m->alloc_large = jpegAllocLarge;
+  m->alloc_sarray = jpegAllocSarray;
+  m->alloc_barray = jpegAllocBarray;
+  m->request_virt_sarray = jpegRequestSarray;
+  m->request_virt_barray = jpegRequestBarray;
+  m->free_pool = jpegFreePool;
+  m->self_destruct = jpegSelfDestruct;
+}
+void *pngTrackedMalloc(png_struct_def *, size_t size) {
+  memory_scope_state *s = tlsScope;
+  if (!memoryCharge(s, size, true))
+    return nullptr;
+  uint8_t *p = (uint8_t *)std::malloc(size + kPngHeaderBytes);
+  if (!p) {
+    memoryRelease(s, size);
+    return nullptr;
+  }
+  png_block_header *hd = (png_block_header *)p;
+  hd->size = size;
+  hd->scope = s;
+  memoryScopeRetain(s);
+  return p + kPngHeaderBytes;
+}
+void pngTrackedFree(png_struct_def *, void *ptr) {
+  if (!ptr)
+    return;
+  uint8_t *p = (uint8_t *)ptr - kPngHeaderBytes;
+  png_block_header *hd = (png_block_header *)p;
+  memoryRelease(hd->scope, hd->size);
+  memoryScopeUnref(hd->scope);
+  std::free(p);
+}
+} // namespace imgc
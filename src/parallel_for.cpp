@@ -0,0 +1,200 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "parallel_for.h"
+#include "image_compress/trace.h"
+#include "memory_account.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+namespace imgc {
+namespace {
+// 一次 parallelFor 调用：每个参与者一个分段，分段为块下标区间
+// [lo, hi)，打包在一个 64 位原子量中，所有者从头部取、窃取者从尾部取
+struct parallel_job {
+  const std::function<void(size_t, size_t)> *fn = nullptr;
+  size_t count = 0;
+  size_t chunk = 0;
+  int slots = 0;
+  std::unique_ptr<std::atomic<uint64_t>[]> ranges;
+  std::atomic<int> nextSlot{1}; // 0 号分段属于调用线程
+  int helpersWanted = 0;        // 受线程池互斥锁保护
+  int active = 0;               // 正在参与的工作线程数，同上
+  // 调用线程的内存计量作用域，工作线程执行期间沿用
+  memory_scope_state *memoryScope = nullptr;
+  // 调用线程的追踪任务编号
+  uint64_t traceJob = 0;
+};
+inline uint64_t packRange(uint32_t lo, uint32_t hi) {
+  return (uint64_t(lo) << 32) | hi;
+}
+// 从分段头部（front）或尾部取一个块，分段为空时返回 false
+bool takeChunk(std::atomic<uint64_t> &range, bool front, uint32_t &idx) {
+  uint64_t v = range.load(std::memory_order_relaxed);
+  for (;;) {
+    uint32_t lo = (uint32_t)(v >> 32), hi = (uint32_t)v;
+    if (lo >= hi)
+      return false;
+    uint64_t nv = front ? packRange(lo + 1, hi) : packRange(lo, hi - 1);
+    if (range.compare_exchange_weak(v, nv, std::memory_order_acq_rel,
+                                    std::memory_order_relaxed)) {
+      idx = front ? lo : hi - 1;
+      return true;
+    }
+  }
+}
+void runChunk(parallel_job &job, uint32_t idx) {
+  size_t b = (size_t)idx * job.chunk;
+  size_t e = std::min(job.count, b + job.chunk);
+  (*job.fn)(b, e);
+}
+// 先做完自己的分段，再依次从其他分段尾部窃取，直到所有分段为空
+void work(parallel_job &job, int slot) {
+  uint32_t idx;
+  while (takeChunk(job.ranges[slot], true, idx))
+    runChunk(job, idx);
+  for (int k = 1; k < job.slots; ++k) {
+    std::atomic<uint64_t> &victim = job.ranges[(slot + k) % job.slots];
+    while (takeChunk(victim, false, idx))
+      runChunk(job, idx);
+  }
+}
+// 常驻线程池：工作线程从队列领取任务参与执行；调用线程自己也执行任务，
+// 线程池繁忙时即由调用线程完成全部块，嵌套调用不会死锁
+class thread_pool {
+public:
+  explicit thread_pool(int n) {
+    for (int i = 0; i < n; ++i)
+      threads_.emplace_back([this]() { loop(); });
+  }
+  int size() const { return (int)threads_.size(); }
+  void run(parallel_job &job, int helpers) {
+    {
+      std::lock_guard<std::mutex> lk(m_);
+      job.helpersWanted = helpers;
+      queue_.push_back(&job);
+    }
+    if (helpers == 1)
+      cv_.notify_one();
+    else
+      cv_.notify_all();
+    work(job, 0);
+    // 撤下尚未被领取的名额，等待已参与的工作线程结束
+    std::unique_lock<std::mutex> lk(m_);
+    auto it = std::find(queue_.begin(), queue_.end(), &job);
+    if (it != queue_.end())
+      queue_.erase(it);
+    done_.wait(lk, [&job]() { return job.active == 0; });
+  }
+
+private:
+  void loop() {
+    for (;;) {
+      parallel_job *job;
+      {
+        std::unique_lock<std::mutex> lk(m_);
+        cv_.wait(lk, [this]() { return !queue_.empty(); });
+        job = queue_.front();
+        ++job->active;
+        if (--job->helpersWanted == 0)
+          queue_.pop_front();
+      }
+      int slot = job->nextSlot.fetch_add(1);
+      {
+        memory_scope_binding bind(job->memoryScope);
+        trace_job traceBind(job->traceJob);
+        work(*job, slot < job->slots ? slot : 0);
+      }
+      std::lock_guard<std::mutex> lk(m_);
+      if (--job->active == 0)
+        done_.notify_all();
+    }
+  }
+  std::mutex m_;
+  std::condition_variable cv_;
+  std::condition_variable done_;
+  std::deque<parallel_job *> queue_;
+  std::vector<std::thread> threads_;
+};
+// 线程池规模：硬件线程数，可用环境变量 IMGC_THREADS 覆盖
+int hardwareThreads() {
+  static const int n = []() {
+    const char *env = std::getenv("IMGC_THREADS");
+    int v = env ? std::atoi(env) : 0;
+    if (v <= 0)
+      v = (int)std::thread::hardware_concurrency();
+    return std::min(std::max(v, 1), 256);
+  }();
+  return n;
+}
+// 首次使用时创建，进程结束前不销毁（工作线程阻塞在条件变量上）
+thread_pool &pool() {
+  static thread_pool *p = new thread_pool(hardwareThreads() - 1);
+  return *p;
+}
+} // namespace
+int parallelThreads(int threads) {
+  int hw = hardwareThreads();
+  return threads <= 0 ? hw : std::min(threads, hw);
+}
+void parallelFor(size_t count, size_t grain, int threads,
+                 const std::function<void(size_t, size_t)> &fn) {
+  if (count == 0)
+    return;
+  grain = std::max<size_t>(grain, 1);
+  size_t maxChunks = count / grain;
+  int n = (int)std::min<size_t>(parallelThreads(threads), maxChunks);
+  if (n <= 1) {
+    fn(0, count);
+    return;
+  }
+  // 每个参与者约 4 块，留出窃取的余地
+  size_t chunks = std::min<size_t>(maxChunks, (size_t)n * 4);
+  chunks = std::min<size_t>(chunks, 0xFFFFFFFFu);
+  parallel_job job;
+  job.fn = &fn;
+  job.count = count;
+  job.chunk = (count + chunks - 1) / chunks;
+  chunks = (count + job.chunk - 1) / job.chunk;
+  job.slots = n;
+  job.memoryScope = currentMemoryScope();
+  job.traceJob = traceCurrentJob();
+  job.ranges.reset(new std::atomic<uint64_t>[n]);
+  for (int s = 0; s < n; ++s)
+    job.ranges[s].store(packRange((uint32_t)(chunks * s / n),
+                                  (uint32_t)(chunks * (s + 1) / n)));
+  int helpers = std::min(n - 1, pool().size());
+  if (helpers <= 0) {
+    fn(0, count);
+    return;
+  }
+  pool().run(job, helpers);
+}
+} // namespace imgc
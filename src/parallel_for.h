@@ -0,0 +1,45 @@
+﻿#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include <cstddef>
+#include <functional>
+namespace imgc {
+// 单个并行任务块的最小工作量（字节）：小于两块的工作直接在调用线程执行，
+// 避免线程交接的开销超过计算本身
+const size_t kParallelMinBytes = 256 * 1024;
+// 每块至少包含的项数，使每块约 kParallelMinBytes 字节的工作量
+inline size_t parallelGrain(size_t bytesPerItem) {
+  return bytesPerItem >= kParallelMinBytes
+             ? 1
+             : kParallelMinBytes / (bytesPerItem ? bytesPerItem : 1);
+}
+// 实际参与的线程数：threads <= 0 表示使用全部硬件线程
+int parallelThreads(int threads);
+// 将 [0, count) 拆成至少 grain 项的块，由调用线程与共享线程池中至多
+// threads-1 个工作线程并行执行 fn(begin, end)。块按线程预先分段，做完自己
+// 的分段后从其他线程分段的末尾窃取；返回时所有块均已完成。
+// 不足两块或 threads == 1 时在调用线程串行执行；fn 不得抛出异常
+void parallelFor(size_t count, size_t grain, int threads,
+                 const std::function<void(size_t, size_t)> &fn);
+} // namespace imgc
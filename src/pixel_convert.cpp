@@ -0,0 +1,50 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "pixel_convert.h"
+namespace imgc {
+void pixel_convert<layout_rgb, layout_rgba>::run(const uint8_t *src,
+                                                 uint8_t *dst, size_t count) {
+  kernels().rgb_to_rgba(src, dst, count);
+}
+void pixel_convert<layout_bgr, layout_rgba>::run(const uint8_t *src,
+                                                 uint8_t *dst, size_t count) {
+  kernels().bgr_to_rgba(src, dst, count);
+}
+void pixel_convert<layout_bgra, layout_rgba>::run(const uint8_t *src,
+                                                  uint8_t *dst, size_t count) {
+  kernels().swap_rb32(src, dst, count);
+}
+void pixel_convert<layout_rgba, layout_bgra>::run(const uint8_t *src,
+                                                  uint8_t *dst, size_t count) {
+  kernels().swap_rb32(src, dst, count);
+}
+void pixel_convert<layout_rgba, layout_rgb>::run(const uint8_t *src,
+                                                 uint8_t *dst, size_t count) {
+  kernels().rgba_to_rgb(src, dst, count);
+}
+void pixel_convert<layout_rgba, layout_bgr>::run(const uint8_t *src,
+                                                 uint8_t *dst, size_t count) {
+  kernels().rgba_to_bgr(src, dst, count);
+}
+} // namespace imgc
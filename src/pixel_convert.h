@@ -0,0 +1,59 @@
+﻿#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "simd/kernels.h"
+namespace imgc {
+// 按 (源排列, 目标排列) 实例化的转换核；
+// 编解码器实际用到的组合在 pixel_convert.cpp 中特化，经 kernels() 分派到
+// 当前 CPU 支持的最佳实现
+template <class Src, class Dst> struct pixel_convert {
+  static void run(const uint8_t *src, uint8_t *dst, size_t count) {
+    convertScalar<Src, Dst>(src, dst, count);
+  }
+};
+template <> struct pixel_convert<layout_rgb, layout_rgba> {
+  static void run(const uint8_t *src, uint8_t *dst, size_t count);
+};
+template <> struct pixel_convert<layout_bgr, layout_rgba> {
+  static void run(const uint8_t *src, uint8_t *dst, size_t count);
+};
+template <> struct pixel_convert<layout_bgra, layout_rgba> {
+  static void run(const uint8_t *src, uint8_t *dst, size_t count);
+};
+template <> struct pixel_convert<layout_rgba, layout_bgra> {
+  static void run(const uint8_t *src, uint8_t *dst, size_t count);
+};
+template <> struct pixel_convert<layout_rgba, layout_rgb> {
+  static void run(const uint8_t *src, uint8_t *dst, size_t count);
+};
+template <> struct pixel_convert<layout_rgba, layout_bgr> {
+  static void run(const uint8_t *src, uint8_t *dst, size_t count);
+};
+
+// 转换 count 个像素
+template <class Src, class Dst>
+inline void convertPixels(const uint8_t *src, uint8_t *dst, size_t count) {
+  pixel_convert<Src, Dst>::run(src, dst, count);
+}
+} // namespace imgc
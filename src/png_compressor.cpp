@@ -22,6 +22,10 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 #include "image_compress/png_compressor.h"
+#include "image_compress/trace.h"
+#include "image_resize.h"
+#include "memory_account.h"
+#include "size_math.h"
 #include <cstring>
 #include <png.h>
 #include <vector>
@@ -55,10 +59,20 @@ static void png_write_to_mem(png_structp png_ptr, png_bytep data,
 static void png_flush_noop(png_structp) {}
 bool png_compressor::decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
                                   ImageRGBA &outRGBA) {
-  if (!inputBuffer || inputSize < 8)
+  return decodeToRGBA(inputBuffer, inputSize, outRGBA, decode_params());
+}
+bool png_compressor::decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
+                                  ImageRGBA &outRGBA,
+                                  const decode_params &params) {
+  IMGC_TRACE_SCOPE("decode");
+  // 先按 IHDR 检查尺寸限制，再交给 libpng
+  int hw, hh;
+  if (!readImageSize(inputBuffer, inputSize, hw, hh) ||
+      !params.limits.allowsImage(hw, hh))
     return false;
-  png_structp r =
-      png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+  png_structp r = png_create_read_struct_2(PNG_LIBPNG_VER_STRING, nullptr,
+                                           nullptr, nullptr, nullptr,
+                                           pngTrackedMalloc, pngTrackedFree);
   if (!r)
     return false;
   png_infop info = png_create_info_struct(r);
@@ -66,6 +80,7 @@ bool png_compressor::decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
     png_destroy_read_struct(&r, nullptr, nullptr);
     return false;
   }
+  memory_reservation hold;
   if (setjmp(png_jmpbuf(r))) {
     png_destroy_read_struct(&r, &info, nullptr);
     return false;
@@ -90,21 +105,82 @@ bool png_compressor::decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
   if (ct == PNG_COLOR_TYPE_GRAY || ct == PNG_COLOR_TYPE_GRAY_ALPHA)
     png_set_gray_to_rgb(r);
   png_read_update_info(r, info);
-  outRGBA.width = (int)w;
-  outRGBA.height = (int)h;
-  outRGBA.pixels.assign((size_t)w * h * 4, 0);
-  std::vector<png_bytep> rows(h);
-  for (size_t y = 0; y < h; ++y)
-    rows[y] = &outRGBA.pixels[y * w * 4];
-  png_read_image(r, rows.data());
+  // 裁剪区域，截到图像范围内
+  png_uint_32 rx = 0, ry = 0, rw = w, rh = h;
+  if (params.crop_width > 0 && params.crop_height > 0) {
+    rx = (png_uint_32)std::max(params.crop_x, 0);
+    ry = (png_uint_32)std::max(params.crop_y, 0);
+    if (rx >= w || ry >= h) {
+      png_destroy_read_struct(&r, &info, nullptr);
+      return false;
+    }
+    rw = std::min((png_uint_32)params.crop_width, w - rx);
+    rh = std::min((png_uint_32)params.crop_height, h - ry);
+  }
+  // 解码缓冲限制：分配像素缓冲之前检查，隔行图像需整幅缓冲
+  bool interlaced = png_get_interlace_type(r, info) != PNG_INTERLACE_NONE;
+  size_t bytes, fullBytes = 0;
+  if (!imageBytes((int)rw, (int)rh, 4, bytes) ||
+      (interlaced && (rw != w || rh != h) &&
+       !imageBytes((int)w, (int)h, 4, fullBytes)) ||
+      !params.limits.allowsDecoded((unsigned long long)bytes + fullBytes) ||
+      !hold.reserve(bytes + fullBytes + (size_t)w * 4)) {
+    png_destroy_read_struct(&r, &info, nullptr);
+    return false;
+  }
+  outRGBA.width = (int)rw;
+  outRGBA.height = (int)rh;
+  outRGBA.pixels.assign(bytes, 0);
+  if (rw == w && rh == h) {
+    std::vector<png_bytep> rows(h);
+    for (size_t y = 0; y < h; ++y)
+      rows[y] = &outRGBA.pixels[y * w * 4];
+    png_read_image(r, rows.data());
+  } else if (interlaced) {
+    // 隔行扫描需要读完全部 pass，先解整幅再裁剪
+    std::vector<uint8_t> full(fullBytes);
+    std::vector<png_bytep> rows(h);
+    for (size_t y = 0; y < h; ++y)
+      rows[y] = &full[y * w * 4];
+    png_read_image(r, rows.data());
+    for (png_uint_32 y = 0; y < rh; ++y)
+      std::memcpy(&outRGBA.pixels[(size_t)y * rw * 4],
+                  &full[((size_t)(ry + y) * w + rx) * 4], (size_t)rw * 4);
+  } else {
+    // 逐行读取，读到区域最后一行即停止
+    std::vector<uint8_t> row((size_t)w * 4);
+    for (png_uint_32 y = 0; y < ry + rh; ++y) {
+      png_read_row(r, row.data(), nullptr);
+      if (y >= ry)
+        std::memcpy(&outRGBA.pixels[(size_t)(y - ry) * rw * 4],
+                    &row[(size_t)rx * 4], (size_t)rw * 4);
+    }
+  }
   png_destroy_read_struct(&r, &info, nullptr);
   return true;
 }
-int png_compressor::encodeFromRGBA(const ImageRGBA &rgba,
-                                   std::vector<uint8_t> &outputBuffer,
-                                   const compress_params &params) {
-  if (rgba.width <= 0 || rgba.height <= 0 ||
-      rgba.pixels.size() < (size_t)rgba.width * rgba.height * 4)
+bool png_compressor::readImageSize(const uint8_t *inputBuffer,
+                                   size_t inputSize, int &width, int &height) {
+  IMGC_TRACE_SCOPE("header");
+  // 签名 8 字节 + IHDR 长度/类型 8 字节，随后为大端宽高
+  if (!inputBuffer || inputSize < 24 || std::memcmp(inputBuffer + 12, "IHDR", 4))
+    return false;
+  const uint8_t *p = inputBuffer + 16;
+  uint32_t w = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+               (uint32_t(p[2]) << 8) | p[3];
+  uint32_t h = (uint32_t(p[4]) << 24) | (uint32_t(p[5]) << 16) |
+               (uint32_t(p[6]) << 8) | p[7];
+  if (w == 0 || h == 0 || w > 0x7FFFFFFF || h > 0x7FFFFFFF)
+    return false;
+  width = (int)w;
+  height = (int)h;
+  return true;
+}
+int64_t png_compressor::encodeFromRGBA(const ImageRGBA &rgba,
+                                       std::vector<uint8_t> &outputBuffer,
+                                       const compress_params &params) {
+  IMGC_TRACE_SCOPE("encode");
+  if (!validRGBA(rgba))
     return -1;
 
   int w = rgba.width;
@@ -114,66 +190,19 @@ int png_compressor::encodeFromRGBA(const ImageRGBA &rgba,
   std::vector<uint8_t> scaledPixels;
 
   // --------------------
-  // 缩放处理
+  // 裁剪与缩放
   // --------------------
-  if (params.output_width > 0 && params.output_height > 0 &&
-      (params.output_width != w || params.output_height != h)) {
-    int newW = params.output_width;
-    int newH = params.output_height;
-    scaledPixels.resize((size_t)newW * newH * 4);
-
-    if (params.resize_algo == compress_params::ResizeAlgo::NEAREST) {
-      // 最近邻
-      for (int y = 0; y < newH; ++y) {
-        int srcY = y * h / newH;
-        for (int x = 0; x < newW; ++x) {
-          int srcX = x * w / newW;
-          const uint8_t *srcPix = &rgba.pixels[(size_t)(srcY * w + srcX) * 4];
-          uint8_t *dstPix = &scaledPixels[(size_t)(y * newW + x) * 4];
-          dstPix[0] = srcPix[0];
-          dstPix[1] = srcPix[1];
-          dstPix[2] = srcPix[2];
-          dstPix[3] = srcPix[3];
-        }
-      }
-    } else if (params.resize_algo == compress_params::ResizeAlgo::BILINEAR) {
-      // 双线性
-      for (int y = 0; y < newH; ++y) {
-        float srcY = (y + 0.5f) * h / newH - 0.5f;
-        int y0 = std::max(0, (int)floor(srcY));
-        int y1 = std::min(h - 1, y0 + 1);
-        float wy = srcY - y0;
-        for (int x = 0; x < newW; ++x) {
-          float srcX = (x + 0.5f) * w / newW - 0.5f;
-          int x0 = std::max(0, (int)floor(srcX));
-          int x1 = std::min(w - 1, x0 + 1);
-          float wx = srcX - x0;
-
-          const uint8_t *p00 = &rgba.pixels[(size_t)(y0 * w + x0) * 4];
-          const uint8_t *p01 = &rgba.pixels[(size_t)(y0 * w + x1) * 4];
-          const uint8_t *p10 = &rgba.pixels[(size_t)(y1 * w + x0) * 4];
-          const uint8_t *p11 = &rgba.pixels[(size_t)(y1 * w + x1) * 4];
-
-          uint8_t *dstPix = &scaledPixels[(size_t)(y * newW + x) * 4];
-          for (int c = 0; c < 4; ++c) {
-            float top = p00[c] * (1 - wx) + p01[c] * wx;
-            float bottom = p10[c] * (1 - wx) + p11[c] * wx;
-            dstPix[c] = (uint8_t)(top * (1 - wy) + bottom * wy + 0.5f);
-          }
-        }
-      }
-    }
-
-    w = newW;
-    h = newH;
-    pixelData = scaledPixels.data();
-  }
+  memory_reservation hold;
+  pixelData = applyGeometry(params, pixelData, w, h, scaledPixels, &hold);
+  if (!pixelData)
+    return -1;
 
   // --------------------
   // 写 PNG
   // --------------------
-  png_structp w_ptr =
-      png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+  png_structp w_ptr = png_create_write_struct_2(
+      PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr, nullptr,
+      pngTrackedMalloc, pngTrackedFree);
   if (!w_ptr)
     return -1;
   png_infop info = png_create_info_struct(w_ptr);
@@ -181,6 +210,10 @@ int png_compressor::encodeFromRGBA(const ImageRGBA &rgba,
     png_destroy_write_struct(&w_ptr, nullptr);
     return -1;
   }
+  // 行指针在 setjmp 之前备好，跳回后不再使用寄存器中的局部变量
+  std::vector<png_bytep> rows(h);
+  for (int y = 0; y < h; ++y)
+    rows[y] = (png_bytep)&pixelData[(size_t)y * w * 4];
   if (setjmp(png_jmpbuf(w_ptr))) {
     png_destroy_write_struct(&w_ptr, &info);
     return -1;
@@ -198,23 +231,130 @@ int png_compressor::encodeFromRGBA(const ImageRGBA &rgba,
 
   png_write_info(w_ptr, info);
 
-  std::vector<png_bytep> rows(h);
-  for (int y = 0; y < h; ++y)
-    rows[y] = (png_bytep)&pixelData[y * w * 4];
-
   png_write_image(w_ptr, rows.data());
   png_write_end(w_ptr, nullptr);
   png_destroy_write_struct(&w_ptr, &info);
+  hold.add(outputBuffer.capacity() + rows.capacity() * sizeof(png_bytep));
 
-  return (int)outputBuffer.size();
+  return (int64_t)outputBuffer.size();
 }
 
-int png_compressor::compressMemory(const uint8_t *inputBuffer, size_t inputSize,
-                                   std::vector<uint8_t> &outputBuffer,
-                                   const compress_params &params) {
-  ImageRGBA rgba;
-  if (!decodeToRGBA(inputBuffer, inputSize, rgba))
+bool png_compressor::decodeToTiled(const uint8_t *inputBuffer,
+                                   size_t inputSize, tiled_image &out,
+                                   const decode_limits &limits) {
+  IMGC_TRACE_SCOPE("decode");
+  int hw, hh;
+  if (!readImageSize(inputBuffer, inputSize, hw, hh) ||
+      !limits.allowsImage(hw, hh))
+    return false;
+  png_structp r = png_create_read_struct_2(PNG_LIBPNG_VER_STRING, nullptr,
+                                           nullptr, nullptr, nullptr,
+                                           pngTrackedMalloc, pngTrackedFree);
+  if (!r)
+    return false;
+  png_infop info = png_create_info_struct(r);
+  if (!info) {
+    png_destroy_read_struct(&r, nullptr, nullptr);
+    return false;
+  }
+  if (setjmp(png_jmpbuf(r))) {
+    png_destroy_read_struct(&r, &info, nullptr);
+    return false;
+  }
+  MemReaderState state{inputBuffer, inputSize, 0};
+  png_set_read_fn(r, &state, png_read_from_mem);
+  png_read_info(r, info);
+  int bd = png_get_bit_depth(r, info);
+  int ct = png_get_color_type(r, info);
+  if (bd == 16)
+    png_set_strip_16(r);
+  if (ct == PNG_COLOR_TYPE_PALETTE)
+    png_set_palette_to_rgb(r);
+  if (ct == PNG_COLOR_TYPE_GRAY && bd < 8)
+    png_set_expand_gray_1_2_4_to_8(r);
+  if (png_get_valid(r, info, PNG_INFO_tRNS))
+    png_set_tRNS_to_alpha(r);
+  if (ct == PNG_COLOR_TYPE_RGB || ct == PNG_COLOR_TYPE_GRAY)
+    png_set_filler(r, 0xFF, PNG_FILLER_AFTER);
+  if (ct == PNG_COLOR_TYPE_GRAY || ct == PNG_COLOR_TYPE_GRAY_ALPHA)
+    png_set_gray_to_rgb(r);
+  int passes = png_set_interlace_handling(r);
+  png_read_update_info(r, info);
+  if (!out.create(hw, hh)) {
+    png_destroy_read_struct(&r, &info, nullptr);
+    return false;
+  }
+  // 隔行图像：libpng 只写入本 pass 的像素，先读回前几个 pass 的结果再合并
+  std::vector<uint8_t> row((size_t)hw * 4);
+  bool ok = true;
+  for (int pass = 0; ok && pass < passes; ++pass) {
+    for (int y = 0; ok && y < hh; ++y) {
+      if (pass > 0)
+        ok = out.readRow(y, 0, hw, row.data());
+      png_read_row(r, row.data(), nullptr);
+      ok = ok && out.writeRow(y, 0, hw, row.data());
+    }
+  }
+  if (ok)
+    png_read_end(r, nullptr);
+  png_destroy_read_struct(&r, &info, nullptr);
+  return ok;
+}
+int64_t png_compressor::encodeFromTiled(tiled_image &img,
+                                        std::vector<uint8_t> &outputBuffer,
+                                        const compress_params &params) {
+  IMGC_TRACE_SCOPE("encode");
+  int w = img.width(), h = img.height();
+  if (w <= 0 || h <= 0)
+    return -1;
+  png_structp w_ptr = png_create_write_struct_2(
+      PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr, nullptr,
+      pngTrackedMalloc, pngTrackedFree);
+  if (!w_ptr)
+    return -1;
+  png_infop info = png_create_info_struct(w_ptr);
+  if (!info) {
+    png_destroy_write_struct(&w_ptr, nullptr);
     return -1;
-  return encodeFromRGBA(rgba, outputBuffer, params);
+  }
+  if (setjmp(png_jmpbuf(w_ptr))) {
+    png_destroy_write_struct(&w_ptr, &info);
+    return -1;
+  }
+  outputBuffer.clear();
+  MemWriterState st{&outputBuffer};
+  png_set_write_fn(w_ptr, &st, png_write_to_mem, png_flush_noop);
+  png_set_IHDR(w_ptr, info, w, h, 8, PNG_COLOR_TYPE_RGBA, PNG_INTERLACE_NONE,
+               PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+  int zlevel = params.quality >= 0 && params.quality <= 9 ? params.quality : 6;
+  png_set_compression_level(w_ptr, zlevel);
+  png_write_info(w_ptr, info);
+  std::vector<uint8_t> row((size_t)w * 4);
+  for (int y = 0; y < h; ++y) {
+    if (!img.readRow(y, 0, w, row.data())) {
+      png_destroy_write_struct(&w_ptr, &info);
+      outputBuffer.clear();
+      return -1;
+    }
+    png_write_row(w_ptr, row.data());
+  }
+  png_write_end(w_ptr, nullptr);
+  png_destroy_write_struct(&w_ptr, &info);
+  return (int64_t)outputBuffer.size();
+}
+int64_t png_compressor::compressMemory(const uint8_t *inputBuffer,
+                                       size_t inputSize,
+                                       std::vector<uint8_t> &outputBuffer,
+                                       const compress_params &params) {
+  ImageRGBA rgba;
+  compress_params encodeParams;
+  int r = decodeForParams(*this, inputBuffer, inputSize, params, rgba,
+                          encodeParams);
+  if (r < 0)
+    return r;
+  // 解码结果在编码期间一直占用
+  memory_reservation hold;
+  hold.add(rgba.pixels.capacity());
+  return encodeFromRGBA(rgba, outputBuffer, encodeParams);
 }
 } // namespace imgc
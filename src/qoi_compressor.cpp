@@ -0,0 +1,294 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "image_compress/qoi_compressor.h"
+#include "image_compress/trace.h"
+#include "image_resize.h"
+#include "memory_account.h"
+#include "parallel_for.h"
+#include "size_math.h"
+#include "simd/kernels.h"
+#include <atomic>
+#include <cstring>
+#include <vector>
+namespace imgc {
+// 文件头 14 字节：magic、宽、高（大端）、通道数、色彩空间；结尾 7 个 0x00 + 0x01
+static const size_t kHeaderSize = 14;
+static const uint8_t kPadding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+// 规范建议的像素数上限，防止恶意尺寸
+static const uint64_t kMaxPixels = 400000000ULL;
+
+static const uint8_t kOpIndex = 0x00; // 00xxxxxx
+static const uint8_t kOpDiff = 0x40;  // 01xxxxxx
+static const uint8_t kOpLuma = 0x80;  // 10xxxxxx
+static const uint8_t kOpRun = 0xC0;   // 11xxxxxx
+static const uint8_t kOpRgb = 0xFE;
+static const uint8_t kOpRgba = 0xFF;
+static const uint8_t kMask2 = 0xC0;
+
+struct QoiRgba {
+  uint8_t r, g, b, a;
+};
+static inline bool samePixel(const QoiRgba &x, const QoiRgba &y) {
+  return x.r == y.r && x.g == y.g && x.b == y.b && x.a == y.a;
+}
+static inline int qoiHash(const QoiRgba &p) {
+  return (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) % 64;
+}
+static inline uint32_t readBE32(const uint8_t *p) {
+  return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+         (uint32_t(p[2]) << 8) | p[3];
+}
+static inline void writeBE32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+static bool parseQoiHeader(const uint8_t *p, size_t size, uint32_t &w,
+                           uint32_t &h) {
+  if (!p || size < kHeaderSize + sizeof(kPadding) || std::memcmp(p, "qoif", 4))
+    return false;
+  w = readBE32(p + 4);
+  h = readBE32(p + 8);
+  uint8_t channels = p[12], colorspace = p[13];
+  if (w == 0 || h == 0 || w > 0x7FFFFFFF || h > 0x7FFFFFFF ||
+      (uint64_t)w * h > kMaxPixels || channels < 3 || channels > 4 ||
+      colorspace > 1)
+    return false;
+  return true;
+}
+bool qoi_compressor::readImageSize(const uint8_t *inputBuffer,
+                                   size_t inputSize, int &width, int &height) {
+  IMGC_TRACE_SCOPE("header");
+  uint32_t w, h;
+  if (!parseQoiHeader(inputBuffer, inputSize, w, h))
+    return false;
+  width = (int)w;
+  height = (int)h;
+  return true;
+}
+bool qoi_compressor::decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
+                                  ImageRGBA &outRGBA) {
+  return decodeToRGBA(inputBuffer, inputSize, outRGBA, decode_params());
+}
+bool qoi_compressor::decodeToRGBA(const uint8_t *inputBuffer, size_t inputSize,
+                                  ImageRGBA &outRGBA,
+                                  const decode_params &params) {
+  IMGC_TRACE_SCOPE("decode");
+  uint32_t w, h;
+  if (!parseQoiHeader(inputBuffer, inputSize, w, h) ||
+      !params.limits.allowsImage(w, h) ||
+      !params.limits.allowsDecoded((unsigned long long)w * h * 4))
+    return false;
+  size_t count = (size_t)w * h;
+  // 每个像素至少占 1/62 字节（RUN），数据明显不足时提前拒绝
+  size_t chunksEnd = inputSize - sizeof(kPadding);
+  if ((chunksEnd - kHeaderSize) * 62 < count)
+    return false;
+  memory_reservation hold;
+  if (!hold.reserve(count * 4))
+    return false;
+  outRGBA.width = (int)w;
+  outRGBA.height = (int)h;
+  outRGBA.pixels.resize(count * 4);
+  QoiRgba index[64];
+  std::memset(index, 0, sizeof(index));
+  QoiRgba px = {0, 0, 0, 255};
+  const uint8_t *p = inputBuffer;
+  size_t pos = kHeaderSize;
+  int run = 0;
+  uint8_t *dst = outRGBA.pixels.data();
+  for (size_t i = 0; i < count; ++i) {
+    if (run > 0) {
+      --run;
+    } else {
+      if (pos >= chunksEnd)
+        return false;
+      uint8_t b1 = p[pos++];
+      if (b1 == kOpRgb) {
+        if (pos + 3 > chunksEnd)
+          return false;
+        px.r = p[pos];
+        px.g = p[pos + 1];
+        px.b = p[pos + 2];
+        pos += 3;
+      } else if (b1 == kOpRgba) {
+        if (pos + 4 > chunksEnd)
+          return false;
+        px.r = p[pos];
+        px.g = p[pos + 1];
+        px.b = p[pos + 2];
+        px.a = p[pos + 3];
+        pos += 4;
+      } else if ((b1 & kMask2) == kOpIndex) {
+        px = index[b1];
+      } else if ((b1 & kMask2) == kOpDiff) {
+        px.r += ((b1 >> 4) & 0x03) - 2;
+        px.g += ((b1 >> 2) & 0x03) - 2;
+        px.b += (b1 & 0x03) - 2;
+      } else if ((b1 & kMask2) == kOpLuma) {
+        if (pos >= chunksEnd)
+          return false;
+        uint8_t b2 = p[pos++];
+        int vg = (b1 & 0x3F) - 32;
+        px.r += vg - 8 + ((b2 >> 4) & 0x0F);
+        px.g += vg;
+        px.b += vg - 8 + (b2 & 0x0F);
+      } else {
+        run = b1 & 0x3F;
+      }
+      index[qoiHash(px)] = px;
+    }
+    dst[i * 4 + 0] = px.r;
+    dst[i * 4 + 1] = px.g;
+    dst[i * 4 + 2] = px.b;
+    dst[i * 4 + 3] = px.a;
+  }
+  // 逐像素依赖前序状态，无法只解区域，整幅解码后裁剪
+  return cropRGBA(outRGBA, params);
+}
+int64_t qoi_compressor::encodeFromRGBA(const ImageRGBA &rgba,
+                                       std::vector<uint8_t> &outputBuffer,
+                                       const compress_params &params) {
+  IMGC_TRACE_SCOPE("encode");
+  if (!validRGBA(rgba))
+    return -1;
+
+  int w = rgba.width;
+  int h = rgba.height;
+  const uint8_t *pixelData = rgba.pixels.data();
+  std::vector<uint8_t> scaledPixels;
+
+  // --------------------
+  // 裁剪与缩放
+  // --------------------
+  memory_reservation hold;
+  pixelData = applyGeometry(params, pixelData, w, h, scaledPixels, &hold);
+  if (!pixelData)
+    return -1;
+  size_t count = (size_t)w * h;
+  if (count > kMaxPixels)
+    return -1;
+
+  // --------------------
+  // 写 QOI
+  // --------------------
+  // 最坏情况每像素 5 字节（RGBA 操作）
+  size_t worst = kHeaderSize + count * 5 + sizeof(kPadding);
+  if (!hold.reserve(worst))
+    return -1;
+  outputBuffer.resize(worst);
+  uint8_t *out = outputBuffer.data();
+  std::memcpy(out, "qoif", 4);
+  writeBE32(out + 4, (uint32_t)w);
+  writeBE32(out + 8, (uint32_t)h);
+  // 通道数仅作说明：全部不透明时标记为 RGB。alpha 扫描分块并行，
+  // 各块取最小值后合并
+  std::atomic<int> minAlpha(255);
+  parallelFor(count, parallelGrain(4), params.threads,
+              [&](size_t b, size_t e) {
+    int m = kernels().min_alpha(pixelData + b * 4, e - b);
+    int cur = minAlpha.load();
+    while (m < cur && !minAlpha.compare_exchange_weak(cur, m)) {
+    }
+  });
+  out[12] = minAlpha.load() == 255 ? 3 : 4;
+  out[13] = 0; // sRGB
+  size_t pos = kHeaderSize;
+
+  QoiRgba index[64];
+  std::memset(index, 0, sizeof(index));
+  QoiRgba prev = {0, 0, 0, 255};
+  int run = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const uint8_t *s = pixelData + i * 4;
+    QoiRgba px = {s[0], s[1], s[2], s[3]};
+    if (samePixel(px, prev)) {
+      ++run;
+      if (run == 62 || i + 1 == count) {
+        out[pos++] = (uint8_t)(kOpRun | (run - 1));
+        run = 0;
+      }
+      continue;
+    }
+    if (run > 0) {
+      out[pos++] = (uint8_t)(kOpRun | (run - 1));
+      run = 0;
+    }
+    int idx = qoiHash(px);
+    if (samePixel(index[idx], px)) {
+      out[pos++] = (uint8_t)(kOpIndex | idx);
+    } else {
+      index[idx] = px;
+      if (px.a == prev.a) {
+        int8_t vr = (int8_t)(px.r - prev.r);
+        int8_t vg = (int8_t)(px.g - prev.g);
+        int8_t vb = (int8_t)(px.b - prev.b);
+        int8_t vgr = (int8_t)(vr - vg);
+        int8_t vgb = (int8_t)(vb - vg);
+        if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+          out[pos++] =
+              (uint8_t)(kOpDiff | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+        } else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 &&
+                   vgb < 8) {
+          out[pos++] = (uint8_t)(kOpLuma | (vg + 32));
+          out[pos++] = (uint8_t)((vgr + 8) << 4 | (vgb + 8));
+        } else {
+          out[pos++] = kOpRgb;
+          out[pos++] = px.r;
+          out[pos++] = px.g;
+          out[pos++] = px.b;
+        }
+      } else {
+        out[pos++] = kOpRgba;
+        out[pos++] = px.r;
+        out[pos++] = px.g;
+        out[pos++] = px.b;
+        out[pos++] = px.a;
+      }
+    }
+    prev = px;
+  }
+  std::memcpy(out + pos, kPadding, sizeof(kPadding));
+  pos += sizeof(kPadding);
+  outputBuffer.resize(pos);
+  return (int64_t)outputBuffer.size();
+}
+
+int64_t qoi_compressor::compressMemory(const uint8_t *inputBuffer,
+                                       size_t inputSize,
+                                       std::vector<uint8_t> &outputBuffer,
+                                       const compress_params &params) {
+  ImageRGBA rgba;
+  compress_params encodeParams;
+  int r = decodeForParams(*this, inputBuffer, inputSize, params, rgba,
+                          encodeParams);
+  if (r < 0)
+    return r;
+  // 解码结果在编码期间一直占用
+  memory_reservation hold;
+  hold.add(rgba.pixels.capacity());
+  return encodeFromRGBA(rgba, outputBuffer, encodeParams);
+}
+} // namespace imgc
@@ -0,0 +1,195 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "kernels.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#if defined(IMGC_ARCH_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+namespace imgc {
+#if defined(IMGC_ARCH_X86)
+static void cpuid(int leaf, int sub, unsigned int r[4]) {
+#if defined(_MSC_VER)
+  int t[4];
+  __cpuidex(t, leaf, sub);
+  for (int i = 0; i < 4; ++i)
+    r[i] = (unsigned int)t[i];
+#else
+  __cpuid_count(leaf, sub, r[0], r[1], r[2], r[3]);
+#endif
+}
+static unsigned long long xgetbv0() {
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  unsigned int lo, hi;
+  __asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+  return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+#endif
+
+static SimdLevel detectHardware() {
+#if defined(IMGC_ARCH_X86)
+  unsigned int r[4];
+  cpuid(0, 0, r);
+  unsigned int maxLeaf = r[0];
+  cpuid(1, 0, r);
+  unsigned int ecx = r[2], edx = r[3];
+  if (!(edx & (1u << 26)))
+    return SimdLevel::SCALAR;
+  SimdLevel level = SimdLevel::SSE2;
+  if (!(ecx & (1u << 9)))
+    return level;
+  level = SimdLevel::SSSE3;
+  if (!(ecx & (1u << 19)))
+    return level;
+  level = SimdLevel::SSE41;
+  // AVX 需要操作系统保存 YMM 状态（OSXSAVE + XCR0 位 1、2）
+  bool osxsave = (ecx & (1u << 27)) != 0;
+  if (!osxsave || maxLeaf < 7)
+    return level;
+  unsigned long long xcr0 = xgetbv0();
+  if ((xcr0 & 0x6) != 0x6)
+    return level;
+  cpuid(7, 0, r);
+  unsigned int ebx7 = r[1];
+  if (!(ebx7 & (1u << 5)))
+    return level;
+  level = SimdLevel::AVX2;
+  // AVX-512 还需要 opmask/ZMM 状态（XCR0 位 5、6、7）
+  if ((xcr0 & 0xE0) == 0xE0 && (ebx7 & (1u << 16)) && (ebx7 & (1u << 30)))
+    level = SimdLevel::AVX512BW;
+  return level;
+#elif defined(IMGC_ARCH_NEON)
+  return SimdLevel::NEON;
+#else
+  return SimdLevel::SCALAR;
+#endif
+}
+
+static void buildTable(SimdLevel level, kernel_table &t) {
+  fillKernelsScalar(t);
+#if defined(IMGC_ARCH_X86)
+  if (level == SimdLevel::NEON)
+    return;
+  if (level >= SimdLevel::SSE2)
+    fillKernelsSSE2(t);
+  if (level >= SimdLevel::SSSE3)
+    fillKernelsSSSE3(t);
+  if (level >= SimdLevel::SSE41)
+    fillKernelsSSE41(t);
+  if (level >= SimdLevel::AVX2)
+    fillKernelsAVX2(t);
+  if (level >= SimdLevel::AVX512BW)
+    fillKernelsAVX512BW(t);
+#elif defined(IMGC_ARCH_NEON)
+  if (level == SimdLevel::NEON)
+    fillKernelsNEON(t);
+#endif
+}
+
+// 把请求的级别限制在硬件支持范围内
+static SimdLevel clampLevel(SimdLevel want, SimdLevel hw) {
+  if (want == SimdLevel::NEON || hw == SimdLevel::NEON)
+    return want == hw ? want : SimdLevel::SCALAR;
+  return want > hw ? hw : want;
+}
+
+static bool parseLevel(const char *s, SimdLevel &out) {
+  static const struct {
+    const char *name;
+    SimdLevel level;
+  } names[] = {{"scalar", SimdLevel::SCALAR},   {"sse2", SimdLevel::SSE2},
+               {"ssse3", SimdLevel::SSSE3},     {"sse41", SimdLevel::SSE41},
+               {"sse4.1", SimdLevel::SSE41},    {"avx2", SimdLevel::AVX2},
+               {"avx512bw", SimdLevel::AVX512BW}, {"neon", SimdLevel::NEON}};
+  for (const auto &n : names) {
+    if (std::strcmp(s, n.name) == 0) {
+      out = n.level;
+      return true;
+    }
+  }
+  return false;
+}
+
+namespace {
+struct dispatch_state {
+  SimdLevel hardware;
+  kernel_table tables[7]; // 按 SimdLevel 下标
+  std::atomic<int> active;
+  dispatch_state() : hardware(detectHardware()), active(0) {
+    for (int i = 0; i < 7; ++i)
+      buildTable(clampLevel((SimdLevel)i, hardware), tables[i]);
+    SimdLevel level = hardware;
+    const char *env = std::getenv("IMGC_SIMD");
+    SimdLevel forced;
+    if (env && parseLevel(env, forced))
+      level = clampLevel(forced, hardware);
+    active.store((int)level);
+  }
+};
+} // namespace
+static dispatch_state &state() {
+  static dispatch_state s; // C++11 保证线程安全的一次初始化
+  return s;
+}
+
+const kernel_table &kernels() {
+  dispatch_state &s = state();
+  return s.tables[s.active.load(std::memory_order_relaxed)];
+}
+SimdLevel detectSimdLevel() { return state().hardware; }
+SimdLevel activeSimdLevel() { return (SimdLevel)state().active.load(); }
+SimdLevel setSimdLevel(SimdLevel level) {
+  dispatch_state &s = state();
+  SimdLevel l = clampLevel(level, s.hardware);
+  s.active.store((int)l);
+  return l;
+}
+const char *simdLevelName(SimdLevel level) {
+  switch (level) {
+  case SimdLevel::SCALAR:
+    return "scalar";
+  case SimdLevel::SSE2:
+    return "sse2";
+  case SimdLevel::SSSE3:
+    return "ssse3";
+  case SimdLevel::SSE41:
+    return "sse41";
+  case SimdLevel::AVX2:
+    return "avx2";
+  case SimdLevel::AVX512BW:
+    return "avx512bw";
+  case SimdLevel::NEON:
+    return "neon";
+  }
+  return "unknown";
+}
+} // namespace imgc
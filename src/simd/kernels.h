@@ -0,0 +1,205 @@
+﻿#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "image_compress/cpu_features.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||            \
+    defined(_M_IX86)
+#define IMGC_ARCH_X86 1
+#endif
+#if defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#define IMGC_ARCH_NEON 1
+#endif
+
+namespace imgc {
+// 像素通道排列，a < 0 表示无 alpha 通道
+struct layout_rgb {
+  enum { channels = 3, r = 0, g = 1, b = 2, a = -1 };
+};
+struct layout_bgr {
+  enum { channels = 3, r = 2, g = 1, b = 0, a = -1 };
+};
+struct layout_rgba {
+  enum { channels = 4, r = 0, g = 1, b = 2, a = 3 };
+};
+struct layout_bgra {
+  enum { channels = 4, r = 2, g = 1, b = 0, a = 3 };
+};
+
+// 像素行转换：count 个像素
+typedef void (*convert_row_fn)(const uint8_t *src, uint8_t *dst, size_t count);
+// 最近邻缩放一行：dst 第 x 个像素取 src 第 xofs[x] 个像素
+typedef void (*resize_nearest_row_fn)(const uint8_t *src, const int *xofs,
+                                      uint8_t *dst, int dstW);
+// 双线性缩放一行：在 r0/r1 两行间按 wy 插值，横向取 x0/x1 与权重 wx
+typedef void (*resize_bilinear_row_fn)(const uint8_t *r0, const uint8_t *r1,
+                                       const int *x0, const int *x1,
+                                       const float *wx, float wy, uint8_t *dst,
+                                       int dstW);
+// 两行 2x2 盒式下采样为一行（奇数宽度最后一列复制边缘）
+typedef void (*downsample2x_row_fn)(const uint8_t *r0, const uint8_t *r1,
+                                    int srcW, uint8_t *dst, int dstW);
+// RGBA 像素中 alpha 的最小值
+typedef uint8_t (*min_alpha_fn)(const uint8_t *rgba, size_t count);
+// 32 位像素块转置：src 为 w*h，dst 第 i 行第 j 个像素取 src 第 j 行第 i 个
+// 像素。行间距可为负，配合转置实现旋转与翻转
+typedef void (*transpose32_fn)(const uint8_t *src, ptrdiff_t srcStride,
+                               uint8_t *dst, ptrdiff_t dstStride, int w, int h);
+// 32 位像素逆序：dst 第 i 个像素取 src 第 count-1-i 个像素
+typedef void (*reverse32_row_fn)(const uint8_t *src, uint8_t *dst, int count);
+// RGBA 转亮度：Y = (77R + 150G + 29B + 128) >> 8（BT.601 全范围）
+typedef void (*rgba_to_luma_fn)(const uint8_t *rgba, uint8_t *luma,
+                                size_t count);
+// SSIM 统计量按列累加：sa += a，sb += b，sq += a*a + b*b，sab += a*b
+typedef void (*ssim_accum_row_fn)(const uint8_t *a, const uint8_t *b,
+                                  int count, uint32_t *sa, uint32_t *sb,
+                                  uint32_t *sq, uint32_t *sab);
+
+struct kernel_table {
+  convert_row_fn rgb_to_rgba;
+  convert_row_fn bgr_to_rgba;
+  convert_row_fn swap_rb32; // BGRA <-> RGBA
+  convert_row_fn rgba_to_rgb;
+  convert_row_fn rgba_to_bgr;
+  resize_nearest_row_fn resize_nearest_row;
+  resize_bilinear_row_fn resize_bilinear_row;
+  downsample2x_row_fn downsample2x_row;
+  min_alpha_fn min_alpha;
+  transpose32_fn transpose32;
+  reverse32_row_fn reverse32_row;
+  rgba_to_luma_fn rgba_to_luma;
+  ssim_accum_row_fn ssim_accum_row;
+};
+// 当前 SIMD 级别对应的函数表
+const kernel_table &kernels();
+
+// 各指令集实现只覆盖自己支持的条目，按级别从低到高依次填表
+void fillKernelsScalar(kernel_table &t);
+#ifdef IMGC_ARCH_X86
+void fillKernelsSSE2(kernel_table &t);
+void fillKernelsSSSE3(kernel_table &t);
+void fillKernelsSSE41(kernel_table &t);
+void fillKernelsAVX2(kernel_table &t);
+void fillKernelsAVX512BW(kernel_table &t);
+#endif
+#ifdef IMGC_ARCH_NEON
+void fillKernelsNEON(kernel_table &t);
+#endif
+
+// 以下标量实现供各指令集文件处理尾部像素。各 kernels_*.cpp 使用不同的
+// 编译选项，放在匿名命名空间中保证每个编译单元持有自己的副本，避免链接器
+// 把 AVX2 编译的内联副本合并给低级别代码使用
+namespace {
+template <class Src, class Dst>
+inline void convertScalar(const uint8_t *src, uint8_t *dst, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    const uint8_t *s = src + i * Src::channels;
+    uint8_t *d = dst + i * Dst::channels;
+    d[Dst::r] = s[Src::r];
+    d[Dst::g] = s[Src::g];
+    d[Dst::b] = s[Src::b];
+    if (Dst::a >= 0)
+      d[Dst::a < 0 ? 0 : Dst::a] =
+          Src::a >= 0 ? s[Src::a < 0 ? 0 : Src::a] : 255;
+  }
+}
+inline void downsampleScalar(const uint8_t *r0, const uint8_t *r1, int srcW,
+                             uint8_t *dst, int dstW, int x) {
+  int pairs = srcW / 2;
+  for (; x < pairs; ++x) {
+    const uint8_t *a = r0 + x * 8;
+    const uint8_t *b = r1 + x * 8;
+    uint8_t *d = dst + x * 4;
+    for (int c = 0; c < 4; ++c)
+      d[c] = (uint8_t)((a[c] + a[c + 4] + b[c] + b[c + 4] + 2) >> 2);
+  }
+  if (x < dstW) {
+    const uint8_t *a = r0 + x * 8;
+    const uint8_t *b = r1 + x * 8;
+    uint8_t *d = dst + x * 4;
+    for (int c = 0; c < 4; ++c)
+      d[c] = (uint8_t)((a[c] + b[c] + 1) >> 1);
+  }
+}
+inline uint8_t minAlphaScalar(const uint8_t *rgba, size_t count, uint8_t m) {
+  for (size_t i = 0; i < count; ++i)
+    if (rgba[i * 4 + 3] < m)
+      m = rgba[i * 4 + 3];
+  return m;
+}
+// 转置 src 中列 [x0, w)、行 [0, h) 与列 [0, w)、行 [y0, h) 两条边带，
+// 供 SIMD 实现处理整块之外的剩余像素
+inline void transposeEdges(const uint8_t *src, ptrdiff_t srcStride,
+                           uint8_t *dst, ptrdiff_t dstStride, int w, int h,
+                           int x0, int y0) {
+  for (int i = 0; i < w; ++i) {
+    uint8_t *d = dst + i * dstStride;
+    for (int j = i < x0 ? y0 : 0; j < h; ++j)
+      std::memcpy(d + j * 4, src + j * srcStride + i * 4, 4);
+  }
+}
+inline void reverseScalar(const uint8_t *src, uint8_t *dst, int count, int i) {
+  for (; i < count; ++i)
+    std::memcpy(dst + (size_t)i * 4, src + (size_t)(count - 1 - i) * 4, 4);
+}
+inline void lumaScalar(const uint8_t *rgba, uint8_t *luma, size_t count,
+                       size_t i) {
+  for (; i < count; ++i) {
+    const uint8_t *p = rgba + i * 4;
+    luma[i] = (uint8_t)((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+  }
+}
+inline void ssimAccumScalar(const uint8_t *a, const uint8_t *b, int count,
+                            uint32_t *sa, uint32_t *sb, uint32_t *sq,
+                            uint32_t *sab, int i) {
+  for (; i < count; ++i) {
+    uint32_t x = a[i], y = b[i];
+    sa[i] += x;
+    sb[i] += y;
+    sq[i] += x * x + y * y;
+    sab[i] += x * y;
+  }
+}
+inline void bilinearScalar(const uint8_t *r0, const uint8_t *r1, const int *x0,
+                           const int *x1, const float *wx, float wy,
+                           uint8_t *dst, int dstW, int x) {
+  for (; x < dstW; ++x) {
+    const uint8_t *p00 = r0 + (size_t)x0[x] * 4;
+    const uint8_t *p01 = r0 + (size_t)x1[x] * 4;
+    const uint8_t *p10 = r1 + (size_t)x0[x] * 4;
+    const uint8_t *p11 = r1 + (size_t)x1[x] * 4;
+    float w = wx[x];
+    uint8_t *d = dst + (size_t)x * 4;
+    for (int c = 0; c < 4; ++c) {
+      float top = p00[c] * (1 - w) + p01[c] * w;
+      float bottom = p10[c] * (1 - w) + p11[c] * w;
+      d[c] = (uint8_t)(top * (1 - wy) + bottom * wy + 0.5f);
+    }
+  }
+}
+} // namespace
+} // namespace imgc
@@ -0,0 +1,264 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "kernels.h"
+#ifdef IMGC_ARCH_X86
+#include <immintrin.h>
+namespace imgc {
+// 3 通道 -> 4 通道：每条 128 位通道处理 4 像素。高通道的 16 字节读取会越过
+// 8 像素末尾 4 字节，故循环条件多留 2 个像素
+static size_t expand3to4(const uint8_t *src, uint8_t *dst, size_t count,
+                         __m256i mask) {
+  const __m256i alpha = _mm256_set1_epi32((int)0xFF000000u);
+  size_t i = 0;
+  for (; i + 10 <= count; i += 8) {
+    const uint8_t *s = src + i * 3;
+    __m256i v = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)s)),
+        _mm_loadu_si128((const __m128i *)(s + 12)), 1);
+    _mm256_storeu_si256((__m256i *)(dst + i * 4),
+                        _mm256_or_si256(_mm256_shuffle_epi8(v, mask), alpha));
+  }
+  return i;
+}
+// 4 通道 -> 3 通道：每次 8 像素，通道内压缩到低 12 字节后跨通道拼接
+static size_t pack4to3(const uint8_t *src, uint8_t *dst, size_t count,
+                       __m256i mask) {
+  const __m256i pack = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(src + i * 4));
+    v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, mask), pack);
+    uint8_t *d = dst + i * 3;
+    _mm_storeu_si128((__m128i *)d, _mm256_castsi256_si128(v));
+    _mm_storel_epi64((__m128i *)(d + 16), _mm256_extracti128_si256(v, 1));
+  }
+  return i;
+}
+#define IMGC_MASK256(...)                                                      \
+  _mm256_broadcastsi128_si256(_mm_setr_epi8(__VA_ARGS__))
+static void rgbToRgba(const uint8_t *src, uint8_t *dst, size_t count) {
+  size_t i = expand3to4(src, dst, count,
+                        IMGC_MASK256(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9,
+                                     10, 11, -1));
+  convertScalar<layout_rgb, layout_rgba>(src + i * 3, dst + i * 4, count - i);
+}
+static void bgrToRgba(const uint8_t *src, uint8_t *dst, size_t count) {
+  size_t i = expand3to4(src, dst, count,
+                        IMGC_MASK256(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11,
+                                     10, 9, -1));
+  convertScalar<layout_bgr, layout_rgba>(src + i * 3, dst + i * 4, count - i);
+}
+static void swapRb32(const uint8_t *src, uint8_t *dst, size_t count) {
+  const __m256i mask =
+      IMGC_MASK256(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(src + i * 4));
+    _mm256_storeu_si256((__m256i *)(dst + i * 4), _mm256_shuffle_epi8(v, mask));
+  }
+  convertScalar<layout_bgra, layout_rgba>(src + i * 4, dst + i * 4, count - i);
+}
+static void rgbaToRgb(const uint8_t *src, uint8_t *dst, size_t count) {
+  size_t i = pack4to3(src, dst, count,
+                      IMGC_MASK256(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1,
+                                   -1, -1, -1));
+  convertScalar<layout_rgba, layout_rgb>(src + i * 4, dst + i * 3, count - i);
+}
+static void rgbaToBgr(const uint8_t *src, uint8_t *dst, size_t count) {
+  size_t i = pack4to3(src, dst, count,
+                      IMGC_MASK256(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1,
+                                   -1, -1, -1));
+  convertScalar<layout_rgba, layout_bgr>(src + i * 4, dst + i * 3, count - i);
+}
+static void resizeNearestRowAVX2(const uint8_t *src, const int *xofs,
+                                 uint8_t *dst, int dstW) {
+  int x = 0;
+  for (; x + 8 <= dstW; x += 8) {
+    __m256i idx = _mm256_loadu_si256((const __m256i *)(xofs + x));
+    __m256i v = _mm256_i32gather_epi32((const int *)src, idx, 4);
+    _mm256_storeu_si256((__m256i *)(dst + (size_t)x * 4), v);
+  }
+  for (; x < dstW; ++x)
+    std::memcpy(dst + (size_t)x * 4, src + (size_t)xofs[x] * 4, 4);
+}
+static inline __m256 loadPixelPairPs(const uint8_t *a, const uint8_t *b) {
+  int32_t va, vb;
+  std::memcpy(&va, a, 4);
+  std::memcpy(&vb, b, 4);
+  __m128i v = _mm_unpacklo_epi32(_mm_cvtsi32_si128(va), _mm_cvtsi32_si128(vb));
+  return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v));
+}
+// 每次 2 个目标像素，运算顺序与标量实现相同
+static void resizeBilinearRowAVX2(const uint8_t *r0, const uint8_t *r1,
+                                  const int *x0, const int *x1,
+                                  const float *wx, float wy, uint8_t *dst,
+                                  int dstW) {
+  const __m256 vwy = _mm256_set1_ps(wy);
+  const __m256 vwy1 = _mm256_set1_ps(1 - wy);
+  const __m256 half = _mm256_set1_ps(0.5f);
+  int x = 0;
+  for (; x + 2 <= dstW; x += 2) {
+    __m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(wx[x])),
+                                    _mm_set1_ps(wx[x + 1]), 1);
+    __m256 a1 = _mm256_insertf128_ps(
+        _mm256_castps128_ps256(_mm_set1_ps(1 - wx[x])),
+        _mm_set1_ps(1 - wx[x + 1]), 1);
+    size_t o0 = (size_t)x0[x] * 4, o1 = (size_t)x1[x] * 4;
+    size_t q0 = (size_t)x0[x + 1] * 4, q1 = (size_t)x1[x + 1] * 4;
+    __m256 top = _mm256_add_ps(_mm256_mul_ps(loadPixelPairPs(r0 + o0, r0 + q0), a1),
+                               _mm256_mul_ps(loadPixelPairPs(r0 + o1, r0 + q1), a));
+    __m256 bot = _mm256_add_ps(_mm256_mul_ps(loadPixelPairPs(r1 + o0, r1 + q0), a1),
+                               _mm256_mul_ps(loadPixelPairPs(r1 + o1, r1 + q1), a));
+    __m256 v = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(top, vwy1), _mm256_mul_ps(bot, vwy)), half);
+    __m256i i = _mm256_cvttps_epi32(v);
+    __m128i p = _mm_packus_epi32(_mm256_castsi256_si128(i),
+                                 _mm256_extracti128_si256(i, 1));
+    _mm_storel_epi64((__m128i *)(dst + (size_t)x * 4), _mm_packus_epi16(p, p));
+  }
+  bilinearScalar(r0, r1, x0, x1, wx, wy, dst, dstW, x);
+}
+static uint8_t minAlphaAVX2(const uint8_t *rgba, size_t count) {
+  const __m256i rgbMask = _mm256_set1_epi32(0x00FFFFFF);
+  __m256i acc = _mm256_set1_epi8((char)0xFF);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(rgba + i * 4));
+    acc = _mm256_min_epu8(acc, _mm256_or_si256(v, rgbMask));
+  }
+  __m128i m = _mm_min_epu8(_mm256_castsi256_si128(acc),
+                           _mm256_extracti128_si256(acc, 1));
+  m = _mm_min_epu8(m, _mm_srli_si128(m, 8));
+  m = _mm_min_epu8(m, _mm_srli_si128(m, 4));
+  uint8_t r = (uint8_t)((uint32_t)_mm_cvtsi128_si32(m) >> 24);
+  return minAlphaScalar(rgba + i * 4, count - i, r);
+}
+// 8x8 微块转置：通道内两轮 unpack 得到 4x4 子块，再跨 128 位通道拼接
+static void transpose32AVX2(const uint8_t *src, ptrdiff_t srcStride,
+                            uint8_t *dst, ptrdiff_t dstStride, int w, int h) {
+  int bw = w & ~7, bh = h & ~7;
+  for (int j = 0; j < bh; j += 8) {
+    const uint8_t *s = src + j * srcStride;
+    for (int i = 0; i < bw; i += 8) {
+      __m256i r[8], t[8], u[8];
+      for (int k = 0; k < 8; ++k)
+        r[k] = _mm256_loadu_si256((const __m256i *)(s + k * srcStride + i * 4));
+      for (int k = 0; k < 8; k += 2) {
+        t[k] = _mm256_unpacklo_epi32(r[k], r[k + 1]);
+        t[k + 1] = _mm256_unpackhi_epi32(r[k], r[k + 1]);
+      }
+      for (int k = 0; k < 8; k += 4) {
+        u[k] = _mm256_unpacklo_epi64(t[k], t[k + 2]);
+        u[k + 1] = _mm256_unpackhi_epi64(t[k], t[k + 2]);
+        u[k + 2] = _mm256_unpacklo_epi64(t[k + 1], t[k + 3]);
+        u[k + 3] = _mm256_unpackhi_epi64(t[k + 1], t[k + 3]);
+      }
+      uint8_t *d = dst + i * dstStride + j * 4;
+      for (int k = 0; k < 4; ++k) {
+        _mm256_storeu_si256((__m256i *)(d + k * dstStride),
+                            _mm256_permute2x128_si256(u[k], u[k + 4], 0x20));
+        _mm256_storeu_si256((__m256i *)(d + (k + 4) * dstStride),
+                            _mm256_permute2x128_si256(u[k], u[k + 4], 0x31));
+      }
+    }
+  }
+  transposeEdges(src, srcStride, dst, dstStride, w, h, bw, bh);
+}
+static void reverse32RowAVX2(const uint8_t *src, uint8_t *dst, int count) {
+  const __m256i rev = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i v =
+        _mm256_loadu_si256((const __m256i *)(src + (count - 8 - i) * 4));
+    _mm256_storeu_si256((__m256i *)(dst + i * 4),
+                        _mm256_permutevar8x32_epi32(v, rev));
+  }
+  reverseScalar(src, dst, count, i);
+}
+static void rgbaToLumaAVX2(const uint8_t *rgba, uint8_t *luma, size_t count) {
+  const __m256i mask = _mm256_set1_epi32(0xFF);
+  const __m256i wr = _mm256_set1_epi32(77), wg = _mm256_set1_epi32(150),
+                wb = _mm256_set1_epi32(29), half = _mm256_set1_epi32(128);
+  // 两次打包按 128 位通道交错，最后按 4 像素一组还原顺序
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  size_t i = 0;
+  for (; i + 32 <= count; i += 32) {
+    __m256i y[4];
+    for (int j = 0; j < 4; ++j) {
+      __m256i v =
+          _mm256_loadu_si256((const __m256i *)(rgba + (i + j * 8) * 4));
+      __m256i r = _mm256_and_si256(v, mask);
+      __m256i g = _mm256_and_si256(_mm256_srli_epi32(v, 8), mask);
+      __m256i b = _mm256_and_si256(_mm256_srli_epi32(v, 16), mask);
+      __m256i s = _mm256_add_epi32(
+          _mm256_add_epi32(_mm256_mullo_epi16(r, wr), _mm256_mullo_epi16(g, wg)),
+          _mm256_add_epi32(_mm256_mullo_epi16(b, wb), half));
+      y[j] = _mm256_srli_epi32(s, 8);
+    }
+    __m256i lo = _mm256_packs_epi32(y[0], y[1]);
+    __m256i hi = _mm256_packs_epi32(y[2], y[3]);
+    _mm256_storeu_si256(
+        (__m256i *)(luma + i),
+        _mm256_permutevar8x32_epi32(_mm256_packus_epi16(lo, hi), order));
+  }
+  lumaScalar(rgba, luma, count, i);
+}
+static inline void addStore(uint32_t *p, __m256i v) {
+  _mm256_storeu_si256(
+      (__m256i *)p, _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)p), v));
+}
+// 样本零扩展到 32 位，高 16 位为 0，madd 即得到 32 位乘积
+static void ssimAccumRowAVX2(const uint8_t *a, const uint8_t *b, int count,
+                             uint32_t *sa, uint32_t *sb, uint32_t *sq,
+                             uint32_t *sab) {
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i va =
+        _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(a + i)));
+    __m256i vb =
+        _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(b + i)));
+    addStore(sa + i, va);
+    addStore(sb + i, vb);
+    addStore(sq + i, _mm256_add_epi32(_mm256_madd_epi16(va, va),
+                                      _mm256_madd_epi16(vb, vb)));
+    addStore(sab + i, _mm256_madd_epi16(va, vb));
+  }
+  ssimAccumScalar(a, b, count, sa, sb, sq, sab, i);
+}
+void fillKernelsAVX2(kernel_table &t) {
+  t.rgb_to_rgba = rgbToRgba;
+  t.bgr_to_rgba = bgrToRgba;
+  t.swap_rb32 = swapRb32;
+  t.rgba_to_rgb = rgbaToRgb;
+  t.rgba_to_bgr = rgbaToBgr;
+  t.resize_nearest_row = resizeNearestRowAVX2;
+  t.resize_bilinear_row = resizeBilinearRowAVX2;
+  t.min_alpha = minAlphaAVX2;
+  t.transpose32 = transpose32AVX2;
+  t.reverse32_row = reverse32RowAVX2;
+  t.rgba_to_luma = rgbaToLumaAVX2;
+  t.ssim_accum_row = ssimAccumRowAVX2;
+}
+} // namespace imgc
+#endif
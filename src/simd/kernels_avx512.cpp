@@ -0,0 +1,63 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "kernels.h"
+#ifdef IMGC_ARCH_X86
+#include <immintrin.h>
+namespace imgc {
+static void swapRb32(const uint8_t *src, uint8_t *dst, size_t count) {
+  // 用全掩码的 maskz 形式：GCC 12 的非掩码形式以未初始化的向量作透传
+  // 参数，-Wall 下误报 -Wuninitialized
+  const __m512i mask = _mm512_maskz_broadcast_i32x4(
+      (__mmask16)0xFFFF,
+      _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15));
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m512i v = _mm512_loadu_si512((const void *)(src + i * 4));
+    _mm512_storeu_si512((void *)(dst + i * 4), _mm512_shuffle_epi8(v, mask));
+  }
+  convertScalar<layout_bgra, layout_rgba>(src + i * 4, dst + i * 4, count - i);
+}
+static uint8_t minAlphaAVX512(const uint8_t *rgba, size_t count) {
+  const __m512i rgbMask = _mm512_set1_epi32(0x00FFFFFF);
+  __m512i acc = _mm512_set1_epi8((char)0xFF);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m512i v = _mm512_loadu_si512((const void *)(rgba + i * 4));
+    acc = _mm512_min_epu8(acc, _mm512_or_si512(v, rgbMask));
+  }
+  __m256i a = _mm256_min_epu8(_mm512_maskz_extracti64x4_epi64(0xFF, acc, 0),
+                              _mm512_maskz_extracti64x4_epi64(0xFF, acc, 1));
+  __m128i m = _mm_min_epu8(_mm256_castsi256_si128(a),
+                           _mm256_extracti128_si256(a, 1));
+  m = _mm_min_epu8(m, _mm_srli_si128(m, 8));
+  m = _mm_min_epu8(m, _mm_srli_si128(m, 4));
+  uint8_t r = (uint8_t)((uint32_t)_mm_cvtsi128_si32(m) >> 24);
+  return minAlphaScalar(rgba + i * 4, count - i, r);
+}
+void fillKernelsAVX512BW(kernel_table &t) {
+  t.swap_rb32 = swapRb32;
+  t.min_alpha = minAlphaAVX512;
+}
+} // namespace imgc
+#endif
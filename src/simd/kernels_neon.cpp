@@ -0,0 +1,202 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "kernels.h"
+#ifdef IMGC_ARCH_NEON
+#include <arm_neon.h>
+namespace imgc {
+static void rgbToRgba(const uint8_t *src, uint8_t *dst, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x3_t s = vld3q_u8(src + i * 3);
+    uint8x16x4_t d;
+    d.val[0] = s.val[0];
+    d.val[1] = s.val[1];
+    d.val[2] = s.val[2];
+    d.val[3] = vdupq_n_u8(255);
+    vst4q_u8(dst + i * 4, d);
+  }
+  convertScalar<layout_rgb, layout_rgba>(src + i * 3, dst + i * 4, count - i);
+}
+static void bgrToRgba(const uint8_t *src, uint8_t *dst, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x3_t s = vld3q_u8(src + i * 3);
+    uint8x16x4_t d;
+    d.val[0] = s.val[2];
+    d.val[1] = s.val[1];
+    d.val[2] = s.val[0];
+    d.val[3] = vdupq_n_u8(255);
+    vst4q_u8(dst + i * 4, d);
+  }
+  convertScalar<layout_bgr, layout_rgba>(src + i * 3, dst + i * 4, count - i);
+}
+static void swapRb32(const uint8_t *src, uint8_t *dst, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x4_t s = vld4q_u8(src + i * 4);
+    uint8x16_t t = s.val[0];
+    s.val[0] = s.val[2];
+    s.val[2] = t;
+    vst4q_u8(dst + i * 4, s);
+  }
+  convertScalar<layout_bgra, layout_rgba>(src + i * 4, dst + i * 4, count - i);
+}
+static void rgbaToRgb(const uint8_t *src, uint8_t *dst, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x4_t s = vld4q_u8(src + i * 4);
+    uint8x16x3_t d;
+    d.val[0] = s.val[0];
+    d.val[1] = s.val[1];
+    d.val[2] = s.val[2];
+    vst3q_u8(dst + i * 3, d);
+  }
+  convertScalar<layout_rgba, layout_rgb>(src + i * 4, dst + i * 3, count - i);
+}
+static void rgbaToBgr(const uint8_t *src, uint8_t *dst, size_t count) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x4_t s = vld4q_u8(src + i * 4);
+    uint8x16x3_t d;
+    d.val[0] = s.val[2];
+    d.val[1] = s.val[1];
+    d.val[2] = s.val[0];
+    vst3q_u8(dst + i * 3, d);
+  }
+  convertScalar<layout_rgba, layout_bgr>(src + i * 4, dst + i * 3, count - i);
+}
+static void downsample2xRowNEON(const uint8_t *r0, const uint8_t *r1, int srcW,
+                                uint8_t *dst, int dstW) {
+  int x = 0;
+  int pairs = srcW / 2;
+  for (; x + 8 <= pairs; x += 8) {
+    // 16 个源像素按通道拆开，相邻像素成对相加
+    uint8x16x4_t a = vld4q_u8(r0 + x * 8);
+    uint8x16x4_t b = vld4q_u8(r1 + x * 8);
+    uint8x8x4_t d;
+    for (int c = 0; c < 4; ++c) {
+      uint16x8_t s = vaddq_u16(vpaddlq_u8(a.val[c]), vpaddlq_u8(b.val[c]));
+      d.val[c] = vrshrn_n_u16(s, 2); // (s + 2) >> 2
+    }
+    vst4_u8(dst + x * 4, d);
+  }
+  downsampleScalar(r0, r1, srcW, dst, dstW, x);
+}
+static uint8_t minAlphaNEON(const uint8_t *rgba, size_t count) {
+  uint8x16_t acc = vdupq_n_u8(255);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16)
+    acc = vminq_u8(acc, vld4q_u8(rgba + i * 4).val[3]);
+  uint8x8_t m = vmin_u8(vget_low_u8(acc), vget_high_u8(acc));
+  m = vpmin_u8(m, m);
+  m = vpmin_u8(m, m);
+  m = vpmin_u8(m, m);
+  return minAlphaScalar(rgba + i * 4, count - i, vget_lane_u8(m, 0));
+}
+// 4x4 微块转置：vtrnq 交换相邻行的奇偶元素，再按 64 位半部拼接
+static void transpose32NEON(const uint8_t *src, ptrdiff_t srcStride,
+                            uint8_t *dst, ptrdiff_t dstStride, int w, int h) {
+  int bw = w & ~3, bh = h & ~3;
+  for (int j = 0; j < bh; j += 4) {
+    const uint8_t *s = src + j * srcStride;
+    for (int i = 0; i < bw; i += 4) {
+      uint32x4x2_t p01 =
+          vtrnq_u32(vld1q_u32((const uint32_t *)(s + i * 4)),
+                    vld1q_u32((const uint32_t *)(s + srcStride + i * 4)));
+      uint32x4x2_t p23 =
+          vtrnq_u32(vld1q_u32((const uint32_t *)(s + 2 * srcStride + i * 4)),
+                    vld1q_u32((const uint32_t *)(s + 3 * srcStride + i * 4)));
+      uint8_t *d = dst + i * dstStride + j * 4;
+      vst1q_u32((uint32_t *)d, vcombine_u32(vget_low_u32(p01.val[0]),
+                                            vget_low_u32(p23.val[0])));
+      vst1q_u32((uint32_t *)(d + dstStride),
+                vcombine_u32(vget_low_u32(p01.val[1]),
+                             vget_low_u32(p23.val[1])));
+      vst1q_u32((uint32_t *)(d + 2 * dstStride),
+                vcombine_u32(vget_high_u32(p01.val[0]),
+                             vget_high_u32(p23.val[0])));
+      vst1q_u32((uint32_t *)(d + 3 * dstStride),
+                vcombine_u32(vget_high_u32(p01.val[1]),
+                             vget_high_u32(p23.val[1])));
+    }
+  }
+  transposeEdges(src, srcStride, dst, dstStride, w, h, bw, bh);
+}
+static void reverse32RowNEON(const uint8_t *src, uint8_t *dst, int count) {
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    uint32x4_t v =
+        vrev64q_u32(vld1q_u32((const uint32_t *)(src + (count - 4 - i) * 4)));
+    vst1q_u32((uint32_t *)(dst + i * 4),
+              vcombine_u32(vget_high_u32(v), vget_low_u32(v)));
+  }
+  reverseScalar(src, dst, count, i);
+}
+static void rgbaToLumaNEON(const uint8_t *rgba, uint8_t *luma, size_t count) {
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    uint8x8x4_t v = vld4_u8(rgba + i * 4);
+    uint16x8_t s = vmull_u8(v.val[0], vdup_n_u8(77));
+    s = vmlal_u8(s, v.val[1], vdup_n_u8(150));
+    s = vmlal_u8(s, v.val[2], vdup_n_u8(29));
+    vst1_u8(luma + i, vrshrn_n_u16(s, 8));
+  }
+  lumaScalar(rgba, luma, count, i);
+}
+static void ssimAccumRowNEON(const uint8_t *a, const uint8_t *b, int count,
+                             uint32_t *sa, uint32_t *sb, uint32_t *sq,
+                             uint32_t *sab) {
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    uint16x8_t va = vmovl_u8(vld1_u8(a + i));
+    uint16x8_t vb = vmovl_u8(vld1_u8(b + i));
+    uint16x4_t al = vget_low_u16(va), ah = vget_high_u16(va);
+    uint16x4_t bl = vget_low_u16(vb), bh = vget_high_u16(vb);
+    vst1q_u32(sa + i, vaddw_u16(vld1q_u32(sa + i), al));
+    vst1q_u32(sa + i + 4, vaddw_u16(vld1q_u32(sa + i + 4), ah));
+    vst1q_u32(sb + i, vaddw_u16(vld1q_u32(sb + i), bl));
+    vst1q_u32(sb + i + 4, vaddw_u16(vld1q_u32(sb + i + 4), bh));
+    vst1q_u32(sq + i, vmlal_u16(vmlal_u16(vld1q_u32(sq + i), al, al), bl, bl));
+    vst1q_u32(sq + i + 4,
+              vmlal_u16(vmlal_u16(vld1q_u32(sq + i + 4), ah, ah), bh, bh));
+    vst1q_u32(sab + i, vmlal_u16(vld1q_u32(sab + i), al, bl));
+    vst1q_u32(sab + i + 4, vmlal_u16(vld1q_u32(sab + i + 4), ah, bh));
+  }
+  ssimAccumScalar(a, b, count, sa, sb, sq, sab, i);
+}
+void fillKernelsNEON(kernel_table &t) {
+  t.rgb_to_rgba = rgbToRgba;
+  t.bgr_to_rgba = bgrToRgba;
+  t.swap_rb32 = swapRb32;
+  t.rgba_to_rgb = rgbaToRgb;
+  t.rgba_to_bgr = rgbaToBgr;
+  t.downsample2x_row = downsample2xRowNEON;
+  t.min_alpha = minAlphaNEON;
+  t.transpose32 = transpose32NEON;
+  t.reverse32_row = reverse32RowNEON;
+  t.rgba_to_luma = rgbaToLumaNEON;
+  t.ssim_accum_row = ssimAccumRowNEON;
+}
+} // namespace imgc
+#endif
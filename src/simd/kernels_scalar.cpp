@@ -0,0 +1,88 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "kernels.h"
+namespace imgc {
+static void rgbToRgba(const uint8_t *src, uint8_t *dst, size_t count) {
+  convertScalar<layout_rgb, layout_rgba>(src, dst, count);
+}
+static void bgrToRgba(const uint8_t *src, uint8_t *dst, size_t count) {
+  convertScalar<layout_bgr, layout_rgba>(src, dst, count);
+}
+static void swapRb32(const uint8_t *src, uint8_t *dst, size_t count) {
+  convertScalar<layout_bgra, layout_rgba>(src, dst, count);
+}
+static void rgbaToRgb(const uint8_t *src, uint8_t *dst, size_t count) {
+  convertScalar<layout_rgba, layout_rgb>(src, dst, count);
+}
+static void rgbaToBgr(const uint8_t *src, uint8_t *dst, size_t count) {
+  convertScalar<layout_rgba, layout_bgr>(src, dst, count);
+}
+static void resizeNearestRow(const uint8_t *src, const int *xofs, uint8_t *dst,
+                             int dstW) {
+  for (int x = 0; x < dstW; ++x)
+    std::memcpy(dst + (size_t)x * 4, src + (size_t)xofs[x] * 4, 4);
+}
+static void resizeBilinearRow(const uint8_t *r0, const uint8_t *r1,
+                              const int *x0, const int *x1, const float *wx,
+                              float wy, uint8_t *dst, int dstW) {
+  bilinearScalar(r0, r1, x0, x1, wx, wy, dst, dstW, 0);
+}
+static void downsample2xRow(const uint8_t *r0, const uint8_t *r1, int srcW,
+                            uint8_t *dst, int dstW) {
+  downsampleScalar(r0, r1, srcW, dst, dstW, 0);
+}
+static uint8_t minAlpha(const uint8_t *rgba, size_t count) {
+  return minAlphaScalar(rgba, count, 255);
+}
+static void transpose32(const uint8_t *src, ptrdiff_t srcStride, uint8_t *dst,
+                        ptrdiff_t dstStride, int w, int h) {
+  transposeEdges(src, srcStride, dst, dstStride, w, h, 0, 0);
+}
+static void reverse32Row(const uint8_t *src, uint8_t *dst, int count) {
+  reverseScalar(src, dst, count, 0);
+}
+static void rgbaToLuma(const uint8_t *rgba, uint8_t *luma, size_t count) {
+  lumaScalar(rgba, luma, count, 0);
+}
+static void ssimAccumRow(const uint8_t *a, const uint8_t *b, int count,
+                         uint32_t *sa, uint32_t *sb, uint32_t *sq,
+                         uint32_t *sab) {
+  ssimAccumScalar(a, b, count, sa, sb, sq, sab, 0);
+}
+void fillKernelsScalar(kernel_table &t) {
+  t.rgb_to_rgba = rgbToRgba;
+  t.bgr_to_rgba = bgrToRgba;
+  t.swap_rb32 = swapRb32;
+  t.rgba_to_rgb = rgbaToRgb;
+  t.rgba_to_bgr = rgbaToBgr;
+  t.resize_nearest_row = resizeNearestRow;
+  t.resize_bilinear_row = resizeBilinearRow;
+  t.downsample2x_row = downsample2xRow;
+  t.min_alpha = minAlpha;
+  t.transpose32 = transpose32;
+  t.reverse32_row = reverse32Row;
+  t.rgba_to_luma = rgbaToLuma;
+  t.ssim_accum_row = ssimAccumRow;
+}
+} // namespace imgc
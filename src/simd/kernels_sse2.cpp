@@ -0,0 +1,172 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "kernels.h"
+#ifdef IMGC_ARCH_X86
+#include <emmintrin.h>
+namespace imgc {
+static void downsample2xRowSSE2(const uint8_t *r0, const uint8_t *r1, int srcW,
+                                uint8_t *dst, int dstW) {
+  int x = 0;
+  int pairs = srcW / 2; // 完整的 2 像素对数
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i two = _mm_set1_epi16(2);
+  for (; x + 4 <= pairs; x += 4) {
+    // 8 个源像素 -> 4 个目标像素
+    __m128i a0 = _mm_loadu_si128((const __m128i *)(r0 + x * 8));
+    __m128i a1 = _mm_loadu_si128((const __m128i *)(r0 + x * 8 + 16));
+    __m128i b0 = _mm_loadu_si128((const __m128i *)(r1 + x * 8));
+    __m128i b1 = _mm_loadu_si128((const __m128i *)(r1 + x * 8 + 16));
+    // 纵向相加（16 位）：每个寄存器含 2 个像素 x 4 通道
+    __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero),
+                               _mm_unpacklo_epi8(b0, zero));
+    __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero),
+                               _mm_unpackhi_epi8(b0, zero));
+    __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(a1, zero),
+                               _mm_unpacklo_epi8(b1, zero));
+    __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(a1, zero),
+                               _mm_unpackhi_epi8(b1, zero));
+    // 横向相邻像素相加，结果位于低 64 位
+    s0 = _mm_add_epi16(s0, _mm_srli_si128(s0, 8));
+    s1 = _mm_add_epi16(s1, _mm_srli_si128(s1, 8));
+    s2 = _mm_add_epi16(s2, _mm_srli_si128(s2, 8));
+    s3 = _mm_add_epi16(s3, _mm_srli_si128(s3, 8));
+    __m128i lo =
+        _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s0, s1), two), 2);
+    __m128i hi =
+        _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s2, s3), two), 2);
+    _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_packus_epi16(lo, hi));
+  }
+  downsampleScalar(r0, r1, srcW, dst, dstW, x);
+}
+static uint8_t minAlphaSSE2(const uint8_t *rgba, size_t count) {
+  // 颜色通道置 0xFF，只保留 alpha 参与取最小值
+  const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+  __m128i acc = _mm_set1_epi8((char)0xFF);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(rgba + i * 4));
+    acc = _mm_min_epu8(acc, _mm_or_si128(v, rgbMask));
+  }
+  acc = _mm_min_epu8(acc, _mm_srli_si128(acc, 8));
+  acc = _mm_min_epu8(acc, _mm_srli_si128(acc, 4));
+  uint8_t m = (uint8_t)((uint32_t)_mm_cvtsi128_si32(acc) >> 24);
+  return minAlphaScalar(rgba + i * 4, count - i, m);
+}
+// 4x4 微块转置：两轮 unpack（32 位、64 位）
+static void transpose32SSE2(const uint8_t *src, ptrdiff_t srcStride,
+                            uint8_t *dst, ptrdiff_t dstStride, int w, int h) {
+  int bw = w & ~3, bh = h & ~3;
+  for (int j = 0; j < bh; j += 4) {
+    const uint8_t *s = src + j * srcStride;
+    for (int i = 0; i < bw; i += 4) {
+      __m128i r0 = _mm_loadu_si128((const __m128i *)(s + i * 4));
+      __m128i r1 = _mm_loadu_si128((const __m128i *)(s + srcStride + i * 4));
+      __m128i r2 =
+          _mm_loadu_si128((const __m128i *)(s + 2 * srcStride + i * 4));
+      __m128i r3 =
+          _mm_loadu_si128((const __m128i *)(s + 3 * srcStride + i * 4));
+      __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+      __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+      __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+      __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+      uint8_t *d = dst + i * dstStride + j * 4;
+      _mm_storeu_si128((__m128i *)d, _mm_unpacklo_epi64(t0, t1));
+      _mm_storeu_si128((__m128i *)(d + dstStride), _mm_unpackhi_epi64(t0, t1));
+      _mm_storeu_si128((__m128i *)(d + 2 * dstStride),
+                       _mm_unpacklo_epi64(t2, t3));
+      _mm_storeu_si128((__m128i *)(d + 3 * dstStride),
+                       _mm_unpackhi_epi64(t2, t3));
+    }
+  }
+  transposeEdges(src, srcStride, dst, dstStride, w, h, bw, bh);
+}
+static void reverse32RowSSE2(const uint8_t *src, uint8_t *dst, int count) {
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + (count - 4 - i) * 4));
+    _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_shuffle_epi32(v, 0x1B));
+  }
+  reverseScalar(src, dst, count, i);
+}
+// 每像素一个 32 位通道：分离 R/G/B 后 16 位乘加，结果不超过 16 位
+static void rgbaToLumaSSE2(const uint8_t *rgba, uint8_t *luma, size_t count) {
+  const __m128i mask = _mm_set1_epi32(0xFF);
+  const __m128i wr = _mm_set1_epi32(77), wg = _mm_set1_epi32(150),
+                wb = _mm_set1_epi32(29), half = _mm_set1_epi32(128);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i y[4];
+    for (int j = 0; j < 4; ++j) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(rgba + (i + j * 4) * 4));
+      __m128i r = _mm_and_si128(v, mask);
+      __m128i g = _mm_and_si128(_mm_srli_epi32(v, 8), mask);
+      __m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), mask);
+      __m128i s = _mm_add_epi32(
+          _mm_add_epi32(_mm_mullo_epi16(r, wr), _mm_mullo_epi16(g, wg)),
+          _mm_add_epi32(_mm_mullo_epi16(b, wb), half));
+      y[j] = _mm_srli_epi32(s, 8);
+    }
+    __m128i lo = _mm_packs_epi32(y[0], y[1]);
+    __m128i hi = _mm_packs_epi32(y[2], y[3]);
+    _mm_storeu_si128((__m128i *)(luma + i), _mm_packus_epi16(lo, hi));
+  }
+  lumaScalar(rgba, luma, count, i);
+}
+static inline void addStore(uint32_t *p, __m128i v) {
+  _mm_storeu_si128((__m128i *)p,
+                   _mm_add_epi32(_mm_loadu_si128((const __m128i *)p), v));
+}
+// 8 个样本扩展到 16 位后，a/b 交错做 madd 得到 a*a + b*b，与 0 交错得到 a*b
+static void ssimAccumRowSSE2(const uint8_t *a, const uint8_t *b, int count,
+                             uint32_t *sa, uint32_t *sb, uint32_t *sq,
+                             uint32_t *sab) {
+  const __m128i z = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i va = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(a + i)), z);
+    __m128i vb = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(b + i)), z);
+    __m128i a0 = _mm_unpacklo_epi16(va, z), a1 = _mm_unpackhi_epi16(va, z);
+    __m128i b0 = _mm_unpacklo_epi16(vb, z), b1 = _mm_unpackhi_epi16(vb, z);
+    __m128i ab0 = _mm_unpacklo_epi16(va, vb), ab1 = _mm_unpackhi_epi16(va, vb);
+    addStore(sa + i, a0);
+    addStore(sa + i + 4, a1);
+    addStore(sb + i, b0);
+    addStore(sb + i + 4, b1);
+    addStore(sq + i, _mm_madd_epi16(ab0, ab0));
+    addStore(sq + i + 4, _mm_madd_epi16(ab1, ab1));
+    addStore(sab + i, _mm_madd_epi16(a0, b0));
+    addStore(sab + i + 4, _mm_madd_epi16(a1, b1));
+  }
+  ssimAccumScalar(a, b, count, sa, sb, sq, sab, i);
+}
+void fillKernelsSSE2(kernel_table &t) {
+  t.downsample2x_row = downsample2xRowSSE2;
+  t.min_alpha = minAlphaSSE2;
+  t.transpose32 = transpose32SSE2;
+  t.reverse32_row = reverse32RowSSE2;
+  t.rgba_to_luma = rgbaToLumaSSE2;
+  t.ssim_accum_row = ssimAccumRowSSE2;
+}
+} // namespace imgc
+#endif
@@ -0,0 +1,61 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "kernels.h"
+#ifdef IMGC_ARCH_X86
+#include <smmintrin.h>
+namespace imgc {
+static inline __m128 loadPixelPs(const uint8_t *p) {
+  int32_t v;
+  std::memcpy(&v, p, 4);
+  return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(v)));
+}
+// 与标量实现相同的运算顺序，结果逐位一致
+static void resizeBilinearRowSSE41(const uint8_t *r0, const uint8_t *r1,
+                                   const int *x0, const int *x1,
+                                   const float *wx, float wy, uint8_t *dst,
+                                   int dstW) {
+  const __m128 vwy = _mm_set1_ps(wy);
+  const __m128 vwy1 = _mm_set1_ps(1 - wy);
+  const __m128 half = _mm_set1_ps(0.5f);
+  for (int x = 0; x < dstW; ++x) {
+    __m128 a = _mm_set1_ps(wx[x]);
+    __m128 a1 = _mm_set1_ps(1 - wx[x]);
+    __m128 top = _mm_add_ps(_mm_mul_ps(loadPixelPs(r0 + (size_t)x0[x] * 4), a1),
+                            _mm_mul_ps(loadPixelPs(r0 + (size_t)x1[x] * 4), a));
+    __m128 bot = _mm_add_ps(_mm_mul_ps(loadPixelPs(r1 + (size_t)x0[x] * 4), a1),
+                            _mm_mul_ps(loadPixelPs(r1 + (size_t)x1[x] * 4), a));
+    __m128 v =
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(top, vwy1), _mm_mul_ps(bot, vwy)), half);
+    __m128i i = _mm_cvttps_epi32(v);
+    i = _mm_packus_epi32(i, i);
+    i = _mm_packus_epi16(i, i);
+    int32_t out = _mm_cvtsi128_si32(i);
+    std::memcpy(dst + (size_t)x * 4, &out, 4);
+  }
+}
+void fillKernelsSSE41(kernel_table &t) {
+  t.resize_bilinear_row = resizeBilinearRowSSE41;
+}
+} // namespace imgc
+#endif
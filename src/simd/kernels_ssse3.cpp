@@ -0,0 +1,119 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "kernels.h"
+#ifdef IMGC_ARCH_X86
+#include <tmmintrin.h>
+namespace imgc {
+// 3 通道 -> 4 通道：每次 16 像素（读 48 字节，写 64 字节）
+static size_t expand3to4(const uint8_t *src, uint8_t *dst, size_t count,
+                         __m128i mask) {
+  const __m128i alpha = _mm_set1_epi32((int)0xFF000000u);
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const uint8_t *s = src + i * 3;
+    __m128i v0 = _mm_loadu_si128((const __m128i *)s);
+    __m128i v1 = _mm_loadu_si128((const __m128i *)(s + 16));
+    __m128i v2 = _mm_loadu_si128((const __m128i *)(s + 32));
+    __m128i p0 = v0;
+    __m128i p1 = _mm_alignr_epi8(v1, v0, 12);
+    __m128i p2 = _mm_alignr_epi8(v2, v1, 8);
+    __m128i p3 = _mm_srli_si128(v2, 4);
+    uint8_t *d = dst + i * 4;
+    _mm_storeu_si128((__m128i *)d,
+                     _mm_or_si128(_mm_shuffle_epi8(p0, mask), alpha));
+    _mm_storeu_si128((__m128i *)(d + 16),
+                     _mm_or_si128(_mm_shuffle_epi8(p1, mask), alpha));
+    _mm_storeu_si128((__m128i *)(d + 32),
+                     _mm_or_si128(_mm_shuffle_epi8(p2, mask), alpha));
+    _mm_storeu_si128((__m128i *)(d + 48),
+                     _mm_or_si128(_mm_shuffle_epi8(p3, mask), alpha));
+  }
+  return i;
+}
+// 4 通道 -> 3 通道：每次 16 像素（读 64 字节，写 48 字节），
+// mask 把 4 个像素压缩到低 12 字节
+static size_t pack4to3(const uint8_t *src, uint8_t *dst, size_t count,
+                       __m128i mask) {
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    const uint8_t *s = src + i * 4;
+    __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)s), mask);
+    __m128i b =
+        _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(s + 16)), mask);
+    __m128i c =
+        _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(s + 32)), mask);
+    __m128i e =
+        _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(s + 48)), mask);
+    uint8_t *d = dst + i * 3;
+    _mm_storeu_si128((__m128i *)d, _mm_or_si128(a, _mm_slli_si128(b, 12)));
+    _mm_storeu_si128((__m128i *)(d + 16),
+                     _mm_or_si128(_mm_srli_si128(b, 4), _mm_slli_si128(c, 8)));
+    _mm_storeu_si128((__m128i *)(d + 32),
+                     _mm_or_si128(_mm_srli_si128(c, 8), _mm_slli_si128(e, 4)));
+  }
+  return i;
+}
+static void rgbToRgba(const uint8_t *src, uint8_t *dst, size_t count) {
+  size_t i = expand3to4(src, dst, count,
+                        _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9,
+                                      10, 11, -1));
+  convertScalar<layout_rgb, layout_rgba>(src + i * 3, dst + i * 4, count - i);
+}
+static void bgrToRgba(const uint8_t *src, uint8_t *dst, size_t count) {
+  size_t i = expand3to4(src, dst, count,
+                        _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11,
+                                      10, 9, -1));
+  convertScalar<layout_bgr, layout_rgba>(src + i * 3, dst + i * 4, count - i);
+}
+static void swapRb32(const uint8_t *src, uint8_t *dst, size_t count) {
+  const __m128i mask =
+      _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + i * 4));
+    _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_shuffle_epi8(v, mask));
+  }
+  convertScalar<layout_bgra, layout_rgba>(src + i * 4, dst + i * 4, count - i);
+}
+static void rgbaToRgb(const uint8_t *src, uint8_t *dst, size_t count) {
+  size_t i = pack4to3(src, dst, count,
+                      _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1,
+                                    -1, -1, -1));
+  convertScalar<layout_rgba, layout_rgb>(src + i * 4, dst + i * 3, count - i);
+}
+static void rgbaToBgr(const uint8_t *src, uint8_t *dst, size_t count) {
+  size_t i = pack4to3(src, dst, count,
+                      _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1,
+                                    -1, -1, -1));
+  convertScalar<layout_rgba, layout_bgr>(src + i * 4, dst + i * 3, count - i);
+}
+void fillKernelsSSSE3(kernel_table &t) {
+  t.rgb_to_rgba = rgbToRgba;
+  t.bgr_to_rgba = bgrToRgba;
+  t.swap_rb32 = swapRb32;
+  t.rgba_to_rgb = rgbaToRgb;
+  t.rgba_to_bgr = rgbaToBgr;
+}
+} // namespace imgc
+#endif
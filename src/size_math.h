@@ -0,0 +1,50 @@
+﻿#pragma once
+/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "image_compress/image_types.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+namespace imgc {
+// 检查溢出的尺寸乘法：a*b 超出 size_t 时返回 false，out 不变。
+// 32 位平台上 size_t 只有 4GB，大图的字节数可能在这里溢出
+inline bool checkedMul(size_t a, size_t b, size_t &out) {
+  if (a != 0 && b > std::numeric_limits<size_t>::max() / a)
+    return false;
+  out = a * b;
+  return true;
+}
+// w*h 像素、每像素 channels 字节的缓冲大小；尺寸非正或溢出时返回 false
+inline bool imageBytes(int w, int h, size_t channels, size_t &out) {
+  size_t px;
+  return w > 0 && h > 0 && checkedMul((size_t)w, (size_t)h, px) &&
+         checkedMul(px, channels, out);
+}
+// 尺寸为正且像素缓冲足以容纳整幅 RGBA
+inline bool validRGBA(const ImageRGBA &img) {
+  size_t bytes;
+  return imageBytes(img.width, img.height, 4, bytes) &&
+         img.pixels.size() >= bytes;
+}
+} // namespace imgc
@@ -0,0 +1,313 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "image_compress/tiled_image.h"
+#include "memory_account.h"
+#include "size_math.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <vector>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+namespace imgc {
+static const size_t kTileBytes =
+    (size_t)tiled_image::kTileSize * tiled_image::kTileSize * 4;
+// 换出块的存储：每块在临时文件中占固定的一格，整个文件一次映射
+class spill_file {
+public:
+  ~spill_file() { close(); }
+  bool open(const std::string &dir, size_t bytes) {
+#ifdef _WIN32
+    char path[MAX_PATH], name[MAX_PATH];
+    if (dir.empty()) {
+      if (!GetTempPathA(MAX_PATH, path))
+        return false;
+    } else {
+      strncpy(path, dir.c_str(), MAX_PATH - 1);
+      path[MAX_PATH - 1] = 0;
+    }
+    if (!GetTempFileNameA(path, "imc", 0, name))
+      return false;
+    // 关闭句柄时系统删除文件
+    file_ = CreateFileA(name, GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+                        CREATE_ALWAYS,
+                        FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+                        nullptr);
+    if (file_ == INVALID_HANDLE_VALUE)
+      return false;
+    unsigned long long n = bytes;
+    map_ = CreateFileMappingA(file_, nullptr, PAGE_READWRITE, (DWORD)(n >> 32),
+                              (DWORD)n, nullptr);
+    if (!map_)
+      return false;
+    data_ = (uint8_t *)MapViewOfFile(map_, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+    return data_ != nullptr;
+#else
+    std::string base = dir;
+    if (base.empty()) {
+      const char *t = std::getenv("TMPDIR");
+      base = t && *t ? t : "/tmp";
+    }
+    std::string name = base + "/imgc_tiles_XXXXXX";
+    std::vector<char> buf(name.begin(), name.end());
+    buf.push_back(0);
+    fd_ = mkstemp(buf.data());
+    if (fd_ < 0)
+      return false;
+    // 文件只通过映射访问，立即删除目录项，进程退出时自动回收
+    unlink(buf.data());
+    if (ftruncate(fd_, (off_t)bytes) != 0)
+      return false;
+    void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED)
+      return false;
+    data_ = (uint8_t *)p;
+    bytes_ = bytes;
+    return true;
+#endif
+  }
+  void close() {
+#ifdef _WIN32
+    if (data_)
+      UnmapViewOfFile(data_);
+    if (map_)
+      CloseHandle(map_);
+    if (file_ != INVALID_HANDLE_VALUE)
+      CloseHandle(file_);
+    map_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+#else
+    if (data_)
+      munmap(data_, bytes_);
+    if (fd_ >= 0)
+      ::close(fd_);
+    fd_ = -1;
+    bytes_ = 0;
+#endif
+    data_ = nullptr;
+  }
+  uint8_t *data() const { return data_; }
+  // 拷贝完一格后解除其页面映射：内容留在页缓存与文件中，由系统回写与回收，
+  // 不计入进程的常驻内存
+  void release(size_t offset, size_t bytes) {
+#ifndef _WIN32
+    madvise(data_ + offset, bytes, MADV_DONTNEED);
+#else
+    (void)offset;
+    (void)bytes;
+#endif
+  }
+
+private:
+  uint8_t *data_ = nullptr;
+#ifdef _WIN32
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  HANDLE map_ = nullptr;
+#else
+  int fd_ = -1;
+  size_t bytes_ = 0;
+#endif
+};
+struct tiled_image::impl {
+  struct slot {
+    std::unique_ptr<uint8_t[]> data; // 常驻时的像素
+    bool dirty = false;              // 读入后被修改过
+    bool spilled = false;            // 临时文件中有该块
+    std::list<size_t>::iterator pos; // 在 lru 中的位置
+  };
+  size_t budget;
+  std::string tempDir;
+  int width = 0, height = 0, tilesX = 0, tilesY = 0;
+  size_t capacity = 0; // 常驻块数上限，0 为不限
+  std::vector<slot> slots;
+  std::list<size_t> lru; // 最近使用的在前
+  spill_file spill;
+  bool spillOpen = false, spillFailed = false;
+  size_t spilled = 0;
+  // 常驻块缓冲计入构造时所在线程的内存计量作用域
+  memory_scope_state *scope;
+  size_t charged = 0;
+  impl(size_t b, const std::string &dir)
+      : budget(b), tempDir(dir), scope(currentMemoryScope()) {
+    memoryScopeRetain(scope);
+  }
+  ~impl() {
+    releaseTiles();
+    memoryScopeUnref(scope);
+  }
+  void releaseTiles() {
+    lru.clear();
+    slots.clear();
+    if (charged)
+      memoryRelease(scope, charged);
+    charged = 0;
+  }
+  // 换出最久未用的块，返回其缓冲供复用
+  std::unique_ptr<uint8_t[]> evict() {
+    size_t idx = lru.back();
+    slot &s = slots[idx];
+    if (s.dirty) {
+      if (!spillOpen && !spillFailed) {
+        spillOpen = spill.open(tempDir, slots.size() * kTileBytes);
+        spillFailed = !spillOpen;
+      }
+      if (!spillOpen)
+        return nullptr;
+      std::memcpy(spill.data() + idx * kTileBytes, s.data.get(), kTileBytes);
+      spill.release(idx * kTileBytes, kTileBytes);
+      if (!s.spilled)
+        ++spilled;
+      s.spilled = true;
+      s.dirty = false;
+    }
+    lru.pop_back();
+    return std::move(s.data);
+  }
+  uint8_t *acquire(int tx, int ty, bool write) {
+    if (tx < 0 || ty < 0 || tx >= tilesX || ty >= tilesY)
+      return nullptr;
+    size_t idx = (size_t)ty * tilesX + tx;
+    slot &s = slots[idx];
+    if (s.data) {
+      lru.splice(lru.begin(), lru, s.pos);
+    } else {
+      std::unique_ptr<uint8_t[]> buf;
+      if (capacity > 0 && lru.size() >= capacity) {
+        buf = evict();
+        if (!buf)
+          return nullptr;
+      } else {
+        // 新的块缓冲先经内存预算；缓冲在换出后复用，直到图像销毁才释放
+        if (!memoryCharge(scope, kTileBytes, true))
+          return nullptr;
+        charged += kTileBytes;
+        buf.reset(new uint8_t[kTileBytes]);
+      }
+      if (s.spilled) {
+        std::memcpy(buf.get(), spill.data() + idx * kTileBytes, kTileBytes);
+        spill.release(idx * kTileBytes, kTileBytes);
+      } else {
+        std::memset(buf.get(), 0, kTileBytes);
+      }
+      s.data = std::move(buf);
+      lru.push_front(idx);
+      s.pos = lru.begin();
+    }
+    if (write)
+      s.dirty = true;
+    return s.data.get();
+  }
+  // 按行访问：[x, x+count) 依次落在若干块内，逐块拷贝
+  template <bool WRITE>
+  bool rowAccess(int y, int x, int count, uint8_t *buf) {
+    if (y < 0 || y >= height || x < 0 || count < 0 || count > width - x)
+      return false;
+    int ty = y / kTileSize, iy = y % kTileSize;
+    while (count > 0) {
+      int tx = x / kTileSize, ix = x % kTileSize;
+      int n = std::min(count, kTileSize - ix);
+      uint8_t *t = acquire(tx, ty, WRITE);
+      if (!t)
+        return false;
+      uint8_t *p = t + ((size_t)iy * kTileSize + ix) * 4;
+      if (WRITE)
+        std::memcpy(p, buf, (size_t)n * 4);
+      else
+        std::memcpy(buf, p, (size_t)n * 4);
+      buf += (size_t)n * 4;
+      x += n;
+      count -= n;
+    }
+    return true;
+  }
+};
+tiled_image::tiled_image(size_t maxResidentBytes, const std::string &tempDir)
+    : impl_(new impl(maxResidentBytes, tempDir)) {}
+tiled_image::~tiled_image() { delete impl_; }
+bool tiled_image::create(int width, int height) {
+  if (width <= 0 || height <= 0)
+    return false;
+  impl &m = *impl_;
+  m.releaseTiles();
+  m.spill.close();
+  m.spillOpen = m.spillFailed = false;
+  m.spilled = 0;
+  m.width = width;
+  m.height = height;
+  m.tilesX = (width + kTileSize - 1) / kTileSize;
+  m.tilesY = (height + kTileSize - 1) / kTileSize;
+  m.slots.resize((size_t)m.tilesX * m.tilesY);
+  m.capacity = 0;
+  if (m.budget > 0)
+    m.capacity = std::max(m.budget / kTileBytes, (size_t)m.tilesX + 1);
+  return true;
+}
+int tiled_image::width() const { return impl_->width; }
+int tiled_image::height() const { return impl_->height; }
+int tiled_image::tilesX() const { return impl_->tilesX; }
+int tiled_image::tilesY() const { return impl_->tilesY; }
+const uint8_t *tiled_image::readTile(int tx, int ty) {
+  return impl_->acquire(tx, ty, false);
+}
+uint8_t *tiled_image::writeTile(int tx, int ty) {
+  return impl_->acquire(tx, ty, true);
+}
+bool tiled_image::readRow(int y, int x, int count, uint8_t *rgba) {
+  return impl_->rowAccess<false>(y, x, count, rgba);
+}
+bool tiled_image::writeRow(int y, int x, int count, const uint8_t *rgba) {
+  return impl_->rowAccess<true>(y, x, count, const_cast<uint8_t *>(rgba));
+}
+bool tiled_image::fromRGBA(const ImageRGBA &img) {
+  if (!validRGBA(img) || !create(img.width, img.height))
+    return false;
+  for (int y = 0; y < img.height; ++y)
+    if (!writeRow(y, 0, img.width, &img.pixels[(size_t)y * img.width * 4]))
+      return false;
+  return true;
+}
+bool tiled_image::toRGBA(ImageRGBA &img) {
+  size_t bytes;
+  if (!imageBytes(impl_->width, impl_->height, 4, bytes))
+    return false;
+  img.width = impl_->width;
+  img.height = impl_->height;
+  img.pixels.resize(bytes);
+  for (int y = 0; y < img.height; ++y)
+    if (!readRow(y, 0, img.width, &img.pixels[(size_t)y * img.width * 4]))
+      return false;
+  return true;
+}
+size_t tiled_image::residentTiles() const { return impl_->lru.size(); }
+size_t tiled_image::spilledTiles() const { return impl_->spilled; }
+} // namespace imgc
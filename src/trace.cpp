@@ -0,0 +1,176 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "image_compress/trace.h"
+#if defined(IMGC_ENABLE_TRACING) && IMGC_ENABLE_TRACING
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+namespace imgc {
+namespace {
+struct trace_event {
+  const char *name;
+  uint64_t job;
+  uint64_t start; // 纳秒，steady_clock
+  uint64_t end;
+};
+// 单写者环形缓冲：只由持有它的线程写入（包括清空），head 以 release 发布。
+// 线程退出后缓冲交给新线程继续使用，已记录的事件保留
+struct trace_buffer {
+  std::vector<trace_event> events;
+  std::atomic<uint64_t> head{0};
+  std::atomic<bool> owned{false};
+  uint64_t generation = 0; // 缓冲所属的记录轮次，只由持有者读写
+  int lane = 0;
+};
+struct trace_registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<trace_buffer>> buffers;
+  std::atomic<bool> enabled{false};
+  std::atomic<uint64_t> origin{0};
+  std::atomic<size_t> capacity{65536};
+  // 每次 traceStart 加一；各线程记录时发现轮次变化再清空自己的缓冲
+  std::atomic<uint64_t> generation{0};
+};
+// 不析构：线程退出时的 thread_local 析构仍会访问
+trace_registry &registry() {
+  static trace_registry *r = new trace_registry;
+  return *r;
+}
+uint64_t nowNs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+struct trace_lease {
+  trace_buffer *buffer = nullptr;
+  ~trace_lease() {
+    if (buffer)
+      buffer->owned.store(false, std::memory_order_release);
+  }
+};
+thread_local trace_lease tlsLease;
+thread_local uint64_t tlsJob = 0;
+// 线程首次记录时领取一个空闲缓冲（只在此处加锁）
+trace_buffer *threadBuffer() {
+  if (tlsLease.buffer)
+    return tlsLease.buffer;
+  trace_registry &r = registry();
+  std::lock_guard<std::mutex> lk(r.mutex);
+  for (auto &b : r.buffers) {
+    bool expected = false;
+    if (b->owned.compare_exchange_strong(expected, true))
+      return tlsLease.buffer = b.get();
+  }
+  r.buffers.emplace_back(new trace_buffer);
+  trace_buffer *b = r.buffers.back().get();
+  b->events.resize(r.capacity.load());
+  b->generation = r.generation.load();
+  b->lane = (int)r.buffers.size();
+  b->owned.store(true);
+  return tlsLease.buffer = b;
+}
+void record(const char *name, uint64_t start, uint64_t end) {
+  trace_buffer *b = threadBuffer();
+  trace_registry &r = registry();
+  uint64_t gen = r.generation.load(std::memory_order_acquire);
+  if (b->generation != gen) {
+    b->events.assign(r.capacity.load(std::memory_order_relaxed),
+                     trace_event());
+    b->head.store(0, std::memory_order_relaxed);
+    b->generation = gen;
+  }
+  size_t cap = b->events.size();
+  if (cap == 0)
+    return;
+  uint64_t h = b->head.load(std::memory_order_relaxed);
+  b->events[h % cap] = trace_event{name, tlsJob, start, end};
+  b->head.store(h + 1, std::memory_order_release);
+}
+} // namespace
+
+bool traceStart(size_t eventsPerThread) {
+  trace_registry &r = registry();
+  std::lock_guard<std::mutex> lk(r.mutex);
+  // 不触碰其他线程的缓冲（它们可能正在无锁写入），只开启新一轮；
+  // 上一轮的事件早于 origin，写出时被跳过
+  r.capacity.store(std::max<size_t>(eventsPerThread, 1));
+  r.origin.store(nowNs());
+  r.generation.fetch_add(1, std::memory_order_release);
+  r.enabled.store(true);
+  return true;
+}
+void traceStop() { registry().enabled.store(false); }
+bool traceDump(const std::string &path) {
+  FILE *f = std::fopen(path.c_str(), "wb");
+  if (!f)
+    return false;
+  trace_registry &r = registry();
+  std::lock_guard<std::mutex> lk(r.mutex);
+  uint64_t origin = r.origin.load();
+  std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  bool first = true;
+  for (auto &b : r.buffers) {
+    std::fprintf(f,
+                 "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                 "\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                 first ? "" : ",\n", b->lane, b->lane);
+    first = false;
+    uint64_t h = b->head.load(std::memory_order_acquire);
+    size_t cap = b->events.size();
+    uint64_t n = std::min<uint64_t>(h, cap);
+    // 完整事件（ph=X）：一条记录即一对起止
+    for (uint64_t i = h - n; i < h; ++i) {
+      const trace_event &e = b->events[i % cap];
+      if (!e.name || e.start < origin)
+        continue;
+      std::fprintf(f,
+                   ",\n{\"name\":\"%s\",\"cat\":\"imgc\",\"ph\":\"X\","
+                   "\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                   e.name, b->lane, (e.start - origin) / 1000.0,
+                   (e.end - e.start) / 1000.0);
+      if (e.job)
+        std::fprintf(f, ",\"args\":{\"job\":%llu}", (unsigned long long)e.job);
+      std::fprintf(f, "}");
+    }
+  }
+  std::fprintf(f, "\n]}\n");
+  return std::fclose(f) == 0;
+}
+uint64_t traceCurrentJob() { return tlsJob; }
+trace_job::trace_job(uint64_t id) : prev_(tlsJob) { tlsJob = id; }
+trace_job::~trace_job() { tlsJob = prev_; }
+trace_span::trace_span(const char *name)
+    : name_(name),
+      start_(registry().enabled.load(std::memory_order_relaxed) ? nowNs()
+                                                                 : 0) {}
+trace_span::~trace_span() {
+  if (start_)
+    record(name_, start_, nowNs());
+}
+} // namespace imgc
+#endif
@@ -0,0 +1,784 @@
+﻿/*
+MIT License
+
+Copyright (c) 2025 ZHUWEIYE
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#include "image_compress/image_compress.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#include <io.h>
+#include <process.h>
+#include <sys/stat.h>
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace imgc;
+
+// ----------------- 平台相关的文件操作 -----------------
+struct FileStat {
+  bool exists = false;
+  bool isDir = false;
+  uint64_t size = 0;
+  int64_t mtime = 0;
+};
+static FileStat statPath(const std::string &path) {
+  FileStat fs;
+#ifdef _WIN32
+  struct _stat64 st;
+  if (_stat64(path.c_str(), &st) != 0)
+    return fs;
+  fs.isDir = (st.st_mode & _S_IFDIR) != 0;
+#else
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0)
+    return fs;
+  fs.isDir = S_ISDIR(st.st_mode);
+#endif
+  fs.exists = true;
+  fs.size = (uint64_t)st.st_size;
+  fs.mtime = (int64_t)st.st_mtime;
+  return fs;
+}
+static bool isSep(char c) { return c == '/' || c == '\\'; }
+static std::string joinPath(const std::string &a, const std::string &b) {
+  if (a.empty())
+    return b;
+  if (isSep(a.back()))
+    return a + b;
+  return a + "/" + b;
+}
+static std::string dirName(const std::string &p) {
+  size_t i = p.find_last_of("/\\");
+  return i == std::string::npos ? std::string() : p.substr(0, i);
+}
+static std::string baseName(const std::string &p) {
+  size_t i = p.find_last_of("/\\");
+  return i == std::string::npos ? p : p.substr(i + 1);
+}
+static bool makeDirs(const std::string &dir) {
+  if (dir.empty() || statPath(dir).isDir)
+    return true;
+  if (!makeDirs(dirName(dir)))
+    return false;
+#ifdef _WIN32
+  int r = _mkdir(dir.c_str());
+#else
+  int r = mkdir(dir.c_str(), 0755);
+#endif
+  return r == 0 || statPath(dir).isDir; // 其他线程可能已创建
+}
+// 列出目录下的所有文件（递归），返回相对路径
+static void listFiles(const std::string &root, const std::string &rel,
+                      std::vector<std::string> &out) {
+  std::string dir = rel.empty() ? root : joinPath(root, rel);
+#ifdef _WIN32
+  WIN32_FIND_DATAA fd;
+  HANDLE h = FindFirstFileA(joinPath(dir, "*").c_str(), &fd);
+  if (h == INVALID_HANDLE_VALUE)
+    return;
+  do {
+    std::string name = fd.cFileName;
+    if (name == "." || name == "..")
+      continue;
+    std::string r = rel.empty() ? name : rel + "/" + name;
+    if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+      listFiles(root, r, out);
+    else
+      out.push_back(r);
+  } while (FindNextFileA(h, &fd));
+  FindClose(h);
+#else
+  DIR *d = opendir(dir.c_str());
+  if (!d)
+    return;
+  while (dirent *e = readdir(d)) {
+    std::string name = e->d_name;
+    if (name == "." || name == "..")
+      continue;
+    std::string r = rel.empty() ? name : rel + "/" + name;
+    if (statPath(joinPath(root, r)).isDir)
+      listFiles(root, r, out);
+    else
+      out.push_back(r);
+  }
+  closedir(d);
+#endif
+}
+// 原子替换：先写临时文件再重命名
+static bool writeAtomic(const std::string &path,
+                        const std::vector<uint8_t> &data) {
+  static std::atomic<unsigned> counter(0);
+  std::ostringstream tmp;
+#ifdef _WIN32
+  tmp << path << ".tmp" << _getpid() << "_" << counter++;
+#else
+  tmp << path << ".tmp" << getpid() << "_" << counter++;
+#endif
+  std::string tmpPath = tmp.str();
+  FILE *f = std::fopen(tmpPath.c_str(), "wb");
+  if (!f)
+    return false;
+  // 写入、刷新、落盘与关闭任一步失败（如磁盘已满）都不能替换已有的输出
+  bool written =
+      std::fwrite(data.data(), 1, data.size(), f) == data.size() &&
+      std::fflush(f) == 0;
+#ifdef _WIN32
+  written = written && _commit(_fileno(f)) == 0;
+#else
+  written = written && fsync(fileno(f)) == 0;
+#endif
+  if (std::fclose(f) != 0 || !written) {
+    std::remove(tmpPath.c_str());
+    return false;
+  }
+#ifdef _WIN32
+  bool ok = MoveFileExA(tmpPath.c_str(), path.c_str(),
+                        MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  bool ok = std::rename(tmpPath.c_str(), path.c_str()) == 0;
+#endif
+  if (!ok)
+    std::remove(tmpPath.c_str());
+  return ok;
+}
+static bool readFile(const std::string &path, std::vector<uint8_t> &data) {
+  std::ifstream ifs(path, std::ios::binary);
+  if (!ifs)
+    return false;
+  data.assign((std::istreambuf_iterator<char>(ifs)),
+              std::istreambuf_iterator<char>());
+  return true;
+}
+
+// ----------------- 通配符匹配（* ? []，不区分大小写） -----------------
+static bool globMatch(const char *p, const char *s) {
+  for (; *p; ++p, ++s) {
+    if (*p == '*') {
+      while (*p == '*')
+        ++p;
+      if (!*p)
+        return true;
+      for (; *s; ++s)
+        if (globMatch(p, s))
+          return true;
+      return false;
+    }
+    if (!*s)
+      return false;
+    if (*p == '?')
+      continue;
+    if (*p == '[') {
+      const char *q = p + 1;
+      bool neg = (*q == '!' || *q == '^');
+      if (neg)
+        ++q;
+      bool hit = false;
+      int c = std::tolower((unsigned char)*s);
+      for (; *q && *q != ']'; ++q) {
+        if (q[1] == '-' && q[2] && q[2] != ']') {
+          if (c >= std::tolower((unsigned char)q[0]) &&
+              c <= std::tolower((unsigned char)q[2]))
+            hit = true;
+          q += 2;
+        } else if (c == std::tolower((unsigned char)*q)) {
+          hit = true;
+        }
+      }
+      if (!*q || hit == neg)
+        return false;
+      p = q;
+      continue;
+    }
+    if (std::tolower((unsigned char)*p) != std::tolower((unsigned char)*s))
+      return false;
+  }
+  return *s == 0;
+}
+// 含路径分隔符的模式匹配相对路径，否则只匹配文件名
+static bool matchAny(const std::vector<std::string> &globs,
+                     const std::string &rel) {
+  for (const auto &g : globs) {
+    const std::string &subject =
+        g.find('/') != std::string::npos ? rel : baseName(rel);
+    if (globMatch(g.c_str(), subject.c_str()))
+      return true;
+  }
+  return false;
+}
+
+// ----------------- 增量状态 -----------------
+static uint64_t fnv1a(const std::vector<uint8_t> &data) {
+  uint64_t h = 1469598103934665603ULL;
+  for (uint8_t b : data) {
+    h ^= b;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+struct StateEntry {
+  uint64_t size = 0;
+  int64_t mtime = 0;
+  uint64_t hash = 0;
+  std::string params;
+};
+// 状态文件每行：输出路径 \t 源大小 \t 源 mtime \t 源哈希 \t 参数指纹
+static void loadState(const std::string &path,
+                      std::map<std::string, StateEntry> &state) {
+  std::ifstream ifs(path);
+  std::string line;
+  while (std::getline(ifs, line)) {
+    std::istringstream ls(line);
+    std::string key, hash;
+    StateEntry e;
+    if (std::getline(ls, key, '\t') && ls >> e.size >> e.mtime >> hash >>
+                                           e.params) {
+      e.hash = std::strtoull(hash.c_str(), nullptr, 16);
+      state[key] = e;
+    }
+  }
+}
+static bool saveState(const std::string &path,
+                      const std::map<std::string, StateEntry> &state) {
+  std::ostringstream os;
+  for (const auto &kv : state) {
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx",
+                  (unsigned long long)kv.second.hash);
+    os << kv.first << '\t' << kv.second.size << '\t' << kv.second.mtime << '\t'
+       << hash << '\t' << kv.second.params << '\n';
+  }
+  std::string s = os.str();
+  return writeAtomic(path, std::vector<uint8_t>(s.begin(), s.end()));
+}
+
+// ----------------- 命令行 -----------------
+struct Job {
+  std::string src;
+  std::string dst;
+};
+struct Options {
+  std::vector<std::string> inputs;
+  std::string outDir;
+  std::string manifest;
+  std::string stateFile;
+  std::string traceFile;
+  std::vector<std::string> includes;
+  std::vector<std::string> excludes;
+  int jobs = 0;
+  // 单次转换的内存预算（字节），0 为不限
+  uint64_t maxMemory = 0;
+  bool incremental = false;
+  bool quiet = false;
+  compress_params params;
+};
+static void usage() {
+  std::cout
+      << "Usage: image_compress_cli [options] <file|dir>... -o <outdir>\n"
+         "  -o, --output DIR     output directory\n"
+         "  -j N                 worker threads (default: CPU count)\n"
+         "  -f, --format FMT     jpeg | png | bmp | qoi | auto (default: auto)\n"
+         "                       smart: JPEG or PNG by content, extension "
+         "follows the choice\n"
+         "  -q, --quality N      JPEG quality 1-100 / PNG zlib level 0-9\n"
+         "  --target-ssim X      lowest JPEG quality whose SSIM >= X "
+         "(e.g. 0.95)\n"
+         "  --width N --height N resize output\n"
+         "  --bilinear           bilinear resize (default: nearest)\n"
+         "  --jpeg-preset NAME   fastest | balanced | smallest | quality\n"
+         "  --fast-decode        fast approximate JPEG decode for previews\n"
+         "  --auto-orient        apply EXIF orientation (lossless for "
+         "JPEG->JPEG)\n"
+         "  --rotate DEG         rotate clockwise: 90 | 180 | 270\n"
+         "  --flip-h, --flip-v   flip horizontally / vertically\n"
+         "  --max-pixels N       reject inputs/outputs above N pixels\n"
+         "                       (default: 268435456, 0 = unlimited)\n"
+         "  --max-memory MB      fail conversions needing more than MB "
+         "of memory\n"
+         "  --include GLOB       only process matching files (repeatable)\n"
+         "  --exclude GLOB       skip matching files (repeatable)\n"
+         "  --manifest FILE      read jobs from FILE: 'input[<TAB>output]' "
+         "per line\n"
+         "  --incremental        skip outputs whose source is unchanged\n"
+         "  --state FILE         incremental state file\n"
+         "                       (default: <outdir>/.image_compress_cli.state)\n"
+         "  --quiet              only print errors and the summary\n"
+         "  --trace FILE         write a Chrome trace of pipeline stages "
+         "(needs a\n"
+         "                       build with IMGC_ENABLE_TRACING)\n";
+}
+static bool parseFormat(const std::string &s, compress_params::Format &f) {
+  if (s == "jpeg" || s == "jpg")
+    f = compress_params::Format::JPEG;
+  else if (s == "png")
+    f = compress_params::Format::PNG;
+  else if (s == "bmp")
+    f = compress_params::Format::BMP;
+  else if (s == "qoi")
+    f = compress_params::Format::QOI;
+  else if (s == "auto")
+    f = compress_params::Format::AUTO;
+  else if (s == "smart")
+    f = compress_params::Format::SMART;
+  else
+    return false;
+  return true;
+}
+static bool parseJpegPreset(const std::string &s, JpegPreset &p) {
+  if (s == "fastest")
+    p = JpegPreset::FASTEST;
+  else if (s == "balanced")
+    p = JpegPreset::BALANCED;
+  else if (s == "smallest")
+    p = JpegPreset::SMALLEST;
+  else if (s == "quality")
+    p = JpegPreset::QUALITY;
+  else
+    return false;
+  return true;
+}
+// 十进制无符号整数：拒绝空串、符号、多余字符与超出 max 的值
+static bool parseCount(const std::string &s, unsigned long long max,
+                       unsigned long long &v) {
+  if (s.empty() || !std::isdigit((unsigned char)s[0]))
+    return false;
+  char *end = nullptr;
+  errno = 0;
+  v = std::strtoull(s.c_str(), &end, 10);
+  return *end == '\0' && errno != ERANGE && v <= max;
+}
+static bool parseArgs(int argc, char **argv, Options &o) {
+  JpegPreset preset = JpegPreset::BALANCED;
+  bool havePreset = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string a = argv[i];
+    auto next = [&](std::string &v) {
+      if (i + 1 >= argc) {
+        std::cerr << "Missing value for " << a << std::endl;
+        return false;
+      }
+      v = argv[++i];
+      return true;
+    };
+    std::string v;
+    if (a == "-h" || a == "--help") {
+      usage();
+      std::exit(0);
+    } else if (a == "-o" || a == "--output") {
+      if (!next(o.outDir))
+        return false;
+    } else if (a == "-j") {
+      if (!next(v))
+        return false;
+      o.jobs = std::atoi(v.c_str());
+    } else if (a.size() > 2 && a.compare(0, 2, "-j") == 0) {
+      o.jobs = std::atoi(a.c_str() + 2);
+    } else if (a == "-f" || a == "--format") {
+      if (!next(v) || !parseFormat(v, o.params.format)) {
+        std::cerr << "Unknown format: " << v << std::endl;
+        return false;
+      }
+    } else if (a == "-q" || a == "--quality") {
+      if (!next(v))
+        return false;
+      o.params.quality = std::atoi(v.c_str());
+    } else if (a == "--target-ssim") {
+      if (!next(v))
+        return false;
+      o.params.target_ssim = std::atof(v.c_str());
+      if (o.params.target_ssim <= 0 || o.params.target_ssim >= 1) {
+        std::cerr << "Invalid SSIM target: " << v << std::endl;
+        return false;
+      }
+    } else if (a == "--width") {
+      if (!next(v))
+        return false;
+      o.params.output_width = std::atoi(v.c_str());
+    } else if (a == "--height") {
+      if (!next(v))
+        return false;
+      o.params.output_height = std::atoi(v.c_str());
+    } else if (a == "--bilinear") {
+      o.params.resize_algo = compress_params::ResizeAlgo::BILINEAR;
+    } else if (a == "--fast-decode") {
+      o.params.decode_speed = DecodeSpeed::FAST;
+    } else if (a == "--auto-orient") {
+      o.params.auto_orient = true;
+    } else if (a == "--rotate") {
+      if (!next(v) || (v != "0" && v != "90" && v != "180" && v != "270")) {
+        std::cerr << "Invalid rotation: " << v << std::endl;
+        return false;
+      }
+      o.params.rotation = (compress_params::Rotation)(std::atoi(v.c_str()) / 90);
+    } else if (a == "--flip-h") {
+      o.params.flip_horizontal = true;
+    } else if (a == "--flip-v") {
+      o.params.flip_vertical = true;
+    } else if (a == "--max-pixels") {
+      if (!next(v))
+        return false;
+      // 0 表示不限，拼写错误不能悄悄关闭解码炸弹防护
+      if (!parseCount(v, ULLONG_MAX, o.params.limits.max_pixels)) {
+        std::cerr << "Invalid pixel limit: " << v << std::endl;
+        return false;
+      }
+    } else if (a == "--max-memory") {
+      if (!next(v))
+        return false;
+      // 拒绝无法解析或换算成字节后溢出的值
+      unsigned long long mb;
+      if (!parseCount(v, UINT64_MAX >> 20, mb)) {
+        std::cerr << "Invalid memory budget: " << v << std::endl;
+        return false;
+      }
+      o.maxMemory = (uint64_t)mb << 20;
+    } else if (a == "--jpeg-preset") {
+      if (!next(v) || !parseJpegPreset(v, preset)) {
+        std::cerr << "Unknown JPEG preset: " << v << std::endl;
+        return false;
+      }
+      havePreset = true;
+    } else if (a == "--include") {
+      if (!next(v))
+        return false;
+      o.includes.push_back(v);
+    } else if (a == "--exclude") {
+      if (!next(v))
+        return false;
+      o.excludes.push_back(v);
+    } else if (a == "--manifest") {
+      if (!next(o.manifest))
+        return false;
+    } else if (a == "--incremental") {
+      o.incremental = true;
+    } else if (a == "--state") {
+      if (!next(o.stateFile))
+        return false;
+    } else if (a == "--trace") {
+      if (!next(o.traceFile))
+        return false;
+    } else if (a == "--quiet") {
+      o.quiet = true;
+    } else if (!a.empty() && a[0] == '-') {
+      std::cerr << "Unknown option: " << a << std::endl;
+      return false;
+    } else {
+      o.inputs.push_back(a);
+    }
+  }
+  if (o.inputs.empty() && o.manifest.empty()) {
+    usage();
+    return false;
+  }
+  // 预设依赖最终的 quality，参数解析完成后再套用
+  if (havePreset)
+    applyJpegPreset(o.params, preset);
+  return true;
+}
+// 按输出格式替换扩展名，AUTO 与 SMART 保持原扩展名（SMART 在转换后替换）
+static std::string outputName(const std::string &rel,
+                              compress_params::Format f) {
+  const char *ext = nullptr;
+  if (f == compress_params::Format::JPEG)
+    ext = ".jpg";
+  else if (f == compress_params::Format::PNG)
+    ext = ".png";
+  else if (f == compress_params::Format::BMP)
+    ext = ".bmp";
+  else if (f == compress_params::Format::QOI)
+    ext = ".qoi";
+  if (!ext)
+    return rel;
+  size_t dot = rel.find_last_of('.');
+  size_t sep = rel.find_last_of("/\\");
+  if (dot == std::string::npos || (sep != std::string::npos && dot < sep))
+    return rel + ext;
+  return rel.substr(0, dot) + ext;
+}
+static std::string paramsFingerprint(const compress_params &p) {
+  std::ostringstream os;
+  os << (int)p.format << ',' << p.quality << ',' << p.output_width << ','
+     << p.output_height << ',' << (int)p.resize_algo << ','
+     << p.jpeg_progressive << p.jpeg_optimize_coding
+     << (int)p.jpeg_subsampling << (int)p.jpeg_dct_method << ','
+     << p.jpeg_restart_rows << ',' << p.jpeg_chroma_quality << ','
+     << (int)p.decode_speed << ',' << p.target_ssim << ',' << p.auto_orient
+     << (int)p.rotation << p.flip_horizontal << p.flip_vertical;
+  return os.str();
+}
+static bool collectJobs(const Options &o, std::vector<Job> &jobs) {
+  static const std::vector<std::string> kImageGlobs = {"*.jpg", "*.jpeg",
+                                                       "*.png", "*.bmp",
+                                                       "*.qoi"};
+  const std::vector<std::string> &includes =
+      o.includes.empty() ? kImageGlobs : o.includes;
+  auto accept = [&](const std::string &rel) {
+    return matchAny(includes, rel) && !matchAny(o.excludes, rel);
+  };
+  if (!o.manifest.empty()) {
+    std::ifstream ifs(o.manifest);
+    if (!ifs) {
+      std::cerr << "Open manifest failed: " << o.manifest << std::endl;
+      return false;
+    }
+    std::string line;
+    while (std::getline(ifs, line)) {
+      if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+      if (line.empty() || line[0] == '#')
+        continue;
+      size_t tab = line.find('\t');
+      Job j;
+      j.src = line.substr(0, tab);
+      if (tab != std::string::npos)
+        j.dst = line.substr(tab + 1);
+      else if (!o.outDir.empty())
+        j.dst = joinPath(o.outDir, outputName(baseName(j.src), o.params.format));
+      else {
+        std::cerr << "No output for manifest entry: " << j.src << std::endl;
+        return false;
+      }
+      jobs.push_back(j);
+    }
+  }
+  for (const auto &in : o.inputs) {
+    FileStat st = statPath(in);
+    if (!st.exists) {
+      std::cerr << "Input not found: " << in << std::endl;
+      return false;
+    }
+    if (o.outDir.empty()) {
+      std::cerr << "Missing output directory (-o)" << std::endl;
+      return false;
+    }
+    if (st.isDir) {
+      std::vector<std::string> files;
+      listFiles(in, "", files);
+      std::sort(files.begin(), files.end());
+      for (const auto &rel : files) {
+        if (!accept(rel))
+          continue;
+        jobs.push_back({joinPath(in, rel),
+                        joinPath(o.outDir, outputName(rel, o.params.format))});
+      }
+    } else {
+      // 显式列出的文件只受 --exclude 过滤
+      if (matchAny(o.excludes, baseName(in)))
+        continue;
+      jobs.push_back(
+          {in, joinPath(o.outDir, outputName(baseName(in), o.params.format))});
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  Options o;
+  if (!parseArgs(argc, argv, o))
+    return 2;
+  std::vector<Job> jobs;
+  if (!collectJobs(o, jobs))
+    return 2;
+  int workers = o.jobs > 0 ? o.jobs : (int)std::thread::hardware_concurrency();
+  if (workers <= 0)
+    workers = 1;
+  workers = std::min<int>(workers, (int)std::max<size_t>(1, jobs.size()));
+  // 多个文件并行时单幅图像内不再拆分线程；只有一个任务时交给库内并行
+  if (workers > 1)
+    o.params.threads = 1;
+
+  std::string statePath = o.stateFile;
+  if (o.incremental && statePath.empty()) {
+    if (o.outDir.empty()) {
+      std::cerr << "--incremental needs -o or --state" << std::endl;
+      return 2;
+    }
+    statePath = joinPath(o.outDir, ".image_compress_cli.state");
+  }
+  std::map<std::string, StateEntry> state;
+  std::mutex stateMutex;
+  if (o.incremental)
+    loadState(statePath, state);
+  const std::string fingerprint = paramsFingerprint(o.params);
+
+  std::atomic<size_t> next(0);
+  std::atomic<size_t> done(0), skipped(0), failed(0);
+  std::atomic<uint64_t> bytesIn(0), bytesOut(0), peakMemory(0);
+  std::mutex logMutex;
+  auto log = [&](std::ostream &os, const std::string &msg) {
+    std::lock_guard<std::mutex> lk(logMutex);
+    os << msg << std::endl;
+  };
+  if (!o.traceFile.empty() && !traceStart()) {
+    std::cerr << "--trace needs a build with IMGC_ENABLE_TRACING" << std::endl;
+    return 2;
+  }
+  auto start = std::chrono::steady_clock::now();
+  auto worker = [&]() {
+    image_converter converter;
+    std::vector<uint8_t> in, out;
+    for (;;) {
+      size_t i = next++;
+      if (i >= jobs.size())
+        break;
+      const Job &j = jobs[i];
+      trace_job traceBind(i + 1);
+      FileStat src = statPath(j.src);
+      StateEntry prev;
+      bool havePrev = false;
+      bool outExists = false;
+      if (o.incremental) {
+        std::lock_guard<std::mutex> lk(stateMutex);
+        auto it = state.find(j.dst);
+        if (it != state.end()) {
+          prev = it->second;
+          havePrev = prev.params == fingerprint;
+        }
+      }
+      bool smart = o.params.format == compress_params::Format::SMART;
+      if (havePrev) {
+        outExists = statPath(j.dst).exists;
+        // SMART 的输出扩展名取决于上次所选的格式
+        if (smart && !outExists)
+          outExists =
+              statPath(outputName(j.dst, compress_params::Format::JPEG)).exists ||
+              statPath(outputName(j.dst, compress_params::Format::PNG)).exists;
+        // 大小与 mtime 未变，不读源文件直接跳过
+        if (outExists && prev.size == src.size && prev.mtime == src.mtime) {
+          ++skipped;
+          continue;
+        }
+      }
+      bool readOk;
+      {
+        IMGC_TRACE_SCOPE("read");
+        readOk = readFile(j.src, in);
+      }
+      if (!readOk) {
+        log(std::cerr, "Open input failed: " + j.src);
+        ++failed;
+        continue;
+      }
+      uint64_t hash = o.incremental ? fnv1a(in) : 0;
+      if (havePrev && outExists && prev.hash == hash) {
+        // mtime 变化但内容未变：只刷新状态
+        std::lock_guard<std::mutex> lk(stateMutex);
+        state[j.dst] = {src.size, src.mtime, hash, fingerprint};
+        ++skipped;
+        continue;
+      }
+      compress_params::Format chosen;
+      int64_t s;
+      {
+        // 每次转换一个计量作用域，记录单次转换的峰值
+        uint64_t budget = o.maxMemory;
+        memory_scope scope([budget](size_t bytes, uint64_t current) {
+          return budget == 0 || current + bytes <= budget;
+        });
+        s = converter.convertMemory(in.data(), in.size(), out, o.params,
+                                    &chosen);
+        uint64_t peak = scope.stats().peak_bytes;
+        uint64_t seen = peakMemory.load();
+        while (peak > seen && !peakMemory.compare_exchange_weak(seen, peak))
+          ;
+      }
+      if (s < 0) {
+        log(std::cerr, (s == kErrLimitExceeded ? "Limit exceeded: "
+                                                : "Convert failed: ") +
+                           j.src);
+        ++failed;
+        continue;
+      }
+      std::string dst = smart ? outputName(j.dst, chosen) : j.dst;
+      bool writeOk;
+      {
+        IMGC_TRACE_SCOPE("write");
+        writeOk = makeDirs(dirName(dst)) && writeAtomic(dst, out);
+      }
+      if (!writeOk) {
+        log(std::cerr, "Write output failed: " + dst);
+        ++failed;
+        continue;
+      }
+      bytesIn += in.size();
+      bytesOut += out.size();
+      ++done;
+      if (o.incremental) {
+        std::lock_guard<std::mutex> lk(stateMutex);
+        state[j.dst] = {src.size, src.mtime, hash, fingerprint};
+      }
+      if (!o.quiet)
+        log(std::cout, j.src + " -> " + dst);
+    }
+  };
+  std::vector<std::thread> pool;
+  for (int t = 0; t < workers; ++t)
+    pool.emplace_back(worker);
+  for (auto &t : pool)
+    t.join();
+  if (!o.traceFile.empty()) {
+    traceStop();
+    if (!traceDump(o.traceFile))
+      std::cerr << "Write trace failed: " << o.traceFile << std::endl;
+  }
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                              start)
+                    .count();
+  if (o.incremental && !saveState(statePath, state))
+    std::cerr << "Write state failed: " << statePath << std::endl;
+
+  double mbIn = bytesIn / (1024.0 * 1024.0);
+  double mbOut = bytesOut / (1024.0 * 1024.0);
+  char summary[512];
+  std::snprintf(summary, sizeof(summary),
+                "%zu converted, %zu skipped, %zu failed in %.2fs with %d "
+                "workers\n"
+                "in %.2f MB, out %.2f MB, %.1f images/s, %.2f MB/s (input)\n"
+                "peak memory per conversion %.2f MB",
+                done.load(), skipped.load(), failed.load(), secs, workers, mbIn,
+                mbOut, secs > 0 ? done / secs : 0.0,
+                secs > 0 ? mbIn / secs : 0.0,
+                peakMemory / (1024.0 * 1024.0));
+  std::cout << summary << std::endl;
+  return failed ? 1 : 0;
+}